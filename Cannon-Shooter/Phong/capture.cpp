@@ -0,0 +1,283 @@
+#include "capture.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// NOTE: Largest stored deflate block
+#define CAPTURE_DEFLATE_BLOCK 65535
+
+static unsigned
+crc32(unsigned crc, const unsigned char* data, size_t size) {
+    static unsigned Table[256];
+    static bool TableReady = false;
+    if (!TableReady) {
+        for (unsigned Idx = 0; Idx < 256; ++Idx) {
+            unsigned Value = Idx;
+            for (unsigned Bit = 0; Bit < 8; ++Bit) Value = Value & 1 ? 0xEDB88320u ^ (Value >> 1) : Value >> 1;
+            Table[Idx] = Value;
+        }
+        TableReady = true;
+    }
+    crc = ~crc;
+    for (size_t Idx = 0; Idx < size; ++Idx) crc = Table[(crc ^ data[Idx]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void
+appendBigEndian(std::vector<unsigned char>& out, unsigned value) {
+    unsigned char Bytes[] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+    out.insert(out.end(), Bytes, Bytes + 4);
+}
+
+static void
+appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+    appendBigEndian(out, data.size());
+    size_t TypeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(0, out.data() + TypeStart, out.size() - TypeStart));
+}
+
+/**
+ * @brief Writes RGBA8 pixels as a PNG. Rows are filtered with None and stored
+ * in uncompressed deflate blocks, it's written on the worker and speed matters
+ * more than size. Rows come bottom first like glReadPixels returns them
+ *
+ */
+static bool
+writePng(const std::string& path, const std::vector<unsigned char>& pixels, int width, int height) {
+    size_t RowSize = (size_t)width * 4;
+    std::vector<unsigned char> Scanlines;
+    Scanlines.reserve((RowSize + 1) * height);
+    for (int Row = height - 1; Row >= 0; --Row) {
+        Scanlines.push_back(0);
+        Scanlines.insert(Scanlines.end(), pixels.begin() + Row * RowSize, pixels.begin() + (Row + 1) * RowSize);
+    }
+
+    std::vector<unsigned char> Deflate = { 0x78, 0x01 };
+    Deflate.reserve(Scanlines.size() + Scanlines.size() / CAPTURE_DEFLATE_BLOCK * 5 + 16);
+    unsigned AdlerA = 1;
+    unsigned AdlerB = 0;
+    for (size_t Offset = 0; Offset < Scanlines.size() || Offset == 0; Offset += CAPTURE_DEFLATE_BLOCK) {
+        size_t Length = std::min((size_t)CAPTURE_DEFLATE_BLOCK, Scanlines.size() - Offset);
+        bool Final = Offset + Length >= Scanlines.size();
+        unsigned char Header[] = { (unsigned char)Final, (unsigned char)Length, (unsigned char)(Length >> 8), (unsigned char)~Length, (unsigned char)(~Length >> 8) };
+        Deflate.insert(Deflate.end(), Header, Header + 5);
+        Deflate.insert(Deflate.end(), Scanlines.begin() + Offset, Scanlines.begin() + Offset + Length);
+        for (size_t Idx = Offset; Idx < Offset + Length; ++Idx) {
+            AdlerA = (AdlerA + Scanlines[Idx]) % 65521;
+            AdlerB = (AdlerB + AdlerA) % 65521;
+        }
+        if (Final) break;
+    }
+    appendBigEndian(Deflate, (AdlerB << 16) | AdlerA);
+
+    std::vector<unsigned char> Header;
+    appendBigEndian(Header, width);
+    appendBigEndian(Header, height);
+    // NOTE: 8 bits per channel, RGBA, deflate, adaptive filtering, no interlace
+    unsigned char Format[] = { 8, 6, 0, 0, 0 };
+    Header.insert(Header.end(), Format, Format + 5);
+
+    std::vector<unsigned char> Png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    appendChunk(Png, "IHDR", Header);
+    appendChunk(Png, "IDAT", Deflate);
+    appendChunk(Png, "IEND", std::vector<unsigned char>());
+
+    std::ofstream Out(path, std::ios::binary);
+    Out.write((const char*)Png.data(), Png.size());
+    return Out.good();
+}
+
+static bool
+writeRaw(const std::string& path, const std::vector<unsigned char>& pixels, int width, int height) {
+    size_t RowSize = (size_t)width * 4;
+    std::ofstream Out(path, std::ios::binary);
+    for (int Row = height - 1; Row >= 0; --Row) Out.write((const char*)pixels.data() + Row * RowSize, RowSize);
+    return Out.good();
+}
+
+FrameCapture::FrameCapture() {
+    for (unsigned Idx = 0; Idx < CAPTURE_PBO_COUNT; ++Idx) {
+        mReadbacks[Idx].Buffer = 0;
+        mReadbacks[Idx].Fence = 0;
+        mReadbacks[Idx].Width = 0;
+        mReadbacks[Idx].Height = 0;
+        mReadbacks[Idx].Format = CAPTURE_PNG;
+        mReadbacks[Idx].Sequence = false;
+    }
+    mNext = 0;
+    mRecording = false;
+    mSequenceFormat = CAPTURE_RAW;
+    mSequenceFrame = 0;
+    mDropped = 0;
+    mStopping = false;
+}
+
+FrameCapture::~FrameCapture() {
+    // NOTE: Without a GL context only the worker can be stopped, Shutdown collects the readbacks
+    if (mWorker.joinable()) {
+        {
+            std::lock_guard<std::mutex> Lock(mMutex);
+            mStopping = true;
+        }
+        mWake.notify_one();
+        mWorker.join();
+    }
+}
+
+void
+FrameCapture::Init() {
+    for (unsigned Idx = 0; Idx < CAPTURE_PBO_COUNT; ++Idx) glGenBuffers(1, &mReadbacks[Idx].Buffer);
+    mWorker = std::thread(&FrameCapture::work, this);
+}
+
+void
+FrameCapture::RequestScreenshot(const std::string& path) {
+    mScreenshotPath = path;
+}
+
+void
+FrameCapture::ToggleSequence(const std::string& prefix, CaptureFormat format) {
+    mRecording = !mRecording;
+    mSequencePrefix = prefix;
+    mSequenceFormat = format;
+    mSequenceFrame = 0;
+    std::cout << (mRecording ? "Recording frames to " : "Stopped recording ") << prefix << std::endl;
+}
+
+void
+FrameCapture::collect(Readback& readback, bool wait) {
+    if (!readback.Fence) return;
+
+    GLenum Status = glClientWaitSync(readback.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+    if (Status == GL_TIMEOUT_EXPIRED && !wait) return;
+    glDeleteSync(readback.Fence);
+    readback.Fence = 0;
+    if (Status == GL_WAIT_FAILED || Status == GL_TIMEOUT_EXPIRED) {
+        std::cerr << "[Err] Frame capture readback failed" << std::endl;
+        return;
+    }
+
+    Job CurrJob;
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        // NOTE: Screenshots are always kept, sequences drop frames instead of queueing without bound
+        if (readback.Sequence && mJobs.size() >= CAPTURE_MAX_PENDING) {
+            mDropped++;
+            return;
+        }
+        if (!mFreeBuffers.empty()) {
+            CurrJob.Pixels.swap(mFreeBuffers.back());
+            mFreeBuffers.pop_back();
+        }
+    }
+
+    size_t Size = (size_t)readback.Width * readback.Height * 4;
+    GLState.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+    void* Mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, Size, GL_MAP_READ_BIT);
+    if (!Mapped) {
+        std::cerr << "[Err] Failed to map frame capture buffer" << std::endl;
+        GLState.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return;
+    }
+    CurrJob.Pixels.resize(Size);
+    std::memcpy(CurrJob.Pixels.data(), Mapped, Size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    GLState.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    CurrJob.Width = readback.Width;
+    CurrJob.Height = readback.Height;
+    CurrJob.Path = readback.Path;
+    CurrJob.Format = readback.Format;
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mJobs.push_back(std::move(CurrJob));
+    }
+    mWake.notify_one();
+}
+
+void
+FrameCapture::Capture(int width, int height) {
+    for (unsigned Idx = 0; Idx < CAPTURE_PBO_COUNT; ++Idx) collect(mReadbacks[Idx], false);
+
+    bool Screenshot = !mScreenshotPath.empty();
+    if (!Screenshot && !mRecording) return;
+    if (width <= 0 || height <= 0 || !mReadbacks[0].Buffer) return;
+
+    // NOTE: Only waits if the GPU is more than CAPTURE_PBO_COUNT frames behind
+    Readback& Target = mReadbacks[mNext];
+    collect(Target, true);
+    mNext = (mNext + 1) % CAPTURE_PBO_COUNT;
+
+    GLState.BindBuffer(GL_PIXEL_PACK_BUFFER, Target.Buffer);
+    if (Target.Width != width || Target.Height != height) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, NULL, GL_STREAM_READ);
+        Target.Width = width;
+        Target.Height = height;
+    }
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    GLState.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    Target.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // NOTE: A screenshot takes the frame, a running sequence continues on the next one
+    if (Screenshot) {
+        Target.Path = mScreenshotPath;
+        Target.Format = CAPTURE_PNG;
+        Target.Sequence = false;
+        mScreenshotPath.clear();
+        return;
+    }
+    char Index[16];
+    snprintf(Index, sizeof(Index), "_%06u", mSequenceFrame++);
+    Target.Format = mSequenceFormat;
+    Target.Sequence = true;
+    Target.Path = mSequencePrefix + Index;
+    if (mSequenceFormat == CAPTURE_RAW) Target.Path += "_" + std::to_string(width) + "x" + std::to_string(height) + ".rgba";
+    else Target.Path += ".png";
+}
+
+void
+FrameCapture::Shutdown() {
+    for (unsigned Idx = 0; Idx < CAPTURE_PBO_COUNT; ++Idx) collect(mReadbacks[Idx], true);
+    if (!mWorker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_one();
+    mWorker.join();
+}
+
+void
+FrameCapture::work() {
+    std::unique_lock<std::mutex> Lock(mMutex);
+    while (true) {
+        mWake.wait(Lock, [this] { return mStopping || !mJobs.empty(); });
+        // NOTE: Queued jobs are still written when stopping
+        if (mJobs.empty()) return;
+
+        Job CurrJob = std::move(mJobs.front());
+        mJobs.pop_front();
+        Lock.unlock();
+        bool Written = CurrJob.Format == CAPTURE_PNG
+            ? writePng(CurrJob.Path, CurrJob.Pixels, CurrJob.Width, CurrJob.Height)
+            : writeRaw(CurrJob.Path, CurrJob.Pixels, CurrJob.Width, CurrJob.Height);
+        if (!Written) std::cerr << "[Err] Failed to write " << CurrJob.Path << std::endl;
+        Lock.lock();
+        mFreeBuffers.push_back(std::move(CurrJob.Pixels));
+    }
+}
+
+bool
+FrameCapture::IsRecording() const {
+    return mRecording;
+}
+
+unsigned
+FrameCapture::GetDroppedFrames() const {
+    return mDropped;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+// NOTE: Readbacks alternate between these, a frame's pixels are collected a frame later
+#define CAPTURE_PBO_COUNT 2
+// NOTE: Sequence frames waiting to be written past this are dropped so the game never waits on the disk
+#define CAPTURE_MAX_PENDING 8
+
+enum CaptureFormat {
+    CAPTURE_PNG,
+    // NOTE: Tightly packed RGBA8 rows from the top, size is in the file name
+    CAPTURE_RAW,
+};
+
+/**
+ * @brief Screenshots and frame sequences without stalling the frame. The back
+ * buffer is read into one of CAPTURE_PBO_COUNT pixel pack buffers with a fence
+ * behind it, the buffer is mapped only once the fence has signalled, a frame
+ * or more later. Mapped pixels are handed to a worker thread that flips and
+ * encodes them, so neither the GPU readback nor the file write is waited on
+ */
+class FrameCapture {
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    /**
+     * @brief Creates the pixel pack buffers and starts the worker thread
+     *
+     */
+    void Init();
+
+    /**
+     * @brief Captures the next frame into a PNG
+     *
+     * @param path - Output file
+     *
+     */
+    void RequestScreenshot(const std::string& path);
+
+    /**
+     * @brief Starts capturing every frame, or stops if already capturing
+     *
+     * @param prefix - Frames are written to prefix_000000 and up, plus the extension
+     * @param format - File format of the frames
+     *
+     */
+    void ToggleSequence(const std::string& prefix, CaptureFormat format);
+
+    /**
+     * @brief Queues the readback of the current back buffer if anything is
+     * being captured and hands finished readbacks to the worker. Call after the
+     * frame is drawn, before the swap
+     *
+     * @param width - Framebuffer width in pixels
+     * @param height - Framebuffer height in pixels
+     *
+     */
+    void Capture(int width, int height);
+
+    /**
+     * @brief Collects outstanding readbacks, waits for the worker to write
+     * everything and stops it. Needs the GL context
+     *
+     */
+    void Shutdown();
+
+    bool IsRecording() const;
+
+    /**
+     * @returns Sequence frames dropped because the worker fell behind
+     */
+    unsigned GetDroppedFrames() const;
+
+private:
+    struct Job {
+        std::vector<unsigned char> Pixels;
+        int Width;
+        int Height;
+        std::string Path;
+        CaptureFormat Format;
+    };
+
+    struct Readback {
+        unsigned Buffer;
+        GLsync Fence;
+        int Width;
+        int Height;
+        std::string Path;
+        CaptureFormat Format;
+        // NOTE: Part of a sequence, may be dropped when the worker falls behind
+        bool Sequence;
+    };
+
+    Readback mReadbacks[CAPTURE_PBO_COUNT];
+    unsigned mNext;
+    std::string mScreenshotPath;
+    bool mRecording;
+    std::string mSequencePrefix;
+    CaptureFormat mSequenceFormat;
+    unsigned mSequenceFrame;
+    unsigned mDropped;
+
+    std::thread mWorker;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<Job> mJobs;
+    // NOTE: Pixel storage of written jobs, reused so steady recording doesn't allocate
+    std::vector<std::vector<unsigned char>> mFreeBuffers;
+    bool mStopping;
+
+    /**
+     * @brief Maps a finished readback and queues it for the worker
+     *
+     * @param wait - Block until the readback is done instead of skipping it
+     *
+     */
+    void collect(Readback& readback, bool wait);
+    void work();
+};
@@ -0,0 +1,180 @@
+#include "clustered_lights.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+#include <cmath>
+
+static int
+clusterSlice(float depth, float sliceScale, float sliceBias) {
+    int Slice = (int)std::floor(std::log(depth) * sliceScale - sliceBias);
+    return std::min(std::max(Slice, 0), CLUSTER_Z - 1);
+}
+
+static int
+clusterTile(float ndc, int tiles) {
+    int Tile = (int)std::floor((ndc * 0.5f + 0.5f) * tiles);
+    return std::min(std::max(Tile, 0), tiles - 1);
+}
+
+ClusteredLights::ClusteredLights() {
+    mGridBuffer = 0;
+    mIndexBuffer = 0;
+    mLightBuffer = 0;
+    mGridTexture = 0;
+    mIndexTexture = 0;
+    mLightTexture = 0;
+    mSliceScale = 0.0f;
+    mSliceBias = 0.0f;
+    mMaxClusterLights = 0;
+}
+
+unsigned
+ClusteredLights::createBufferTexture(unsigned buffer, GLenum format) {
+    unsigned Texture;
+    glGenTextures(1, &Texture);
+    GLState.BindTexture(0, GL_TEXTURE_BUFFER, Texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    return Texture;
+}
+
+void
+ClusteredLights::Init() {
+    unsigned Buffers[3];
+    glGenBuffers(3, Buffers);
+    mGridBuffer = Buffers[0];
+    mIndexBuffer = Buffers[1];
+    mLightBuffer = Buffers[2];
+
+    // NOTE: Storage has to exist before glTexBuffer, Build reallocates it every frame anyway
+    GLState.BindBuffer(GL_TEXTURE_BUFFER, mGridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, CLUSTER_COUNT * 2 * sizeof(unsigned), NULL, GL_STREAM_DRAW);
+    GLState.BindBuffer(GL_TEXTURE_BUFFER, mIndexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned), NULL, GL_STREAM_DRAW);
+    GLState.BindBuffer(GL_TEXTURE_BUFFER, mLightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(Light), NULL, GL_STREAM_DRAW);
+    GLState.BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    mGridTexture = createBufferTexture(mGridBuffer, GL_RG32UI);
+    mIndexTexture = createBufferTexture(mIndexBuffer, GL_R32UI);
+    mLightTexture = createBufferTexture(mLightBuffer, GL_RGBA32F);
+    GLState.BindTexture(0, GL_TEXTURE_BUFFER, 0);
+
+    mGrid.assign(CLUSTER_COUNT * 2, 0);
+}
+
+void
+ClusteredLights::SetupShader(Shader& shader) const {
+    GLState.UseProgram(shader.GetId());
+    shader.SetUniform1i("uClusterGrid", CLUSTER_GRID_UNIT);
+    shader.SetUniform1i("uClusterIndices", CLUSTER_INDEX_UNIT);
+    shader.SetUniform1i("uClusterLights", CLUSTER_LIGHT_UNIT);
+    glUniform3ui(glGetUniformLocation(shader.GetId(), "uClusterDims"), CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+}
+
+void
+ClusteredLights::Begin() {
+    mLights.clear();
+}
+
+void
+ClusteredLights::AddLight(const glm::vec3& position, float radius, const glm::vec3& color) {
+    if (mLights.size() >= CLUSTER_MAX_LIGHTS) return;
+    Light NewLight = { glm::vec4(position, radius), glm::vec4(color, 0.0f) };
+    mLights.push_back(NewLight);
+}
+
+void
+ClusteredLights::Build(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane) {
+    float LogRatio = std::log(farPlane / nearPlane);
+    mSliceScale = CLUSTER_Z / LogRatio;
+    mSliceBias = CLUSTER_Z * std::log(nearPlane) / LogRatio;
+
+    mEntries.clear();
+    for (unsigned LightIdx = 0; LightIdx < mLights.size(); ++LightIdx) {
+        glm::vec3 Center = glm::vec3(view * glm::vec4(glm::vec3(mLights[LightIdx].PositionRadius), 1.0f));
+        float Radius = mLights[LightIdx].PositionRadius.w;
+        float Depth = -Center.z;
+        if (Depth + Radius < nearPlane || Depth - Radius > farPlane) continue;
+
+        float NearDepth = std::max(Depth - Radius, nearPlane);
+        float FarDepth = std::min(Depth + Radius, farPlane);
+        int FirstSlice = clusterSlice(NearDepth, mSliceScale, mSliceBias);
+        int LastSlice = clusterSlice(FarDepth, mSliceScale, mSliceBias);
+
+        for (int Slice = FirstSlice; Slice <= LastSlice; ++Slice) {
+            // NOTE: Part of the sphere's depth range inside the slice, the screen extent of its
+            // view space box is widest at the near end for sides away from the axis, the far end otherwise
+            float SliceNear = std::max(nearPlane * std::pow(farPlane / nearPlane, (float)Slice / CLUSTER_Z), NearDepth);
+            float SliceFar = std::min(nearPlane * std::pow(farPlane / nearPlane, (float)(Slice + 1) / CLUSTER_Z), FarDepth);
+            float Left = Center.x - Radius;
+            float Right = Center.x + Radius;
+            float Bottom = Center.y - Radius;
+            float Top = Center.y + Radius;
+            int FirstX = clusterTile(projection[0][0] * Left / (Left < 0.0f ? SliceNear : SliceFar), CLUSTER_X);
+            int LastX = clusterTile(projection[0][0] * Right / (Right > 0.0f ? SliceNear : SliceFar), CLUSTER_X);
+            int FirstY = clusterTile(projection[1][1] * Bottom / (Bottom < 0.0f ? SliceNear : SliceFar), CLUSTER_Y);
+            int LastY = clusterTile(projection[1][1] * Top / (Top > 0.0f ? SliceNear : SliceFar), CLUSTER_Y);
+
+            for (int Y = FirstY; Y <= LastY; ++Y) {
+                for (int X = FirstX; X <= LastX; ++X) {
+                    mEntries.push_back(X + CLUSTER_X * (Y + CLUSTER_Y * Slice));
+                    mEntries.push_back(LightIdx);
+                }
+            }
+        }
+    }
+
+    // NOTE: Counting sort of the entries by cluster into one flat index list
+    std::fill(mGrid.begin(), mGrid.end(), 0);
+    for (unsigned EntryIdx = 0; EntryIdx < mEntries.size(); EntryIdx += 2) {
+        unsigned& Count = mGrid[mEntries[EntryIdx] * 2 + 1];
+        if (Count < CLUSTER_MAX_LIGHTS_PER_CLUSTER) Count++;
+    }
+
+    unsigned Offset = 0;
+    mMaxClusterLights = 0;
+    for (unsigned Cluster = 0; Cluster < CLUSTER_COUNT; ++Cluster) {
+        mGrid[Cluster * 2] = Offset;
+        Offset += mGrid[Cluster * 2 + 1];
+        mMaxClusterLights = std::max(mMaxClusterLights, mGrid[Cluster * 2 + 1]);
+        mGrid[Cluster * 2 + 1] = 0;
+    }
+
+    mIndices.resize(std::max(Offset, 1u));
+    for (unsigned EntryIdx = 0; EntryIdx < mEntries.size(); EntryIdx += 2) {
+        unsigned Cluster = mEntries[EntryIdx];
+        unsigned& Count = mGrid[Cluster * 2 + 1];
+        if (Count >= CLUSTER_MAX_LIGHTS_PER_CLUSTER) continue;
+        mIndices[mGrid[Cluster * 2] + Count++] = mEntries[EntryIdx + 1];
+    }
+
+    // NOTE: Orphaning each buffer lets the driver hand out fresh storage while last frame still reads the old one
+    GLState.BindBuffer(GL_TEXTURE_BUFFER, mGridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, mGrid.size() * sizeof(unsigned), mGrid.data(), GL_STREAM_DRAW);
+    GLState.BindBuffer(GL_TEXTURE_BUFFER, mIndexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, mIndices.size() * sizeof(unsigned), mIndices.data(), GL_STREAM_DRAW);
+    if (!mLights.empty()) {
+        GLState.BindBuffer(GL_TEXTURE_BUFFER, mLightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, mLights.size() * sizeof(Light), mLights.data(), GL_STREAM_DRAW);
+    }
+    GLState.BindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void
+ClusteredLights::Apply(Shader& shader, const glm::ivec2& viewportSize) const {
+    shader.SetUniform2f("uClusterTileScale", glm::vec2((float)CLUSTER_X / viewportSize.x, (float)CLUSTER_Y / viewportSize.y));
+    shader.SetUniform1f("uClusterSliceScale", mSliceScale);
+    shader.SetUniform1f("uClusterSliceBias", mSliceBias);
+    GLState.BindTexture(CLUSTER_GRID_UNIT, GL_TEXTURE_BUFFER, mGridTexture);
+    GLState.BindTexture(CLUSTER_INDEX_UNIT, GL_TEXTURE_BUFFER, mIndexTexture);
+    GLState.BindTexture(CLUSTER_LIGHT_UNIT, GL_TEXTURE_BUFFER, mLightTexture);
+}
+
+unsigned
+ClusteredLights::GetLightCount() const {
+    return mLights.size();
+}
+
+unsigned
+ClusteredLights::GetMaxClusterLights() const {
+    return mMaxClusterLights;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+// NOTE: Froxel grid, tiles across the screen times depth slices spaced exponentially
+// between the near and far plane so near slices stay thin
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define CLUSTER_MAX_LIGHTS 1024
+// NOTE: Bounds the per-fragment cost, lights past it in a crowded cluster are dropped
+#define CLUSTER_MAX_LIGHTS_PER_CLUSTER 32
+// NOTE: Texture units of the buffer textures, 0 and 1 hold the material
+#define CLUSTER_GRID_UNIT 2
+#define CLUSTER_INDEX_UNIT 3
+#define CLUSTER_LIGHT_UNIT 4
+
+/**
+ * @brief Clustered forward shading for many point lights. Every frame the
+ * lights are binned on the CPU into a froxel grid of the view, the grid
+ * (offset and count per cluster), the flat light index list and the light
+ * data go to buffer textures, and the fragment shader walks only the lights
+ * of its own cluster
+ */
+class ClusteredLights {
+public:
+    ClusteredLights();
+
+    /**
+     * @brief Creates the buffers and their buffer textures
+     *
+     */
+    void Init();
+
+    /**
+     * @brief Sets the sampler units and grid size of a program reading the clusters
+     *
+     * @param shader - Program using the cluster uniforms of phong_material_texture.frag
+     *
+     */
+    void SetupShader(Shader& shader) const;
+
+    /**
+     * @brief Forgets last frame's lights
+     *
+     */
+    void Begin();
+
+    /**
+     * @brief Adds a light for this frame, ignored once CLUSTER_MAX_LIGHTS are in
+     *
+     * @param position - World position
+     * @param radius - Distance at which the light fades out completely
+     * @param color - Colour times intensity
+     *
+     */
+    void AddLight(const glm::vec3& position, float radius, const glm::vec3& color);
+
+    /**
+     * @brief Bins the lights into the clusters of the view and uploads everything
+     *
+     * @param view - View matrix
+     * @param projection - Perspective projection matrix
+     * @param nearPlane - Near plane distance of the projection
+     * @param farPlane - Far plane distance of the projection
+     *
+     */
+    void Build(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane);
+
+    /**
+     * @brief Binds the buffer textures and sets the per-frame uniforms on the bound program
+     *
+     * @param shader - Bound program set up with SetupShader
+     * @param viewportSize - Size in pixels of the viewport the scene is drawn into
+     *
+     */
+    void Apply(Shader& shader, const glm::ivec2& viewportSize) const;
+
+    unsigned GetLightCount() const;
+
+    /**
+     * @returns Most lights any cluster held after the last Build
+     */
+    unsigned GetMaxClusterLights() const;
+
+private:
+    struct Light {
+        glm::vec4 PositionRadius;
+        glm::vec4 Color;
+    };
+
+    unsigned mGridBuffer;
+    unsigned mIndexBuffer;
+    unsigned mLightBuffer;
+    unsigned mGridTexture;
+    unsigned mIndexTexture;
+    unsigned mLightTexture;
+    float mSliceScale;
+    float mSliceBias;
+    unsigned mMaxClusterLights;
+    std::vector<Light> mLights;
+    // NOTE: Scratch kept between frames so binning doesn't allocate, entries are cluster and light pairs
+    std::vector<unsigned> mEntries;
+    std::vector<unsigned> mGrid;
+    std::vector<unsigned> mIndices;
+
+    unsigned createBufferTexture(unsigned buffer, GLenum format);
+};
@@ -0,0 +1,274 @@
+#include <glm/glm.hpp>
+#include <glm/geometric.hpp>
+#include "collision.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+static bool sameDirection(const glm::vec3& a, const glm::vec3& b) {
+    return glm::dot(a, b) > 0.0f;
+}
+
+static bool lineSimplex(Simplex& simplex, glm::vec3& direction) {
+    glm::vec3 a = simplex.Points[0];
+    glm::vec3 b = simplex.Points[1];
+    glm::vec3 ab = b - a;
+    glm::vec3 ao = -a;
+
+    if (sameDirection(ab, ao)) {
+        direction = glm::cross(glm::cross(ab, ao), ab);
+    }
+    else {
+        simplex.Size = 1;
+        direction = ao;
+    }
+    return false;
+}
+
+static bool triangleSimplex(Simplex& simplex, glm::vec3& direction) {
+    glm::vec3 a = simplex.Points[0];
+    glm::vec3 b = simplex.Points[1];
+    glm::vec3 c = simplex.Points[2];
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ao = -a;
+    glm::vec3 abc = glm::cross(ab, ac);
+
+    if (sameDirection(glm::cross(abc, ac), ao)) {
+        if (sameDirection(ac, ao)) {
+            simplex.Points[1] = c;
+            simplex.Size = 2;
+            direction = glm::cross(glm::cross(ac, ao), ac);
+            return false;
+        }
+        simplex.Size = 2;
+        return lineSimplex(simplex, direction);
+    }
+
+    if (sameDirection(glm::cross(ab, abc), ao)) {
+        simplex.Size = 2;
+        return lineSimplex(simplex, direction);
+    }
+
+    if (sameDirection(abc, ao)) {
+        direction = abc;
+    }
+    else {
+        simplex.Points[1] = c;
+        simplex.Points[2] = b;
+        direction = -abc;
+    }
+    return false;
+}
+
+static bool tetrahedronSimplex(Simplex& simplex, glm::vec3& direction) {
+    glm::vec3 a = simplex.Points[0];
+    glm::vec3 b = simplex.Points[1];
+    glm::vec3 c = simplex.Points[2];
+    glm::vec3 d = simplex.Points[3];
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ad = d - a;
+    glm::vec3 ao = -a;
+
+    if (sameDirection(glm::cross(ab, ac), ao)) {
+        simplex.Size = 3;
+        return triangleSimplex(simplex, direction);
+    }
+    if (sameDirection(glm::cross(ac, ad), ao)) {
+        simplex.Points[1] = c;
+        simplex.Points[2] = d;
+        simplex.Size = 3;
+        return triangleSimplex(simplex, direction);
+    }
+    if (sameDirection(glm::cross(ad, ab), ao)) {
+        simplex.Points[1] = d;
+        simplex.Points[2] = b;
+        simplex.Size = 3;
+        return triangleSimplex(simplex, direction);
+    }
+    return true;
+}
+
+bool nextSimplex(Simplex& simplex, glm::vec3& direction) {
+    switch (simplex.Size) {
+    case 2: return lineSimplex(simplex, direction);
+    case 3: return triangleSimplex(simplex, direction);
+    case 4: return tetrahedronSimplex(simplex, direction);
+    }
+    return false;
+}
+
+void
+Polytope::Init(const Simplex& simplex) {
+    mVertexCount = 4;
+    mFaceCount = 0;
+    for (int i = 0; i < 4; ++i) mVertices[i] = simplex.Points[i];
+
+    addFace(0, 1, 2);
+    addFace(0, 3, 1);
+    addFace(0, 2, 3);
+    addFace(1, 3, 2);
+}
+
+bool
+Polytope::addFace(int a, int b, int c) {
+    if (mFaceCount >= EPA_MAX_FACES) return false;
+
+    glm::vec3 normal = glm::cross(mVertices[b] - mVertices[a], mVertices[c] - mVertices[a]);
+    float length = glm::length(normal);
+    float distance = FLT_MAX;
+    if (length > 1e-8f) {
+        normal /= length;
+        distance = glm::dot(normal, mVertices[a]);
+        // NOTE: Keep every face wound so its normal points away from the origin
+        if (distance < 0.0f) {
+            std::swap(b, c);
+            normal = -normal;
+            distance = -distance;
+        }
+    }
+
+    mFaces[mFaceCount][0] = a;
+    mFaces[mFaceCount][1] = b;
+    mFaces[mFaceCount][2] = c;
+    mNormals[mFaceCount] = normal;
+    mDistances[mFaceCount] = distance;
+    mFaceCount++;
+    return true;
+}
+
+void
+Polytope::removeFace(int face) {
+    mFaceCount--;
+    mFaces[face][0] = mFaces[mFaceCount][0];
+    mFaces[face][1] = mFaces[mFaceCount][1];
+    mFaces[face][2] = mFaces[mFaceCount][2];
+    mNormals[face] = mNormals[mFaceCount];
+    mDistances[face] = mDistances[mFaceCount];
+}
+
+int
+Polytope::ClosestFace() const {
+    int closest = 0;
+    for (int face = 1; face < mFaceCount; ++face) {
+        if (mDistances[face] < mDistances[closest]) closest = face;
+    }
+    return closest;
+}
+
+glm::vec3
+Polytope::FaceNormal(int face) const {
+    return mNormals[face];
+}
+
+float
+Polytope::FaceDistance(int face) const {
+    return mDistances[face];
+}
+
+bool
+Polytope::Expand(const glm::vec3& point) {
+    if (mVertexCount >= EPA_MAX_VERTICES) return false;
+
+    bool visible[EPA_MAX_FACES];
+    int edges[EPA_MAX_FACES * 3][2];
+    int edgeCount = 0;
+    int visibleCount = 0;
+
+    // NOTE: Edges shared by two visible faces cancel out, what remains is the horizon
+    for (int face = 0; face < mFaceCount; ++face) {
+        visible[face] = glm::dot(mNormals[face], point - mVertices[mFaces[face][0]]) > 0.0f;
+        if (!visible[face]) continue;
+        visibleCount++;
+
+        for (int e = 0; e < 3; ++e) {
+            int a = mFaces[face][e];
+            int b = mFaces[face][(e + 1) % 3];
+            bool shared = false;
+            for (int other = 0; other < edgeCount; ++other) {
+                if (edges[other][0] == b && edges[other][1] == a) {
+                    edges[other][0] = edges[edgeCount - 1][0];
+                    edges[other][1] = edges[edgeCount - 1][1];
+                    edgeCount--;
+                    shared = true;
+                    break;
+                }
+            }
+            if (!shared) {
+                edges[edgeCount][0] = a;
+                edges[edgeCount][1] = b;
+                edgeCount++;
+            }
+        }
+    }
+
+    if (!visibleCount || mFaceCount - visibleCount + edgeCount > EPA_MAX_FACES) return false;
+
+    for (int face = mFaceCount - 1; face >= 0; --face) {
+        if (visible[face]) removeFace(face);
+    }
+
+    int newVertex = mVertexCount++;
+    mVertices[newVertex] = point;
+    for (int edge = 0; edge < edgeCount; ++edge) {
+        addFace(edges[edge][0], edges[edge][1], newVertex);
+    }
+    return true;
+}
+
+bool sphereSphereContact(const Sphere& a, const Sphere& b, Contact& contact) {
+    glm::vec3 delta = a.Position - b.Position;
+    float distance = glm::length(delta);
+    float sumRadii = a.Radius + b.Radius;
+    if (distance >= sumRadii) return false;
+
+    contact.Normal = safeNormalize(delta);
+    contact.Depth = sumRadii - distance;
+    return true;
+}
+
+bool sphereBoxContact(const Sphere& sphere, const Box& box, Contact& contact) {
+    glm::vec3 local = glm::transpose(box.Axes) * (sphere.Position - box.Center);
+    glm::vec3 closest = glm::clamp(local, -box.HalfExtents, box.HalfExtents);
+    glm::vec3 delta = local - closest;
+    float distance2 = glm::dot(delta, delta);
+
+    if (distance2 > 0.0f) {
+        if (distance2 >= sphere.Radius * sphere.Radius) return false;
+        float distance = std::sqrt(distance2);
+        contact.Normal = box.Axes * (delta / distance);
+        contact.Depth = sphere.Radius - distance;
+        return true;
+    }
+
+    // NOTE: Center is inside the box, push out through the nearest face
+    int axis = 0;
+    float minGap = FLT_MAX;
+    for (int i = 0; i < 3; ++i) {
+        float gap = box.HalfExtents[i] - std::fabs(local[i]);
+        if (gap < minGap) {
+            minGap = gap;
+            axis = i;
+        }
+    }
+    contact.Normal = box.Axes[axis] * (local[axis] >= 0.0f ? 1.0f : -1.0f);
+    contact.Depth = minGap + sphere.Radius;
+    return true;
+}
+
+bool sphereCapsuleContact(const Sphere& sphere, const Capsule& capsule, Contact& contact) {
+    glm::vec3 ab = capsule.PointB - capsule.PointA;
+    float length2 = glm::dot(ab, ab);
+    float t = length2 > 0.0f ? glm::dot(sphere.Position - capsule.PointA, ab) / length2 : 0.0f;
+    t = glm::clamp(t, 0.0f, 1.0f);
+
+    glm::vec3 delta = sphere.Position - (capsule.PointA + t * ab);
+    float distance = glm::length(delta);
+    float sumRadii = sphere.Radius + capsule.Radius;
+    if (distance >= sumRadii) return false;
+
+    contact.Normal = safeNormalize(delta);
+    contact.Depth = sumRadii - distance;
+    return true;
+}
@@ -0,0 +1,214 @@
+#include <glm/glm.hpp>
+#include <glm/geometric.hpp>
+#include "physics.hpp"
+#ifndef COLLISION_HPP
+#define COLLISION_HPP
+
+const int GJK_MAX_ITERATIONS = 64;
+const int EPA_MAX_ITERATIONS = 32;
+const int EPA_MAX_VERTICES = EPA_MAX_ITERATIONS + 4;
+const int EPA_MAX_FACES = 2 * EPA_MAX_VERTICES;
+const float EPA_TOLERANCE = 0.001f;
+
+// NOTE: Normal points from the second shape towards the first one, moving the first
+// shape by Normal * Depth separates the pair
+struct Contact {
+    glm::vec3 Normal;
+    float Depth;
+};
+
+struct Simplex {
+    glm::vec3 Points[4];
+    int Size;
+};
+
+/**
+ * @brief Expanding polytope used by EPA. Kept in fixed size arrays so the
+ * narrowphase does not allocate
+ */
+class Polytope {
+public:
+    /**
+     * @brief Builds the initial polytope from a GJK tetrahedron
+     *
+     * @param simplex Simplex enclosing the origin
+     */
+    void Init(const Simplex& simplex);
+
+    /**
+     * @brief Returns the index of the face closest to the origin
+     */
+    int ClosestFace() const;
+
+    /**
+     * @brief Adds a support point, replacing every face that can see it
+     *
+     * @returns false when the polytope ran out of space
+     */
+    bool Expand(const glm::vec3& point);
+
+    glm::vec3 FaceNormal(int face) const;
+    float FaceDistance(int face) const;
+
+private:
+    glm::vec3 mVertices[EPA_MAX_VERTICES];
+    int mFaces[EPA_MAX_FACES][3];
+    glm::vec3 mNormals[EPA_MAX_FACES];
+    float mDistances[EPA_MAX_FACES];
+    int mVertexCount;
+    int mFaceCount;
+
+    bool addFace(int a, int b, int c);
+    void removeFace(int face);
+};
+
+/**
+ * @brief Evolves the simplex towards the origin
+ *
+ * @param simplex Current simplex, newest point first
+ * @param direction Next search direction
+ *
+ * @returns true if the simplex encloses the origin
+ */
+bool nextSimplex(Simplex& simplex, glm::vec3& direction);
+
+bool sphereSphereContact(const Sphere& a, const Sphere& b, Contact& contact);
+bool sphereBoxContact(const Sphere& sphere, const Box& box, Contact& contact);
+bool sphereCapsuleContact(const Sphere& sphere, const Capsule& capsule, Contact& contact);
+
+inline glm::vec3 shapeCenter(const Sphere& s) { return s.Position; }
+inline glm::vec3 shapeCenter(const Box& b) { return b.Center; }
+inline glm::vec3 shapeCenter(const Capsule& c) { return 0.5f * (c.PointA + c.PointB); }
+inline glm::vec3 shapeCenter(const ConvexHull& h) { return h.Position; }
+
+inline glm::vec3 safeNormalize(const glm::vec3& v) {
+    float len = glm::length(v);
+    return len > 1e-6f ? v / len : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+inline glm::vec3 supportPoint(const Sphere& s, const glm::vec3& direction) {
+    return s.Position + s.Radius * safeNormalize(direction);
+}
+
+inline glm::vec3 supportPoint(const Box& b, const glm::vec3& direction) {
+    glm::vec3 point = b.Center;
+    for (int axis = 0; axis < 3; ++axis) {
+        float side = glm::dot(direction, b.Axes[axis]) >= 0.0f ? 1.0f : -1.0f;
+        point += b.Axes[axis] * (b.HalfExtents[axis] * side);
+    }
+    return point;
+}
+
+inline glm::vec3 supportPoint(const Capsule& c, const glm::vec3& direction) {
+    glm::vec3 end = glm::dot(direction, c.PointB - c.PointA) >= 0.0f ? c.PointB : c.PointA;
+    return end + c.Radius * safeNormalize(direction);
+}
+
+inline glm::vec3 supportPoint(const ConvexHull& h, const glm::vec3& direction) {
+    glm::vec3 localDirection = glm::transpose(h.Rotation) * direction;
+    const glm::vec3* best = &h.Points[0];
+    float bestDot = glm::dot(*best, localDirection);
+    for (size_t i = 1; i < h.Points.size(); ++i) {
+        float d = glm::dot(h.Points[i], localDirection);
+        if (d > bestDot) {
+            bestDot = d;
+            best = &h.Points[i];
+        }
+    }
+    return h.Position + h.Rotation * (*best);
+}
+
+template<class ShapeA, class ShapeB>
+inline glm::vec3 minkowskiSupport(const ShapeA& a, const ShapeB& b, const glm::vec3& direction) {
+    return supportPoint(a, direction) - supportPoint(b, -direction);
+}
+
+template<class ShapeA, class ShapeB>
+bool gjkIntersect(const ShapeA& a, const ShapeB& b, Simplex& simplex) {
+    glm::vec3 direction = shapeCenter(b) - shapeCenter(a);
+    if (glm::dot(direction, direction) < 1e-12f) direction = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    simplex.Points[0] = minkowskiSupport(a, b, direction);
+    simplex.Size = 1;
+    direction = -simplex.Points[0];
+
+    for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; ++iteration) {
+        // NOTE: Origin sits on the simplex, treat as touching without penetration
+        if (glm::dot(direction, direction) < 1e-12f) return false;
+
+        glm::vec3 point = minkowskiSupport(a, b, direction);
+        if (glm::dot(point, direction) <= 0.0f) return false;
+
+        for (int i = simplex.Size; i > 0; --i) simplex.Points[i] = simplex.Points[i - 1];
+        simplex.Points[0] = point;
+        simplex.Size++;
+
+        if (nextSimplex(simplex, direction)) return true;
+    }
+    return false;
+}
+
+template<class ShapeA, class ShapeB>
+bool epaPenetration(const ShapeA& a, const ShapeB& b, const Simplex& simplex, Contact& contact) {
+    Polytope polytope;
+    polytope.Init(simplex);
+
+    int face = polytope.ClosestFace();
+    for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; ++iteration) {
+        glm::vec3 normal = polytope.FaceNormal(face);
+        glm::vec3 point = minkowskiSupport(a, b, normal);
+        if (glm::dot(normal, point) - polytope.FaceDistance(face) < EPA_TOLERANCE) break;
+        if (!polytope.Expand(point)) break;
+        face = polytope.ClosestFace();
+    }
+
+    contact.Normal = -polytope.FaceNormal(face);
+    contact.Depth = polytope.FaceDistance(face);
+    return contact.Depth > 0.0f;
+}
+
+template<class ShapeA, class ShapeB>
+bool gjkEpaContact(const ShapeA& a, const ShapeB& b, Contact& contact) {
+    Simplex simplex;
+    if (!gjkIntersect(a, b, simplex)) return false;
+    return epaPenetration(a, b, simplex, contact);
+}
+
+/**
+ * @brief Picks the narrowphase for a shape pair at compile time. Pairs without
+ * a specialization go through GJK/EPA, sphere pairs keep their analytic tests
+ */
+template<class ShapeA, class ShapeB>
+struct Narrowphase {
+    static bool Collide(const ShapeA& a, const ShapeB& b, Contact& contact) {
+        return gjkEpaContact(a, b, contact);
+    }
+};
+
+template<>
+struct Narrowphase<Sphere, Sphere> {
+    static bool Collide(const Sphere& a, const Sphere& b, Contact& contact) {
+        return sphereSphereContact(a, b, contact);
+    }
+};
+
+template<>
+struct Narrowphase<Sphere, Box> {
+    static bool Collide(const Sphere& a, const Box& b, Contact& contact) {
+        return sphereBoxContact(a, b, contact);
+    }
+};
+
+template<>
+struct Narrowphase<Sphere, Capsule> {
+    static bool Collide(const Sphere& a, const Capsule& b, Contact& contact) {
+        return sphereCapsuleContact(a, b, contact);
+    }
+};
+
+template<class ShapeA, class ShapeB>
+inline bool collideShapes(const ShapeA& a, const ShapeB& b, Contact& contact) {
+    return Narrowphase<ShapeA, ShapeB>::Collide(a, b, contact);
+}
+
+#endif
@@ -0,0 +1,165 @@
+#include "culling.hpp"
+#include <algorithm>
+#include <cmath>
+#ifdef FRUSTUM_SIMD
+#include <emmintrin.h>
+#endif
+
+BoundingSphere
+transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& model) {
+    glm::vec4 Center = model * glm::vec4(sphere.Center, 1.0f);
+    float ScaleX = glm::length(glm::vec3(model[0].x, model[0].y, model[0].z));
+    float ScaleY = glm::length(glm::vec3(model[1].x, model[1].y, model[1].z));
+    float ScaleZ = glm::length(glm::vec3(model[2].x, model[2].y, model[2].z));
+    BoundingSphere Result;
+    Result.Center = glm::vec3(Center.x, Center.y, Center.z);
+    Result.Radius = sphere.Radius * std::max(ScaleX, std::max(ScaleY, ScaleZ));
+    return Result;
+}
+
+Frustum::Frustum() {
+    // NOTE: Padding planes always pass, a point is at distance 1 from them
+    for (unsigned PlaneIdx = 0; PlaneIdx < FRUSTUM_PADDED_PLANE_COUNT; ++PlaneIdx) {
+        mPlaneX[PlaneIdx] = 0.0f;
+        mPlaneY[PlaneIdx] = 0.0f;
+        mPlaneZ[PlaneIdx] = 0.0f;
+        mPlaneW[PlaneIdx] = 1.0f;
+    }
+}
+
+void
+Frustum::Extract(const glm::mat4& viewProjection) {
+    // NOTE: glm is column major, row i is viewProjection[column][i]
+    glm::vec4 Rows[4];
+    for (int Row = 0; Row < 4; ++Row) {
+        Rows[Row] = glm::vec4(viewProjection[0][Row], viewProjection[1][Row], viewProjection[2][Row], viewProjection[3][Row]);
+    }
+
+    glm::vec4 Planes[FRUSTUM_PLANE_COUNT] = {
+        Rows[3] + Rows[0], // Left
+        Rows[3] - Rows[0], // Right
+        Rows[3] + Rows[1], // Bottom
+        Rows[3] - Rows[1], // Top
+        Rows[3] + Rows[2], // Near
+        Rows[3] - Rows[2], // Far
+    };
+
+    for (unsigned PlaneIdx = 0; PlaneIdx < FRUSTUM_PLANE_COUNT; ++PlaneIdx) {
+        glm::vec4 Plane = Planes[PlaneIdx];
+        float Length = glm::length(glm::vec3(Plane.x, Plane.y, Plane.z));
+        if (Length > 0.0f) Plane = Plane / Length;
+        mPlaneX[PlaneIdx] = Plane.x;
+        mPlaneY[PlaneIdx] = Plane.y;
+        mPlaneZ[PlaneIdx] = Plane.z;
+        mPlaneW[PlaneIdx] = Plane.w;
+    }
+}
+
+#ifdef FRUSTUM_SIMD
+
+bool
+Frustum::TestSphere(const glm::vec3& center, float radius) const {
+    __m128 CenterX = _mm_set1_ps(center.x);
+    __m128 CenterY = _mm_set1_ps(center.y);
+    __m128 CenterZ = _mm_set1_ps(center.z);
+    __m128 NegRadius = _mm_set1_ps(-radius);
+
+    for (unsigned PlaneIdx = 0; PlaneIdx < FRUSTUM_PADDED_PLANE_COUNT; PlaneIdx += 4) {
+        __m128 Distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_load_ps(mPlaneX + PlaneIdx), CenterX), _mm_mul_ps(_mm_load_ps(mPlaneY + PlaneIdx), CenterY)),
+            _mm_add_ps(_mm_mul_ps(_mm_load_ps(mPlaneZ + PlaneIdx), CenterZ), _mm_load_ps(mPlaneW + PlaneIdx)));
+        if (_mm_movemask_ps(_mm_cmplt_ps(Distance, NegRadius))) return false;
+    }
+    return true;
+}
+
+bool
+Frustum::TestAABB(const AABB& box) const {
+    __m128 MinX = _mm_set1_ps(box.Min.x);
+    __m128 MinY = _mm_set1_ps(box.Min.y);
+    __m128 MinZ = _mm_set1_ps(box.Min.z);
+    __m128 MaxX = _mm_set1_ps(box.Max.x);
+    __m128 MaxY = _mm_set1_ps(box.Max.y);
+    __m128 MaxZ = _mm_set1_ps(box.Max.z);
+    __m128 Zero = _mm_setzero_ps();
+
+    // NOTE: Per axis the corner furthest along the plane normal gives max(n * min, n * max)
+    for (unsigned PlaneIdx = 0; PlaneIdx < FRUSTUM_PADDED_PLANE_COUNT; PlaneIdx += 4) {
+        __m128 PlaneX = _mm_load_ps(mPlaneX + PlaneIdx);
+        __m128 PlaneY = _mm_load_ps(mPlaneY + PlaneIdx);
+        __m128 PlaneZ = _mm_load_ps(mPlaneZ + PlaneIdx);
+        __m128 Distance = _mm_add_ps(
+            _mm_add_ps(_mm_max_ps(_mm_mul_ps(PlaneX, MinX), _mm_mul_ps(PlaneX, MaxX)), _mm_max_ps(_mm_mul_ps(PlaneY, MinY), _mm_mul_ps(PlaneY, MaxY))),
+            _mm_add_ps(_mm_max_ps(_mm_mul_ps(PlaneZ, MinZ), _mm_mul_ps(PlaneZ, MaxZ)), _mm_load_ps(mPlaneW + PlaneIdx)));
+        if (_mm_movemask_ps(_mm_cmplt_ps(Distance, Zero))) return false;
+    }
+    return true;
+}
+
+unsigned
+Frustum::CullSpheres(const glm::vec4* spheres, unsigned count, unsigned* visible) const {
+    unsigned VisibleCount = 0;
+    unsigned SphereIdx = 0;
+    for (; SphereIdx + 4 <= count; SphereIdx += 4) {
+        __m128 CenterX = _mm_loadu_ps(&spheres[SphereIdx].x);
+        __m128 CenterY = _mm_loadu_ps(&spheres[SphereIdx + 1].x);
+        __m128 CenterZ = _mm_loadu_ps(&spheres[SphereIdx + 2].x);
+        __m128 Radius = _mm_loadu_ps(&spheres[SphereIdx + 3].x);
+        _MM_TRANSPOSE4_PS(CenterX, CenterY, CenterZ, Radius);
+        __m128 NegRadius = _mm_sub_ps(_mm_setzero_ps(), Radius);
+
+        __m128 Outside = _mm_setzero_ps();
+        for (unsigned PlaneIdx = 0; PlaneIdx < FRUSTUM_PLANE_COUNT; ++PlaneIdx) {
+            __m128 Distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(mPlaneX[PlaneIdx]), CenterX), _mm_mul_ps(_mm_set1_ps(mPlaneY[PlaneIdx]), CenterY)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(mPlaneZ[PlaneIdx]), CenterZ), _mm_set1_ps(mPlaneW[PlaneIdx])));
+            Outside = _mm_or_ps(Outside, _mm_cmplt_ps(Distance, NegRadius));
+        }
+
+        int OutsideMask = _mm_movemask_ps(Outside);
+        for (unsigned Lane = 0; Lane < 4; ++Lane) {
+            if (!(OutsideMask & (1 << Lane))) visible[VisibleCount++] = SphereIdx + Lane;
+        }
+    }
+
+    for (; SphereIdx < count; ++SphereIdx) {
+        const glm::vec4& Sphere = spheres[SphereIdx];
+        if (TestSphere(glm::vec3(Sphere.x, Sphere.y, Sphere.z), Sphere.w)) visible[VisibleCount++] = SphereIdx;
+    }
+    return VisibleCount;
+}
+
+#else
+
+bool
+Frustum::TestSphere(const glm::vec3& center, float radius) const {
+    for (unsigned PlaneIdx = 0; PlaneIdx < FRUSTUM_PLANE_COUNT; ++PlaneIdx) {
+        float Distance = mPlaneX[PlaneIdx] * center.x + mPlaneY[PlaneIdx] * center.y + mPlaneZ[PlaneIdx] * center.z + mPlaneW[PlaneIdx];
+        if (Distance < -radius) return false;
+    }
+    return true;
+}
+
+bool
+Frustum::TestAABB(const AABB& box) const {
+    for (unsigned PlaneIdx = 0; PlaneIdx < FRUSTUM_PLANE_COUNT; ++PlaneIdx) {
+        float Distance = std::max(mPlaneX[PlaneIdx] * box.Min.x, mPlaneX[PlaneIdx] * box.Max.x)
+            + std::max(mPlaneY[PlaneIdx] * box.Min.y, mPlaneY[PlaneIdx] * box.Max.y)
+            + std::max(mPlaneZ[PlaneIdx] * box.Min.z, mPlaneZ[PlaneIdx] * box.Max.z)
+            + mPlaneW[PlaneIdx];
+        if (Distance < 0.0f) return false;
+    }
+    return true;
+}
+
+unsigned
+Frustum::CullSpheres(const glm::vec4* spheres, unsigned count, unsigned* visible) const {
+    unsigned VisibleCount = 0;
+    for (unsigned SphereIdx = 0; SphereIdx < count; ++SphereIdx) {
+        const glm::vec4& Sphere = spheres[SphereIdx];
+        if (TestSphere(glm::vec3(Sphere.x, Sphere.y, Sphere.z), Sphere.w)) visible[VisibleCount++] = SphereIdx;
+    }
+    return VisibleCount;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SIMD 1
+#endif
+
+// NOTE: Six planes, padded to eight so two 4-wide registers cover them
+#define FRUSTUM_PLANE_COUNT 6
+#define FRUSTUM_PADDED_PLANE_COUNT 8
+
+struct BoundingSphere {
+    glm::vec3 Center;
+    float Radius;
+};
+
+struct AABB {
+    glm::vec3 Min;
+    glm::vec3 Max;
+};
+
+struct CullStats {
+    unsigned Visible;
+    unsigned Culled;
+};
+
+/**
+ * @brief Moves a local bounding sphere into world space. Radius is scaled by
+ * the largest axis scale so non-uniform scaling stays conservative
+ *
+ * @param sphere - Local bounds
+ * @param model - Model matrix
+ *
+ * @returns World space bounds
+ */
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& model);
+
+/**
+ * @brief View frustum as six inward facing planes, stored one component per
+ * array so four planes or four spheres can be tested at once
+ */
+class Frustum {
+public:
+    Frustum();
+
+    /**
+     * @brief Extracts the planes from a combined projection * view matrix
+     *
+     * @param viewProjection - Projection * View
+     *
+     */
+    void Extract(const glm::mat4& viewProjection);
+
+    /**
+     * @returns true - Sphere is at least partially inside, false - Fully outside
+     */
+    bool TestSphere(const glm::vec3& center, float radius) const;
+
+    /**
+     * @returns true - Box is at least partially inside, false - Fully outside
+     */
+    bool TestAABB(const AABB& box) const;
+
+    /**
+     * @brief Culls a batch of world space spheres, four at a time
+     *
+     * @param spheres - Center in xyz, radius in w
+     * @param count - Number of spheres
+     * @param visible - Receives indices of visible spheres, must hold count entries
+     *
+     * @returns Number of visible spheres
+     */
+    unsigned CullSpheres(const glm::vec4* spheres, unsigned count, unsigned* visible) const;
+
+private:
+    alignas(16) float mPlaneX[FRUSTUM_PADDED_PLANE_COUNT];
+    alignas(16) float mPlaneY[FRUSTUM_PADDED_PLANE_COUNT];
+    alignas(16) float mPlaneZ[FRUSTUM_PADDED_PLANE_COUNT];
+    alignas(16) float mPlaneW[FRUSTUM_PADDED_PLANE_COUNT];
+};
@@ -0,0 +1,176 @@
+#include "dynamic_resolution.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+#include <iostream>
+
+DynamicResolution::DynamicResolution() {
+    mShader = 0;
+    mFBO = 0;
+    mColorTexture = 0;
+    mDepthBuffer = 0;
+    mEmptyVAO = 0;
+    mWidth = 0;
+    mHeight = 0;
+    mSceneWidth = 0;
+    mSceneHeight = 0;
+    mScale = DYNRES_MAX_SCALE;
+    mLocked = false;
+    mAverageTime = 0.0f;
+    mCooldown = 0;
+    mFrame = 1;
+    for (unsigned Idx = 0; Idx < DYNRES_TIMER_BUFFERS; ++Idx) {
+        mTimerQueries[Idx] = 0;
+        mIssuedFrames[Idx] = 0;
+    }
+}
+
+void
+DynamicResolution::Init(Shader* upscaleShader) {
+    mShader = upscaleShader;
+    glGenQueries(DYNRES_TIMER_BUFFERS, mTimerQueries);
+    glGenVertexArrays(1, &mEmptyVAO);
+
+    GLState.UseProgram(mShader->GetId());
+    mShader->SetUniform1i("uScene", 0);
+}
+
+bool
+DynamicResolution::allocate(int width, int height) {
+    release();
+    mWidth = width;
+    mHeight = height;
+
+    glGenTextures(1, &mColorTexture);
+    GLState.BindTexture(0, GL_TEXTURE_2D, mColorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenRenderbuffers(1, &mDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &mFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[Err] Dynamic resolution framebuffer incomplete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        release();
+        return false;
+    }
+
+    return true;
+}
+
+void
+DynamicResolution::release() {
+    if (!mFBO && !mColorTexture && !mDepthBuffer) return;
+    if (mFBO) glDeleteFramebuffers(1, &mFBO);
+    if (mColorTexture) glDeleteTextures(1, &mColorTexture);
+    if (mDepthBuffer) glDeleteRenderbuffers(1, &mDepthBuffer);
+    mFBO = 0;
+    mColorTexture = 0;
+    mDepthBuffer = 0;
+    // NOTE: Deleted names may be handed out again, the cached texture bindings can't be trusted
+    GLState.Invalidate();
+}
+
+void
+DynamicResolution::Update(float targetFrameTime) {
+    // NOTE: The oldest query is polled, a result the GPU doesn't have yet is skipped, never waited for
+    unsigned QueryIdx = mFrame % DYNRES_TIMER_BUFFERS;
+    if (!mIssuedFrames[QueryIdx]) return;
+
+    GLuint Available = 0;
+    glGetQueryObjectuiv(mTimerQueries[QueryIdx], GL_QUERY_RESULT_AVAILABLE, &Available);
+    if (!Available) return;
+
+    GLuint64 Nanoseconds = 0;
+    glGetQueryObjectui64v(mTimerQueries[QueryIdx], GL_QUERY_RESULT, &Nanoseconds);
+    mIssuedFrames[QueryIdx] = 0;
+    float SceneTime = Nanoseconds * 1e-9f;
+    mAverageTime = mAverageTime > 0.0f ? mAverageTime + (SceneTime - mAverageTime) * DYNRES_SMOOTHING : SceneTime;
+
+    if (mLocked) return;
+    if (mCooldown) {
+        mCooldown--;
+        return;
+    }
+
+    float Scale = mScale;
+    if (mAverageTime > targetFrameTime * DYNRES_DOWN_THRESHOLD) Scale = std::max(DYNRES_MIN_SCALE, mScale - DYNRES_STEP);
+    else if (mAverageTime < targetFrameTime * DYNRES_UP_THRESHOLD) Scale = std::min(DYNRES_MAX_SCALE, mScale + DYNRES_STEP);
+    if (Scale != mScale) {
+        mScale = Scale;
+        mCooldown = DYNRES_COOLDOWN_FRAMES;
+    }
+}
+
+void
+DynamicResolution::SetLocked(bool locked) {
+    mLocked = locked;
+    if (locked) {
+        mScale = DYNRES_MAX_SCALE;
+        mCooldown = DYNRES_COOLDOWN_FRAMES;
+    }
+}
+
+void
+DynamicResolution::Begin(int windowWidth, int windowHeight) {
+    if ((windowWidth != mWidth || windowHeight != mHeight) && windowWidth > 0 && windowHeight > 0) {
+        allocate(windowWidth, windowHeight);
+    }
+
+    // NOTE: Without a target the scene goes straight to the window at full size
+    float Scale = mFBO ? mScale : 1.0f;
+    mSceneWidth = std::max(1, (int)(mWidth * Scale + 0.5f));
+    mSceneHeight = std::max(1, (int)(mHeight * Scale + 0.5f));
+    glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+    glViewport(0, 0, mSceneWidth, mSceneHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    unsigned QueryIdx = mFrame % DYNRES_TIMER_BUFFERS;
+    glBeginQuery(GL_TIME_ELAPSED, mTimerQueries[QueryIdx]);
+    mIssuedFrames[QueryIdx] = mFrame;
+}
+
+void
+DynamicResolution::End() {
+    glEndQuery(GL_TIME_ELAPSED);
+    mFrame++;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, mWidth, mHeight);
+    if (!mFBO) return;
+
+    glDisable(GL_DEPTH_TEST);
+    GLState.UseProgram(mShader->GetId());
+    mShader->SetUniform2f("uScale", glm::vec2((float)mSceneWidth / mWidth, (float)mSceneHeight / mHeight));
+    mShader->SetUniform2f("uMaxUV", glm::vec2((mSceneWidth - 0.5f) / mWidth, (mSceneHeight - 0.5f) / mHeight));
+    GLState.BindVertexArray(mEmptyVAO);
+    GLState.BindTexture(0, GL_TEXTURE_2D, mColorTexture);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glEnable(GL_DEPTH_TEST);
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+float
+DynamicResolution::GetScale() const {
+    return mScale;
+}
+
+glm::ivec2
+DynamicResolution::GetSceneSize() const {
+    return glm::ivec2(mSceneWidth, mSceneHeight);
+}
+
+float
+DynamicResolution::GetSceneTime() const {
+    return mAverageTime;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+#define DYNRES_MIN_SCALE 0.5f
+#define DYNRES_MAX_SCALE 1.0f
+#define DYNRES_STEP 0.05f
+// NOTE: Scale drops above the first fraction of the frame budget and rises below the
+// second. The gap is wider than the cost of one step up, so a step never undoes itself
+#define DYNRES_DOWN_THRESHOLD 0.9f
+#define DYNRES_UP_THRESHOLD 0.7f
+// NOTE: Frames to wait after a change, lets the average settle at the new size
+#define DYNRES_COOLDOWN_FRAMES 20
+#define DYNRES_SMOOTHING 0.1f
+#define DYNRES_TIMER_BUFFERS 2
+
+/**
+ * @brief Renders the scene into an offscreen target whose resolution follows
+ * the GPU time of the scene against the frame budget, then upscales it to the
+ * window. The target is allocated at window size once and the scene is drawn
+ * into a scaled corner of it, so a scale change never reallocates
+ */
+class DynamicResolution {
+public:
+    DynamicResolution();
+
+    /**
+     * @brief Creates the timer queries and the empty VAO of the upscale pass
+     *
+     * @param upscaleShader - shaders/upscale program
+     *
+     */
+    void Init(Shader* upscaleShader);
+
+    /**
+     * @brief Reads the scene timing of an earlier frame if the GPU has it and
+     * moves the scale one step when the average leaves the hysteresis band
+     *
+     * @param targetFrameTime - Frame budget in seconds
+     *
+     */
+    void Update(float targetFrameTime);
+
+    /**
+     * @brief Holds the scale at full resolution while set, the scene time is
+     * still measured. Used while the startup benchmark compares quality tiers
+     *
+     */
+    void SetLocked(bool locked);
+
+    /**
+     * @brief Binds the offscreen target, sets the scaled viewport and clears it.
+     * Reallocates the target if the window size changed
+     *
+     * @param windowWidth - Framebuffer width in pixels
+     * @param windowHeight - Framebuffer height in pixels
+     *
+     */
+    void Begin(int windowWidth, int windowHeight);
+
+    /**
+     * @brief Binds the default framebuffer, restores the full viewport and
+     * draws the scene over the whole window. The window's depth is cleared so
+     * overlays drawn afterwards aren't tested against stale values
+     *
+     */
+    void End();
+
+    /**
+     * @returns Fraction of the window resolution on each axis the scene is rendered at
+     */
+    float GetScale() const;
+
+    /**
+     * @returns Viewport size in pixels the scene is drawn into this frame, valid after Begin
+     */
+    glm::ivec2 GetSceneSize() const;
+
+    /**
+     * @returns Smoothed GPU time of the scene in seconds
+     */
+    float GetSceneTime() const;
+
+private:
+    Shader* mShader;
+    unsigned mFBO;
+    unsigned mColorTexture;
+    unsigned mDepthBuffer;
+    unsigned mEmptyVAO;
+    int mWidth;
+    int mHeight;
+    int mSceneWidth;
+    int mSceneHeight;
+    float mScale;
+    bool mLocked;
+    float mAverageTime;
+    unsigned mCooldown;
+    unsigned mTimerQueries[DYNRES_TIMER_BUFFERS];
+    // NOTE: Frame each timer query was issued in, 0 for never
+    unsigned mIssuedFrames[DYNRES_TIMER_BUFFERS];
+    unsigned mFrame;
+
+    bool allocate(int width, int height);
+    void release();
+};
@@ -0,0 +1,196 @@
+#include "hud.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+#include <iostream>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+HudText::HudText() {
+    mShader = 0;
+    mAtlas = 0;
+    mVAO = 0;
+    mVBO = 0;
+    mLineHeight = 0.0f;
+    mAscender = 0.0f;
+    mFrameGlyphs = 0;
+    for (unsigned GlyphIdx = 0; GlyphIdx < HUD_GLYPH_COUNT; ++GlyphIdx) mGlyphs[GlyphIdx] = Glyph();
+}
+
+bool
+HudText::Init(Shader* shader, const std::string& fontPath, unsigned pixelHeight) {
+    FT_Library Library;
+    if (FT_Init_FreeType(&Library)) {
+        std::cerr << "[Err] Failed to initialize FreeType" << std::endl;
+        return false;
+    }
+    FT_Face Face;
+    if (FT_New_Face(Library, fontPath.c_str(), 0, &Face)) {
+        std::cerr << "[Err] Failed to load font " << fontPath << std::endl;
+        FT_Done_FreeType(Library);
+        return false;
+    }
+    FT_Set_Pixel_Sizes(Face, 0, pixelHeight);
+    mLineHeight = Face->size->metrics.height / 64.0f;
+    mAscender = Face->size->metrics.ascender / 64.0f;
+
+    // NOTE: Glyphs are packed in rows left to right, a row is as tall as its tallest glyph
+    std::vector<unsigned char> Pixels(HUD_ATLAS_SIZE * HUD_ATLAS_SIZE, 0);
+    unsigned PenX = 1;
+    unsigned PenY = 1;
+    unsigned RowHeight = 0;
+    for (unsigned GlyphIdx = 0; GlyphIdx < HUD_GLYPH_COUNT; ++GlyphIdx) {
+        if (FT_Load_Char(Face, HUD_FIRST_GLYPH + GlyphIdx, FT_LOAD_RENDER)) continue;
+        const FT_Bitmap& Bitmap = Face->glyph->bitmap;
+        if (PenX + Bitmap.width + 1 > HUD_ATLAS_SIZE) {
+            PenX = 1;
+            PenY += RowHeight + 1;
+            RowHeight = 0;
+        }
+        if (PenY + Bitmap.rows + 1 > HUD_ATLAS_SIZE) {
+            std::cerr << "[Err] HUD glyph atlas is full at pixel height " << pixelHeight << std::endl;
+            break;
+        }
+        for (unsigned Row = 0; Row < Bitmap.rows; ++Row) {
+            const unsigned char* Source = Bitmap.buffer + Row * Bitmap.pitch;
+            std::copy(Source, Source + Bitmap.width, Pixels.begin() + (PenY + Row) * HUD_ATLAS_SIZE + PenX);
+        }
+
+        Glyph& CurrGlyph = mGlyphs[GlyphIdx];
+        CurrGlyph.Size = glm::vec2((float)Bitmap.width, (float)Bitmap.rows);
+        CurrGlyph.Bearing = glm::vec2((float)Face->glyph->bitmap_left, (float)Face->glyph->bitmap_top);
+        CurrGlyph.Advance = Face->glyph->advance.x / 64.0f;
+        CurrGlyph.UVMin = glm::vec2((float)PenX, (float)PenY) / (float)HUD_ATLAS_SIZE;
+        CurrGlyph.UVMax = glm::vec2((float)(PenX + Bitmap.width), (float)(PenY + Bitmap.rows)) / (float)HUD_ATLAS_SIZE;
+        PenX += Bitmap.width + 1;
+        RowHeight = std::max(RowHeight, (unsigned)Bitmap.rows);
+    }
+    FT_Done_Face(Face);
+    FT_Done_FreeType(Library);
+
+    glGenTextures(1, &mAtlas);
+    GLState.BindTexture(0, GL_TEXTURE_2D, mAtlas);
+    // NOTE: Rows are tightly packed bytes, not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, HUD_ATLAS_SIZE, HUD_ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, Pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    mFrameVertices.reserve(HUD_MAX_GLYPHS * 6 * HUD_VERTEX_FLOATS);
+    glGenVertexArrays(1, &mVAO);
+    GLState.BindVertexArray(mVAO);
+    glGenBuffers(1, &mVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, HUD_MAX_GLYPHS * 6 * HUD_VERTEX_FLOATS * sizeof(float), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, HUD_VERTEX_FLOATS * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+
+    mShader = shader;
+    GLState.UseProgram(mShader->GetId());
+    mShader->SetUniform1i("uAtlas", 0);
+    return true;
+}
+
+glm::vec3
+HudText::layout(const std::string& text, const glm::vec2& position, std::vector<float>& vertices, unsigned maxGlyphs) const {
+    float FirstLineEnd = -1.0f;
+    glm::vec2 Pen(position.x, position.y + mAscender);
+    unsigned Written = 0;
+    for (unsigned CharIdx = 0; CharIdx < text.size(); ++CharIdx) {
+        unsigned char Char = text[CharIdx];
+        if (Char == '\n') {
+            if (FirstLineEnd < 0.0f) FirstLineEnd = Pen.x;
+            Pen = glm::vec2(position.x, Pen.y + mLineHeight);
+            continue;
+        }
+        if (Char < HUD_FIRST_GLYPH || Char >= HUD_FIRST_GLYPH + HUD_GLYPH_COUNT) continue;
+
+        const Glyph& CurrGlyph = mGlyphs[Char - HUD_FIRST_GLYPH];
+        if (CurrGlyph.Size.x > 0.0f && Written < maxGlyphs) {
+            // NOTE: y grows down the screen, the bearing is measured up from the baseline
+            glm::vec2 Min(Pen.x + CurrGlyph.Bearing.x, Pen.y - CurrGlyph.Bearing.y);
+            glm::vec2 Max = Min + CurrGlyph.Size;
+            float Quad[] = {
+                Min.x, Min.y, CurrGlyph.UVMin.x, CurrGlyph.UVMin.y,
+                Min.x, Max.y, CurrGlyph.UVMin.x, CurrGlyph.UVMax.y,
+                Max.x, Max.y, CurrGlyph.UVMax.x, CurrGlyph.UVMax.y,
+                Min.x, Min.y, CurrGlyph.UVMin.x, CurrGlyph.UVMin.y,
+                Max.x, Max.y, CurrGlyph.UVMax.x, CurrGlyph.UVMax.y,
+                Max.x, Min.y, CurrGlyph.UVMax.x, CurrGlyph.UVMin.y,
+            };
+            vertices.insert(vertices.end(), Quad, Quad + 6 * HUD_VERTEX_FLOATS);
+            Written++;
+        }
+        Pen.x += CurrGlyph.Advance;
+    }
+    if (FirstLineEnd < 0.0f) FirstLineEnd = Pen.x;
+    return glm::vec3(FirstLineEnd, Pen.x, (float)Written);
+}
+
+unsigned
+HudText::AddStatic(const std::string& text) {
+    Run CurrRun;
+    CurrRun.First = mStaticVertices.size() / (6 * HUD_VERTEX_FLOATS);
+    glm::vec3 Laid = layout(text, glm::vec2(0.0f), mStaticVertices, ~0u);
+    CurrRun.Count = (unsigned)Laid.z;
+    CurrRun.Width = Laid.x;
+    mRuns.push_back(CurrRun);
+    return mRuns.size() - 1;
+}
+
+void
+HudText::Begin() {
+    mFrameVertices.clear();
+    mFrameGlyphs = 0;
+}
+
+float
+HudText::DrawStatic(unsigned handle, const glm::vec2& position) {
+    const Run& CurrRun = mRuns[handle];
+    unsigned Count = std::min(CurrRun.Count, HUD_MAX_GLYPHS - mFrameGlyphs);
+    const float* Source = mStaticVertices.data() + CurrRun.First * 6 * HUD_VERTEX_FLOATS;
+    for (unsigned Vertex = 0; Vertex < Count * 6; ++Vertex) {
+        const float* Current = Source + Vertex * HUD_VERTEX_FLOATS;
+        float Placed[] = { Current[0] + position.x, Current[1] + position.y, Current[2], Current[3] };
+        mFrameVertices.insert(mFrameVertices.end(), Placed, Placed + HUD_VERTEX_FLOATS);
+    }
+    mFrameGlyphs += Count;
+    return position.x + CurrRun.Width;
+}
+
+float
+HudText::Print(const std::string& text, const glm::vec2& position) {
+    glm::vec3 Laid = layout(text, position, mFrameVertices, HUD_MAX_GLYPHS - mFrameGlyphs);
+    mFrameGlyphs += (unsigned)Laid.z;
+    return Laid.y;
+}
+
+void
+HudText::Render(int windowWidth, int windowHeight) {
+    if (!mShader || !mFrameGlyphs) return;
+
+    // NOTE: Orphan then fill, last frame's draw keeps its storage and nothing waits on it
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, HUD_MAX_GLYPHS * 6 * HUD_VERTEX_FLOATS * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, mFrameVertices.size() * sizeof(float), mFrameVertices.data());
+
+    GLState.UseProgram(mShader->GetId());
+    mShader->SetUniform2f("uScreenSize", glm::vec2((float)windowWidth, (float)windowHeight));
+    GLState.BindTexture(0, GL_TEXTURE_2D, mAtlas);
+    GLState.BindVertexArray(mVAO);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, mFrameGlyphs * 6);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
+float
+HudText::GetLineHeight() const {
+    return mLineHeight;
+}
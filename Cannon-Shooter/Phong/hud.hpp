@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+// NOTE: Printable ASCII, everything else is skipped
+#define HUD_FIRST_GLYPH 32
+#define HUD_GLYPH_COUNT 95
+#define HUD_ATLAS_SIZE 512
+// NOTE: Quads the frame buffer holds, text past it is dropped
+#define HUD_MAX_GLYPHS 4096
+// NOTE: Position in pixels and atlas UV
+#define HUD_VERTEX_FLOATS 4
+
+/**
+ * @brief Screen space text for the HUD. The font is rasterized with FreeType
+ * once into a single-channel atlas. Strings that don't change are laid out
+ * once into cached quad runs, per-frame text is laid out into the same frame
+ * buffer, and the whole HUD is drawn with one upload and one draw call
+ */
+class HudText {
+public:
+    HudText();
+
+    /**
+     * @brief Loads the font and rasterizes the glyph atlas
+     *
+     * @param shader - shaders/hud program
+     * @param fontPath - TrueType font file
+     * @param pixelHeight - Glyph height in pixels
+     *
+     * @returns true - Success, false - FreeType or the font failed to load
+     */
+    bool Init(Shader* shader, const std::string& fontPath, unsigned pixelHeight);
+
+    /**
+     * @brief Lays a string out once for repeated use
+     *
+     * @param text - String, lines break on \n
+     *
+     * @returns Handle for DrawStatic
+     */
+    unsigned AddStatic(const std::string& text);
+
+    /**
+     * @brief Starts a frame, clears last frame's quads
+     *
+     */
+    void Begin();
+
+    /**
+     * @brief Places a cached string
+     *
+     * @param handle - From AddStatic
+     * @param position - Top left corner in pixels from the window's top left
+     *
+     * @returns Pixel x right after the string's first line, to continue it with Print
+     */
+    float DrawStatic(unsigned handle, const glm::vec2& position);
+
+    /**
+     * @brief Lays out and places a string for this frame only
+     *
+     * @param text - String, lines break on \n
+     * @param position - Top left corner in pixels from the window's top left
+     *
+     * @returns Pixel x right after the string's last line
+     */
+    float Print(const std::string& text, const glm::vec2& position);
+
+    /**
+     * @brief Uploads the frame's quads and draws them blended over the default framebuffer
+     *
+     * @param windowWidth - Framebuffer width in pixels
+     * @param windowHeight - Framebuffer height in pixels
+     *
+     */
+    void Render(int windowWidth, int windowHeight);
+
+    float GetLineHeight() const;
+
+private:
+    struct Glyph {
+        glm::vec2 Size;
+        glm::vec2 Bearing;
+        float Advance;
+        glm::vec2 UVMin;
+        glm::vec2 UVMax;
+    };
+
+    struct Run {
+        unsigned First;
+        unsigned Count;
+        float Width;
+    };
+
+    Shader* mShader;
+    unsigned mAtlas;
+    unsigned mVAO;
+    unsigned mVBO;
+    float mLineHeight;
+    float mAscender;
+    Glyph mGlyphs[HUD_GLYPH_COUNT];
+    // NOTE: Quads of every cached string back to back, in pixels from the string's top left
+    std::vector<float> mStaticVertices;
+    std::vector<Run> mRuns;
+    std::vector<float> mFrameVertices;
+    unsigned mFrameGlyphs;
+
+    /**
+     * @brief Appends the quads of a string to vertices, offset by position
+     *
+     * @returns Pixel x after the first line in x, after the last line in y, glyphs written in z
+     */
+    glm::vec3 layout(const std::string& text, const glm::vec2& position, std::vector<float>& vertices, unsigned maxGlyphs) const;
+};
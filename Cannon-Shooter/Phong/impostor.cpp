@@ -0,0 +1,174 @@
+#include "impostor.hpp"
+#include "instancing.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+Impostor::Impostor() {
+    mFBO = 0;
+    mDepthBuffer = 0;
+    mAlbedoAtlas = 0;
+    mNormalAtlas = 0;
+    mQuadVAO = 0;
+    mQuadVBO = 0;
+    mOrigin = glm::vec3(0.0f);
+    mSize = glm::vec2(0.0f);
+}
+
+unsigned
+Impostor::createAtlas() {
+    unsigned Atlas;
+    glGenTextures(1, &Atlas);
+    GLState.BindTexture(0, GL_TEXTURE_2D, Atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMPOSTOR_TILE_WIDTH * IMPOSTOR_VIEWS, IMPOSTOR_TILE_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return Atlas;
+}
+
+void
+Impostor::createQuad() {
+    // NOTE: x across the quad centred on the origin, y from the ground up
+    float Corners[] = {
+        -0.5f, 0.0f,
+         0.5f, 0.0f,
+         0.5f, 1.0f,
+        -0.5f, 0.0f,
+         0.5f, 1.0f,
+        -0.5f, 1.0f,
+    };
+
+    glGenVertexArrays(1, &mQuadVAO);
+    GLState.BindVertexArray(mQuadVAO);
+    glGenBuffers(1, &mQuadVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mQuadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Corners), Corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+}
+
+bool
+Impostor::Bake(Model& model, Shader& bakeShader) {
+    // NOTE: Frame is the model's footprint around its vertical axis, so one quad fits every view
+    const AABB& Bounds = model.GetAABB();
+    glm::vec3 Center = 0.5f * (Bounds.Min + Bounds.Max);
+    float Radius = 0.0f;
+    const std::vector<Mesh>& Meshes = model.GetMeshes();
+    for (unsigned MeshIdx = 0; MeshIdx < Meshes.size(); ++MeshIdx) {
+        const std::vector<float>& Vertices = Meshes[MeshIdx].mVertices;
+        for (unsigned Offset = 0; Offset < Vertices.size(); Offset += 8) {
+            float DX = Vertices[Offset] - Center.x;
+            float DZ = Vertices[Offset + 2] - Center.z;
+            Radius = std::max(Radius, std::sqrt(DX * DX + DZ * DZ));
+        }
+    }
+
+    // NOTE: Grow the smaller extent so the frame keeps the tile aspect and texels stay square
+    float Width = 2.0f * Radius;
+    float Height = Bounds.Max.y - Bounds.Min.y;
+    float TileAspect = (float)IMPOSTOR_TILE_WIDTH / IMPOSTOR_TILE_HEIGHT;
+    if (Width > Height * TileAspect) Height = Width / TileAspect;
+    else Width = Height * TileAspect;
+    mOrigin = glm::vec3(Center.x, Bounds.Min.y, Center.z);
+    mSize = glm::vec2(Width, Height);
+
+    mAlbedoAtlas = createAtlas();
+    mNormalAtlas = createAtlas();
+    glGenRenderbuffers(1, &mDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IMPOSTOR_TILE_WIDTH * IMPOSTOR_VIEWS, IMPOSTOR_TILE_HEIGHT);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &mFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mAlbedoAtlas, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mNormalAtlas, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+    GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, DrawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[Err] Impostor framebuffer incomplete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return false;
+    }
+
+    GLint Viewport[4];
+    GLfloat ClearColor[4];
+    glGetIntegerv(GL_VIEWPORT, Viewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, ClearColor);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // NOTE: Leaves are single sided cards, the bake shader flips back facing normals
+    glDisable(GL_CULL_FACE);
+
+    GLState.UseProgram(bakeShader.GetId());
+    bakeShader.SetUniform1i("uDiffuse", 0);
+    bakeShader.SetModel(glm::mat4(1.0f));
+    float Distance = 2.0f * Radius + 1.0f;
+    bakeShader.SetProjection(glm::ortho(-0.5f * Width, 0.5f * Width, 0.0f, Height, 0.0f, Distance + Radius + 1.0f));
+    for (unsigned View = 0; View < IMPOSTOR_VIEWS; ++View) {
+        float Angle = 2.0f * glm::pi<float>() * View / IMPOSTOR_VIEWS;
+        glm::vec3 Direction(std::cos(Angle), 0.0f, std::sin(Angle));
+        glViewport(View * IMPOSTOR_TILE_WIDTH, 0, IMPOSTOR_TILE_WIDTH, IMPOSTOR_TILE_HEIGHT);
+        bakeShader.SetView(glm::lookAt(mOrigin + Direction * Distance, mOrigin, glm::vec3(0.0f, 1.0f, 0.0f)));
+        model.Render();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_CULL_FACE);
+    glViewport(Viewport[0], Viewport[1], Viewport[2], Viewport[3]);
+    glClearColor(ClearColor[0], ClearColor[1], ClearColor[2], ClearColor[3]);
+
+    GLState.BindTexture(0, GL_TEXTURE_2D, mAlbedoAtlas);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    GLState.BindTexture(0, GL_TEXTURE_2D, mNormalAtlas);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    createQuad();
+    return true;
+}
+
+void
+Impostor::SetupShader(Shader& shader) const {
+    GLState.UseProgram(shader.GetId());
+    shader.SetUniform1i("uAlbedo", 0);
+    shader.SetUniform1i("uNormals", 1);
+    shader.SetUniform1i("uViews", IMPOSTOR_VIEWS);
+    shader.SetUniform3f("uImpostorOrigin", mOrigin);
+    shader.SetUniform3f("uImpostorSize", glm::vec3(mSize.x, mSize.y, 0.0f));
+}
+
+void
+Impostor::Submit(RenderQueue& queue, Shader* program, unsigned state, unsigned instanceBuffer, unsigned offset, unsigned count) const {
+    if (!count || !mQuadVAO) return;
+
+    DrawCommand Command = {};
+    Command.Program = program;
+    Command.State = state;
+    Command.VAO = mQuadVAO;
+    Command.Count = 6;
+    Command.DiffuseTexture = mAlbedoAtlas;
+    Command.SpecularTexture = mNormalAtlas;
+    Command.InstanceBuffer = instanceBuffer;
+    Command.InstanceOffset = offset;
+    Command.InstanceCount = count;
+    // NOTE: Instances are spread over the whole horizon, there is no single distance to sort by
+    queue.Submit(RENDER_PASS_OPAQUE, Command, 0.0f);
+}
+
+unsigned
+Impostor::GetAlbedoAtlas() const {
+    return mAlbedoAtlas;
+}
+
+unsigned
+Impostor::GetNormalAtlas() const {
+    return mNormalAtlas;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "model.hpp"
+#include "render_queue.hpp"
+#include "shader.hpp"
+
+// NOTE: Views are spread evenly around the vertical axis, the atlas is one row of tiles
+#define IMPOSTOR_VIEWS 8
+#define IMPOSTOR_TILE_WIDTH 256
+#define IMPOSTOR_TILE_HEIGHT 512
+
+/**
+ * @brief Camera facing quad stand-in for a model far away. The model is baked
+ * at load from IMPOSTOR_VIEWS directions into an albedo and a normal atlas, at
+ * draw time every instance shows the tile closest to its view direction and is
+ * lit with the scene's directional light. Instances must be unrotated, they may
+ * be translated and uniformly scaled
+ */
+class Impostor {
+public:
+    Impostor();
+
+    /**
+     * @brief Renders the model into the atlases. Restores the viewport, clear
+     * colour and face culling, the default framebuffer is bound afterwards
+     *
+     * @param model - Loaded model
+     * @param bakeShader - shaders/impostor_bake program
+     *
+     * @returns true - Success, false - Framebuffer incomplete
+     */
+    bool Bake(Model& model, Shader& bakeShader);
+
+    /**
+     * @brief Sets the uniforms that don't change per frame on an impostor program
+     *
+     * @param shader - shaders/impostor program
+     *
+     */
+    void SetupShader(Shader& shader) const;
+
+    /**
+     * @brief Queues every instance as one instanced draw
+     *
+     * @param queue - Frame render queue
+     * @param program - shaders/impostor program
+     * @param state - Render queue state id, sets uDirLight
+     * @param instanceBuffer - Buffer of per-instance model matrices
+     * @param offset - Byte offset of the first instance
+     * @param count - Number of instances
+     *
+     */
+    void Submit(RenderQueue& queue, Shader* program, unsigned state, unsigned instanceBuffer, unsigned offset, unsigned count) const;
+
+    unsigned GetAlbedoAtlas() const;
+    unsigned GetNormalAtlas() const;
+
+private:
+    unsigned mFBO;
+    unsigned mDepthBuffer;
+    unsigned mAlbedoAtlas;
+    unsigned mNormalAtlas;
+    unsigned mQuadVAO;
+    unsigned mQuadVBO;
+    // NOTE: Bottom centre and size of the baked frame, in model space
+    glm::vec3 mOrigin;
+    glm::vec2 mSize;
+
+    unsigned createAtlas();
+    void createQuad();
+};
@@ -0,0 +1,111 @@
+#include "instancing.hpp"
+#include <iostream>
+
+void bindInstanceAttributes(unsigned instanceBuffer, unsigned offset) {
+    // NOTE: A mat4 attribute takes four vec4 slots, each advancing once per instance
+    GLState.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (unsigned Column = 0; Column < 4; ++Column) {
+        unsigned Location = INSTANCE_MODEL_LOCATION + Column;
+        glEnableVertexAttribArray(Location);
+        glVertexAttribPointer(Location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(size_t)(offset + Column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(Location, 1);
+    }
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstanceBuffer::InstanceBuffer() {
+    mBuffer = 0;
+    mCount = 0;
+}
+
+void
+InstanceBuffer::Upload(const std::vector<glm::mat4>& transforms) {
+    if (!mBuffer) glGenBuffers(1, &mBuffer);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mBuffer);
+    glBufferData(GL_ARRAY_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_STATIC_DRAW);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    mCount = transforms.size();
+}
+
+unsigned
+InstanceBuffer::GetId() const {
+    return mBuffer;
+}
+
+unsigned
+InstanceBuffer::GetCount() const {
+    return mCount;
+}
+
+InstanceRingBuffer::InstanceRingBuffer() {
+    mBuffer = 0;
+    mCapacity = 0;
+    mHead = 0;
+    mOffset = 0;
+    mCount = 0;
+}
+
+void
+InstanceRingBuffer::orphan(unsigned capacity) {
+    // NOTE: Respecifying the storage hands the old one to the driver, frames still
+    // in flight keep reading it while we write into fresh memory
+    mCapacity = capacity;
+    mHead = 0;
+    glBufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(glm::mat4), 0, GL_STREAM_DRAW);
+}
+
+glm::mat4*
+InstanceRingBuffer::Map(unsigned count) {
+    mCount = count;
+    mOffset = 0;
+    if (!count) return 0;
+
+    if (!mBuffer) glGenBuffers(1, &mBuffer);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mBuffer);
+    if (count > mCapacity) {
+        unsigned Capacity = mCapacity ? mCapacity : INSTANCE_RING_INITIAL_CAPACITY;
+        while (Capacity < count) Capacity *= 2;
+        orphan(Capacity);
+    }
+    else if (mHead + count > mCapacity) {
+        orphan(mCapacity);
+    }
+
+    mOffset = mHead * sizeof(glm::mat4);
+    glm::mat4* Mapped = (glm::mat4*)glMapBufferRange(GL_ARRAY_BUFFER, mOffset, count * sizeof(glm::mat4),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!Mapped) {
+        std::cerr << "[Err] Failed to map instance buffer" << std::endl;
+        GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+        mCount = 0;
+        mOffset = 0;
+        return 0;
+    }
+
+    mHead += count;
+    return Mapped;
+}
+
+unsigned
+InstanceRingBuffer::Unmap(unsigned count) {
+    // NOTE: mCount is only non zero while a range is mapped
+    if (!mCount) return 0;
+    mCount = count;
+    // NOTE: Several ring buffers can be mapped at once, bind ours before unmapping
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mBuffer);
+    // NOTE: Storage can be lost while mapped (mode switch), the range is undefined then and must not be drawn
+    if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) mCount = 0;
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    return mOffset;
+}
+
+unsigned
+InstanceRingBuffer::GetId() const {
+    return mBuffer;
+}
+
+unsigned
+InstanceRingBuffer::GetCount() const {
+    return mCount;
+}
+
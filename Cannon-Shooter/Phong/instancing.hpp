@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "state_cache.hpp"
+
+#define INSTANCE_MODEL_LOCATION 3
+#define INSTANCE_RING_INITIAL_CAPACITY 1024
+
+/**
+ * @brief Points the per-instance model matrix attribute of the bound VAO at a buffer
+ *
+ * @param instanceBuffer Buffer of model matrices
+ * @param offset Byte offset of the first instance
+ */
+void bindInstanceAttributes(unsigned instanceBuffer, unsigned offset);
+
+class InstanceBuffer {
+public:
+    InstanceBuffer();
+
+    /**
+     * @brief Uploads transforms once, for instances that never move
+     *
+     * @param transforms Model matrix of every instance
+     */
+    void Upload(const std::vector<glm::mat4>& transforms);
+
+    unsigned GetId() const;
+    unsigned GetCount() const;
+
+private:
+    unsigned mBuffer;
+    unsigned mCount;
+};
+
+/**
+ * @brief Per-frame instance data for moving objects. Every frame appends its
+ * transforms behind the previous ones without waiting on the GPU; once the
+ * buffer is full it is orphaned and writing starts over from the beginning
+ */
+class InstanceRingBuffer {
+public:
+    InstanceRingBuffer();
+
+    /**
+     * @brief Reserves room for count transforms and maps it for writing
+     *
+     * @param count Number of instances drawn this frame
+     *
+     * @returns Pointer the caller fills with exactly count matrices, null if count is 0
+     * or the buffer could not be mapped. Nothing may be written or drawn in that case
+     */
+    glm::mat4* Map(unsigned count);
+
+    /**
+     * @brief Finishes writing the range returned by Map, does nothing if Map returned null
+     *
+     * @param count Number of matrices actually written, at most the mapped count
+     *
+     * @returns Byte offset of the first written instance
+     */
+    unsigned Unmap(unsigned count);
+
+    unsigned GetId() const;
+    unsigned GetCount() const;
+
+private:
+    unsigned mBuffer;
+    unsigned mCapacity;
+    unsigned mHead;
+    unsigned mOffset;
+    unsigned mCount;
+
+    void orphan(unsigned capacity);
+};
+
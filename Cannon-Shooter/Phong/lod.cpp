@@ -0,0 +1,378 @@
+#include "lod.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+static const float LodTriangleRatios[LOD_COUNT] = { 1.0f, 0.5f, 0.2f, 0.05f };
+// NOTE: Smallest projected height, as a fraction of the viewport, each level is still used at.
+// From the middle of the beach the palm rings at radius 60 and 90 land on levels 1 and 2
+static const float LodScreenSizes[LOD_COUNT] = { 0.45f, 0.3f, 0.12f, 0.0f };
+
+// NOTE: Collapses that turn a remaining triangle past this cosine are folds and get rejected
+#define LOD_MIN_NORMAL_COS 0.2f
+// NOTE: Open borders (palm leaves are single sided cards) get a plane perpendicular to the
+// triangle along the edge, otherwise their outline is free to collapse inwards
+#define LOD_BOUNDARY_WEIGHT 10.0
+
+LodSelector
+makeLodSelector(const glm::vec3& viewPosition, const glm::mat4& projection) {
+    LodSelector Selector;
+    Selector.ViewPosition = viewPosition;
+    // NOTE: projection[1][1] is cot(fov / 2), it maps half the viewport height to 1
+    Selector.ScreenScale = 0.5f * projection[1][1];
+    return Selector;
+}
+
+unsigned
+selectLod(const LodSelector& selector, const glm::vec4& sphere, unsigned currentLod) {
+    float Distance = glm::length(glm::vec3(sphere.x, sphere.y, sphere.z) - selector.ViewPosition);
+    if (Distance <= sphere.w) return 0;
+    float ScreenSize = 2.0f * sphere.w * selector.ScreenScale / Distance;
+
+    unsigned Lod = std::min(currentLod, (unsigned)LOD_COUNT - 1);
+    while (Lod > 0 && ScreenSize > LodScreenSizes[Lod - 1] * (1.0f + LOD_HYSTERESIS)) --Lod;
+    while (Lod + 1 < LOD_COUNT && ScreenSize < LodScreenSizes[Lod] * (1.0f - LOD_HYSTERESIS)) ++Lod;
+    return Lod;
+}
+
+/**
+ * @brief Symmetric 4x4 error quadric, upper triangle row by row
+ */
+struct Quadric {
+    double M[10];
+};
+
+static void
+addPlane(Quadric& q, const glm::vec3& normal, float d, double weight) {
+    double A = normal.x, B = normal.y, C = normal.z, D = d;
+    q.M[0] += weight * A * A; q.M[1] += weight * A * B; q.M[2] += weight * A * C; q.M[3] += weight * A * D;
+    q.M[4] += weight * B * B; q.M[5] += weight * B * C; q.M[6] += weight * B * D;
+    q.M[7] += weight * C * C; q.M[8] += weight * C * D;
+    q.M[9] += weight * D * D;
+}
+
+static double
+evaluateQuadric(const Quadric& q, const glm::vec3& position) {
+    double X = position.x, Y = position.y, Z = position.z;
+    return q.M[0] * X * X + 2.0 * q.M[1] * X * Y + 2.0 * q.M[2] * X * Z + 2.0 * q.M[3] * X
+        + q.M[4] * Y * Y + 2.0 * q.M[5] * Y * Z + 2.0 * q.M[6] * Y
+        + q.M[7] * Z * Z + 2.0 * q.M[8] * Z
+        + q.M[9];
+}
+
+struct Collapse {
+    double Cost;
+    unsigned From;
+    unsigned To;
+    unsigned FromVersion;
+    unsigned ToVersion;
+
+    bool operator>(const Collapse& other) const { return Cost > other.Cost; }
+};
+
+/**
+ * @brief Greedy half-edge collapser. Vertices sharing a position are welded
+ * into groups first, so UV and normal seams collapse together instead of tearing
+ */
+class EdgeCollapser {
+public:
+    EdgeCollapser(const std::vector<float>& vertices, const std::vector<unsigned>& indices);
+
+    unsigned GetTriangleCount() const;
+
+    /**
+     * @brief Collapses the cheapest edges until at most targetTriangles remain or
+     * no valid collapse is left
+     *
+     */
+    void Simplify(unsigned targetTriangles);
+
+    void GetIndices(std::vector<unsigned>& indices) const;
+
+private:
+    const std::vector<float>& mVertices;
+    std::vector<unsigned> mVertexGroups;
+    std::vector<std::vector<unsigned> > mGroupVertices;
+    std::vector<std::vector<unsigned> > mGroupTriangles;
+    std::vector<glm::vec3> mGroupPositions;
+    std::vector<Quadric> mQuadrics;
+    std::vector<unsigned> mVersions;
+    std::vector<bool> mCollapsed;
+    std::vector<unsigned> mCorners;
+    std::vector<bool> mAlive;
+    std::vector<unsigned> mStamps;
+    unsigned mStamp;
+    unsigned mTriangleCount;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > mHeap;
+
+    void weld();
+    void buildQuadrics(std::unordered_map<uint64_t, unsigned>& edgeUses);
+    void pushEdge(unsigned a, unsigned b);
+    bool isValid(unsigned from, unsigned to) const;
+    void collapse(unsigned from, unsigned to);
+    unsigned group(unsigned triangle, unsigned corner) const;
+};
+
+EdgeCollapser::EdgeCollapser(const std::vector<float>& vertices, const std::vector<unsigned>& indices)
+    : mVertices(vertices) {
+    mStamp = 0;
+    mTriangleCount = 0;
+    weld();
+
+    mGroupTriangles.resize(mGroupPositions.size());
+    mCorners.reserve(indices.size());
+    for (unsigned Offset = 0; Offset + 2 < indices.size(); Offset += 3) {
+        unsigned G0 = mVertexGroups[indices[Offset]];
+        unsigned G1 = mVertexGroups[indices[Offset + 1]];
+        unsigned G2 = mVertexGroups[indices[Offset + 2]];
+        if (G0 == G1 || G1 == G2 || G0 == G2) continue;
+
+        unsigned Triangle = mCorners.size() / 3;
+        mCorners.insert(mCorners.end(), indices.begin() + Offset, indices.begin() + Offset + 3);
+        mGroupTriangles[G0].push_back(Triangle);
+        mGroupTriangles[G1].push_back(Triangle);
+        mGroupTriangles[G2].push_back(Triangle);
+    }
+    mTriangleCount = mCorners.size() / 3;
+    mAlive.assign(mTriangleCount, true);
+
+    std::unordered_map<uint64_t, unsigned> EdgeUses;
+    buildQuadrics(EdgeUses);
+
+    mVersions.assign(mGroupPositions.size(), 0);
+    mCollapsed.assign(mGroupPositions.size(), false);
+    mStamps.assign(mGroupPositions.size(), 0);
+    for (std::unordered_map<uint64_t, unsigned>::const_iterator Edge = EdgeUses.begin(); Edge != EdgeUses.end(); ++Edge) {
+        pushEdge((unsigned)(Edge->first >> 32), (unsigned)(Edge->first & 0xFFFFFFFF));
+    }
+}
+
+unsigned
+EdgeCollapser::GetTriangleCount() const {
+    return mTriangleCount;
+}
+
+void
+EdgeCollapser::weld() {
+    unsigned VertexCount = mVertices.size() / LOD_VERTEX_FLOATS;
+    std::vector<unsigned> Order(VertexCount);
+    for (unsigned VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx) Order[VertexIdx] = VertexIdx;
+
+    const std::vector<float>& Vertices = mVertices;
+    std::sort(Order.begin(), Order.end(), [&Vertices](unsigned a, unsigned b) {
+        const float* A = &Vertices[a * LOD_VERTEX_FLOATS];
+        const float* B = &Vertices[b * LOD_VERTEX_FLOATS];
+        return std::lexicographical_compare(A, A + 3, B, B + 3);
+    });
+
+    mVertexGroups.resize(VertexCount);
+    for (unsigned OrderIdx = 0; OrderIdx < VertexCount; ++OrderIdx) {
+        const float* Curr = &mVertices[Order[OrderIdx] * LOD_VERTEX_FLOATS];
+        const float* Prev = OrderIdx ? &mVertices[Order[OrderIdx - 1] * LOD_VERTEX_FLOATS] : 0;
+        if (!Prev || !std::equal(Curr, Curr + 3, Prev)) {
+            mGroupPositions.push_back(glm::vec3(Curr[0], Curr[1], Curr[2]));
+            mGroupVertices.push_back(std::vector<unsigned>());
+        }
+        mVertexGroups[Order[OrderIdx]] = mGroupPositions.size() - 1;
+        mGroupVertices.back().push_back(Order[OrderIdx]);
+    }
+}
+
+unsigned
+EdgeCollapser::group(unsigned triangle, unsigned corner) const {
+    return mVertexGroups[mCorners[triangle * 3 + corner]];
+}
+
+void
+EdgeCollapser::buildQuadrics(std::unordered_map<uint64_t, unsigned>& edgeUses) {
+    Quadric Zero = {};
+    mQuadrics.assign(mGroupPositions.size(), Zero);
+
+    for (unsigned Triangle = 0; Triangle < mTriangleCount; ++Triangle) {
+        unsigned Groups[3] = { group(Triangle, 0), group(Triangle, 1), group(Triangle, 2) };
+        const glm::vec3& P0 = mGroupPositions[Groups[0]];
+        glm::vec3 Normal = glm::cross(mGroupPositions[Groups[1]] - P0, mGroupPositions[Groups[2]] - P0);
+        float Length = glm::length(Normal);
+        if (Length > 0.0f) {
+            Normal /= Length;
+            // NOTE: Area weighted, so slivers don't pin their vertices in place
+            for (unsigned Corner = 0; Corner < 3; ++Corner) {
+                addPlane(mQuadrics[Groups[Corner]], Normal, -glm::dot(Normal, P0), 0.5 * Length);
+            }
+        }
+
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            uint64_t A = std::min(Groups[Corner], Groups[(Corner + 1) % 3]);
+            uint64_t B = std::max(Groups[Corner], Groups[(Corner + 1) % 3]);
+            edgeUses[(A << 32) | B]++;
+        }
+    }
+
+    for (unsigned Triangle = 0; Triangle < mTriangleCount; ++Triangle) {
+        unsigned Groups[3] = { group(Triangle, 0), group(Triangle, 1), group(Triangle, 2) };
+        const glm::vec3& P0 = mGroupPositions[Groups[0]];
+        glm::vec3 Normal = glm::cross(mGroupPositions[Groups[1]] - P0, mGroupPositions[Groups[2]] - P0);
+        if (glm::length(Normal) <= 0.0f) continue;
+
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            unsigned A = Groups[Corner];
+            unsigned B = Groups[(Corner + 1) % 3];
+            uint64_t Key = ((uint64_t)std::min(A, B) << 32) | std::max(A, B);
+            if (edgeUses[Key] != 1) continue;
+
+            glm::vec3 Edge = mGroupPositions[B] - mGroupPositions[A];
+            glm::vec3 BorderNormal = glm::cross(Edge, Normal);
+            float Length = glm::length(BorderNormal);
+            if (Length <= 0.0f) continue;
+            BorderNormal /= Length;
+            double Weight = LOD_BOUNDARY_WEIGHT * glm::dot(Edge, Edge);
+            addPlane(mQuadrics[A], BorderNormal, -glm::dot(BorderNormal, mGroupPositions[A]), Weight);
+            addPlane(mQuadrics[B], BorderNormal, -glm::dot(BorderNormal, mGroupPositions[A]), Weight);
+        }
+    }
+}
+
+void
+EdgeCollapser::pushEdge(unsigned a, unsigned b) {
+    // NOTE: Both directions go in, if the cheaper one folds a triangle the other may still be fine
+    Collapse AToB = { evaluateQuadric(mQuadrics[a], mGroupPositions[b]) + evaluateQuadric(mQuadrics[b], mGroupPositions[b]),
+        a, b, mVersions[a], mVersions[b] };
+    Collapse BToA = { evaluateQuadric(mQuadrics[a], mGroupPositions[a]) + evaluateQuadric(mQuadrics[b], mGroupPositions[a]),
+        b, a, mVersions[b], mVersions[a] };
+    mHeap.push(AToB);
+    mHeap.push(BToA);
+}
+
+bool
+EdgeCollapser::isValid(unsigned from, unsigned to) const {
+    const std::vector<unsigned>& Triangles = mGroupTriangles[from];
+    for (unsigned TriangleIdx = 0; TriangleIdx < Triangles.size(); ++TriangleIdx) {
+        unsigned Triangle = Triangles[TriangleIdx];
+        if (!mAlive[Triangle]) continue;
+
+        unsigned Groups[3] = { group(Triangle, 0), group(Triangle, 1), group(Triangle, 2) };
+        if (Groups[0] == to || Groups[1] == to || Groups[2] == to) continue;
+
+        glm::vec3 Old[3];
+        glm::vec3 New[3];
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            Old[Corner] = mGroupPositions[Groups[Corner]];
+            New[Corner] = Groups[Corner] == from ? mGroupPositions[to] : Old[Corner];
+        }
+        glm::vec3 OldNormal = glm::cross(Old[1] - Old[0], Old[2] - Old[0]);
+        glm::vec3 NewNormal = glm::cross(New[1] - New[0], New[2] - New[0]);
+        float OldLength = glm::length(OldNormal);
+        float NewLength = glm::length(NewNormal);
+        if (OldLength <= 0.0f) continue;
+        if (NewLength <= 0.0f) return false;
+        if (glm::dot(OldNormal, NewNormal) < LOD_MIN_NORMAL_COS * OldLength * NewLength) return false;
+    }
+    return true;
+}
+
+void
+EdgeCollapser::collapse(unsigned from, unsigned to) {
+    // NOTE: Each vertex moves onto the vertex at the target position with the closest UV,
+    // which keeps both sides of a texture seam on their own side
+    const std::vector<unsigned>& Targets = mGroupVertices[to];
+    std::unordered_map<unsigned, unsigned> Remap;
+    for (unsigned VertexIdx = 0; VertexIdx < mGroupVertices[from].size(); ++VertexIdx) {
+        unsigned Vertex = mGroupVertices[from][VertexIdx];
+        const float* UV = &mVertices[Vertex * LOD_VERTEX_FLOATS + 6];
+        unsigned Best = Targets[0];
+        float BestDistance = -1.0f;
+        for (unsigned TargetIdx = 0; TargetIdx < Targets.size(); ++TargetIdx) {
+            const float* TargetUV = &mVertices[Targets[TargetIdx] * LOD_VERTEX_FLOATS + 6];
+            float DU = UV[0] - TargetUV[0];
+            float DV = UV[1] - TargetUV[1];
+            float Distance = DU * DU + DV * DV;
+            if (BestDistance < 0.0f || Distance < BestDistance) {
+                BestDistance = Distance;
+                Best = Targets[TargetIdx];
+            }
+        }
+        Remap[Vertex] = Best;
+    }
+
+    std::vector<unsigned>& Triangles = mGroupTriangles[from];
+    for (unsigned TriangleIdx = 0; TriangleIdx < Triangles.size(); ++TriangleIdx) {
+        unsigned Triangle = Triangles[TriangleIdx];
+        if (!mAlive[Triangle]) continue;
+
+        if (group(Triangle, 0) == to || group(Triangle, 1) == to || group(Triangle, 2) == to) {
+            mAlive[Triangle] = false;
+            mTriangleCount--;
+            continue;
+        }
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            unsigned& Vertex = mCorners[Triangle * 3 + Corner];
+            if (mVertexGroups[Vertex] == from) Vertex = Remap[Vertex];
+        }
+        mGroupTriangles[to].push_back(Triangle);
+    }
+    std::vector<unsigned>().swap(Triangles);
+
+    for (unsigned Idx = 0; Idx < 10; ++Idx) mQuadrics[to].M[Idx] += mQuadrics[from].M[Idx];
+    mCollapsed[from] = true;
+    mVersions[to]++;
+
+    // NOTE: Drop dead triangles from the target's list while collecting its new neighbours
+    mStamp++;
+    mStamps[to] = mStamp;
+    std::vector<unsigned>& ToTriangles = mGroupTriangles[to];
+    unsigned Kept = 0;
+    for (unsigned TriangleIdx = 0; TriangleIdx < ToTriangles.size(); ++TriangleIdx) {
+        unsigned Triangle = ToTriangles[TriangleIdx];
+        if (!mAlive[Triangle]) continue;
+        ToTriangles[Kept++] = Triangle;
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            unsigned Neighbour = group(Triangle, Corner);
+            if (mStamps[Neighbour] == mStamp) continue;
+            mStamps[Neighbour] = mStamp;
+            pushEdge(to, Neighbour);
+        }
+    }
+    ToTriangles.resize(Kept);
+}
+
+void
+EdgeCollapser::Simplify(unsigned targetTriangles) {
+    while (mTriangleCount > targetTriangles && !mHeap.empty()) {
+        Collapse Candidate = mHeap.top();
+        mHeap.pop();
+        if (mCollapsed[Candidate.From] || mCollapsed[Candidate.To]) continue;
+        if (mVersions[Candidate.From] != Candidate.FromVersion || mVersions[Candidate.To] != Candidate.ToVersion) continue;
+        if (!isValid(Candidate.From, Candidate.To)) continue;
+        collapse(Candidate.From, Candidate.To);
+    }
+}
+
+void
+EdgeCollapser::GetIndices(std::vector<unsigned>& indices) const {
+    indices.clear();
+    indices.reserve(mTriangleCount * 3);
+    for (unsigned Triangle = 0; Triangle < mAlive.size(); ++Triangle) {
+        if (!mAlive[Triangle]) continue;
+        indices.insert(indices.end(), mCorners.begin() + Triangle * 3, mCorners.begin() + Triangle * 3 + 3);
+    }
+}
+
+void
+buildLodChain(const std::vector<float>& vertices, const std::vector<unsigned>& indices, std::vector<unsigned> lods[LOD_COUNT]) {
+    lods[0] = indices;
+    if (indices.size() < 3) {
+        for (unsigned Lod = 1; Lod < LOD_COUNT; ++Lod) lods[Lod] = indices;
+        return;
+    }
+
+    // NOTE: One collapser runs the whole chain, each level continues where the previous stopped
+    EdgeCollapser Collapser(vertices, indices);
+    unsigned SourceTriangles = Collapser.GetTriangleCount();
+    for (unsigned Lod = 1; Lod < LOD_COUNT; ++Lod) {
+        unsigned Target = std::max(1u, (unsigned)(SourceTriangles * LodTriangleRatios[Lod]));
+        Collapser.Simplify(Target);
+        Collapser.GetIndices(lods[Lod]);
+    }
+}
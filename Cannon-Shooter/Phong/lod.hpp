@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// NOTE: Level 0 is the source mesh, the others keep about 50%, 20% and 5% of its triangles
+#define LOD_COUNT 4
+// NOTE: Same interleaved layout as Mesh, position, normal, UV
+#define LOD_VERTEX_FLOATS 8
+// NOTE: A level only changes once the screen size is this far past the switch point
+#define LOD_HYSTERESIS 0.1f
+
+/**
+ * @brief Camera data needed to project bounding spheres to screen size
+ */
+struct LodSelector {
+    glm::vec3 ViewPosition;
+    // NOTE: Fraction of the viewport height covered by a unit diameter at unit distance
+    float ScreenScale;
+};
+
+/**
+ * @brief Sets up LOD selection for a frame
+ *
+ * @param viewPosition - Camera position
+ * @param projection - Camera projection matrix
+ *
+ * @returns Selector for the frame
+ */
+LodSelector makeLodSelector(const glm::vec3& viewPosition, const glm::mat4& projection);
+
+/**
+ * @brief Picks the level for a bounding sphere from its projected height on screen
+ *
+ * @param selector - Frame selector
+ * @param sphere - World space center in xyz, radius in w
+ * @param currentLod - Level used last frame, switching away from it needs LOD_HYSTERESIS margin
+ *
+ * @returns Level to draw with
+ */
+unsigned selectLod(const LodSelector& selector, const glm::vec4& sphere, unsigned currentLod);
+
+/**
+ * @brief Simplifies a triangle mesh by quadric error edge collapse. Vertices are
+ * only ever collapsed onto other existing vertices, so every level indexes into
+ * the original vertex buffer and only the index buffers differ
+ *
+ * @param vertices - Interleaved mesh vertices, LOD_VERTEX_FLOATS per vertex
+ * @param indices - Source triangles
+ * @param lods - Filled with LOD_COUNT index buffers, lods[0] is a copy of indices
+ *
+ */
+void buildLodChain(const std::vector<float>& vertices, const std::vector<unsigned>& indices, std::vector<unsigned> lods[LOD_COUNT]);
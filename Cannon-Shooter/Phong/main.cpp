@@ -6,12 +6,33 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <chrono>
 #include <thread>
+#include <cstdio>
+#include <cfloat>
+#include <algorithm>
+#include <ctime>
 #include "shader.hpp"
 #include "camera.hpp"
 #include "model.hpp"
 #include "texture.hpp"
 #include "stb_image.h"
 #include "physics.hpp"
+#include "collision.hpp"
+#include "snapshot.hpp"
+#include "culling.hpp"
+#include "render_queue.hpp"
+#include "static_batch.hpp"
+#include "lod.hpp"
+#include "impostor.hpp"
+#include "occlusion.hpp"
+#include "dynamic_resolution.hpp"
+#include "clustered_lights.hpp"
+#include "shadow_map.hpp"
+#include "particles.hpp"
+#include "trails.hpp"
+#include "quality.hpp"
+#include "terrain.hpp"
+#include "hud.hpp"
+#include "capture.hpp"
 #include <list>
 #include <random>
 using namespace std;
@@ -29,7 +50,60 @@ int PlayerScore = 0;
 list<Sphere*> SphereList;
 list<Plane*> PlaneList;
 list<Cylinder*> CylinderList;
+list<Box*> BoxList;
+list<Capsule*> CapsuleList;
+list<ConvexHull*> HullList;
+// NOTE: Every rock shares this hull, the rock mesh is built from the same corners
+ConvexHull RockShape;
 list<glm::vec3> PalmPositionsList;
+std::vector<StaticBatch> StaticBatches;
+// NOTE: Palms further than this from the camera are drawn as impostors instead of meshes
+const float PalmImpostorDistance = 75.0f;
+std::vector<glm::mat4> PalmTransforms;
+std::vector<glm::vec4> PalmBounds;
+std::vector<unsigned> PalmVisible;
+std::vector<glm::mat4> PalmOcclusionBoxes;
+std::vector<unsigned> PalmOcclusionSlots;
+Impostor PalmImpostor;
+InstanceRingBuffer PalmImpostorInstances;
+OcclusionCuller Occlusion;
+DynamicResolution SceneResolution;
+ClusteredLights SceneLights;
+// NOTE: Balls faster than this carry a light, resting balls don't
+const float BallLightMinSpeed = 2.0f;
+const float BallLightRadius = 4.0f;
+const float PopFlashDuration = 0.5f;
+const float PopFlashRadius = 12.0f;
+// NOTE: Position and time of recent balloon pops, each lights up its surroundings briefly
+std::vector<glm::vec4> PopFlashes;
+const glm::vec3 SunDirection = glm::vec3(1.0f, -1.0f, 0.5f);
+ShadowMaps SunShadows;
+// NOTE: Dynamic casters are queued while the frame is built and drawn into the shadow map before the scene
+RenderQueue ShadowQueue;
+RenderQueue StaticShadowQueue;
+Shader* ShadowCasterShader = 0;
+std::vector<glm::vec4> ShadowCasters;
+ParticleSystem Particles;
+TrailRenderer BallTrails;
+// NOTE: Balls this far above the floor and moving faster than this leave a trail
+const float BallTrailMinHeight = 0.2f;
+const float BallTrailMinSpeed = 4.0f;
+unsigned CannonOcclusionSlot;
+unsigned BalloonOcclusionSlot;
+unsigned CatOcclusionSlots[2];
+InstanceRingBuffer BallInstances;
+InstanceRingBuffer BallShadowInstances;
+Frustum ViewFrustum;
+LodSelector FrameLod;
+unsigned BalloonLod = 0;
+RenderQueue FrameQueue;
+unsigned SceneLightState;
+unsigned CannonLightState;
+unsigned FloorLightState;
+CullStats FrameCullStats;
+unsigned FrameBatchedTriangles;
+float LastStatsReportTime = 0.0f;
+WindField Wind;
 float LastShootTime = glfwGetTime();
 float CannonUpperShootLimit = 60.0f;
 float CannonLowerShootLimit = 5.0f;
@@ -38,21 +112,50 @@ bool MovementDebug = false;
 bool MovementDebugFreeze = true;
 float MovementStep = 1.5F / TargetFPS;
 
+// NOTE: Balls past ReducedDistance from the camera and the balloon skip ball - ball contacts and
+// integrate every few frames, past FrozenDistance (close to the far plane) they stop simulating
+SimulationLOD SimLOD = { 50.0f, 180.0f, 5.0f, 4 };
+
 float CannonError = 0.01f;
 
 bool CatAnimationActive = false;
 int CatAnimationCounter = 0;
 
 std::random_device rd;
-std::mt19937 gen(rd());
+SnapshotRandom gen(rd());
 std::uniform_real_distribution<float> CannonErrorDistribution(-CannonError, CannonError);
 std::uniform_real_distribution<float> BalloonPositionDistribution(10.0f, 30.0f);
 std::uniform_real_distribution<float> BallOrientationDistribution(0.0f, 90.0f);
 
 glm::vec3 balloonPos;
+float BalloonRotationAngle = glm::radians(45.0f);
+
+SnapshotWriter QuickSave;
+const std::string QuickSavePath = "quicksave.snap";
 
 float CatRotationAngle = glm::radians(-3.1419f);
 
+QualityTier CurrentQuality = QUALITY_HIGH;
+QualityBenchmark QualityBench;
+// NOTE: Material program of each tier, Gouraud, Phong and Phong with shadows and clustered lights
+Shader* QualityShaders[QUALITY_TIER_COUNT];
+Shader* TerrainShaders[QUALITY_TIER_COUNT];
+ClipmapTerrain Terrain;
+HudText Hud;
+bool HudReady = false;
+// NOTE: First font that loads is used, the game doesn't ship one so the Windows fonts are the fallback
+const char* HudFontPaths[] = { "res/fonts/hud.ttf", "C:/Windows/Fonts/consola.ttf", "C:/Windows/Fonts/arial.ttf" };
+unsigned HudScoreLabel;
+unsigned HudStrengthLabel;
+unsigned HudFpsLabel;
+unsigned HudQualityLabel;
+// NOTE: Smoothed full frame time and the last frame's time before the sleep, for the HUD
+float HudFrameTime = 0.0f;
+float LastWorkTime = 0.0f;
+FrameCapture Capture;
+// NOTE: Sequences are raw frames, PNG encoding can't keep up with every frame
+const std::string CaptureSequencePrefix = "capture";
+
 struct Input {
     bool MoveLeft;
     bool MoveRight;
@@ -67,6 +170,8 @@ struct Input {
     bool ShootCannon;
     bool CannonUpStrenght;
     bool CannonDownStrenght;
+    bool SaveSnapshot;
+    bool LoadSnapshot;
 };
 
 struct CannonState {
@@ -85,6 +190,12 @@ struct EngineState {
     float mDT;
 };
 
+void SetQualityTier(QualityTier Tier)
+{
+    CurrentQuality = Tier;
+    Texture::SetBaseLevel(qualitySettings(Tier).TextureBaseLevel);
+}
+
 static void
 ErrorCallback(int error, const char* description) {
     std::cerr << "GLFW Error: " << description << std::endl;
@@ -111,6 +222,21 @@ KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
     case GLFW_KEY_KP_ADD: UserInput->CannonUpStrenght = IsDown; break;
     case GLFW_KEY_KP_SUBTRACT: UserInput->CannonDownStrenght = IsDown; break;
     case GLFW_KEY_F: MovementDebugFreeze = IsDown; break;
+    case GLFW_KEY_F5: UserInput->SaveSnapshot = IsDown; break;
+    case GLFW_KEY_F9: UserInput->LoadSnapshot = IsDown; break;
+    case GLFW_KEY_P: if (action == GLFW_PRESS) FrameQueue.SetDepthPrepass(!FrameQueue.GetDepthPrepass()); break;
+    case GLFW_KEY_F12: {
+        if (action != GLFW_PRESS) break;
+        Capture.RequestScreenshot("screenshot_" + std::to_string((long long)std::time(0)) + ".png");
+    } break;
+    case GLFW_KEY_F11: if (action == GLFW_PRESS) Capture.ToggleSequence(CaptureSequencePrefix, CAPTURE_RAW); break;
+    case GLFW_KEY_Q: {
+        // NOTE: Picking a tier by hand ends the startup benchmark
+        if (action != GLFW_PRESS) break;
+        QualityBench.Cancel();
+        SceneResolution.SetLocked(false);
+        SetQualityTier((QualityTier)((CurrentQuality + 1) % QUALITY_TIER_COUNT));
+    } break;
   
     case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(window, GLFW_TRUE); break;
     }
@@ -173,6 +299,7 @@ void ShootBall(EngineState* state) {
         Sphere* sphere = new Sphere{ 10.0f, 0.4f, state->mCannonState->mBarrelEnd, shootvector * state->mCannonState->mStrenght, glm::quat(glm::vec3(BallOrientationDistribution(gen),BallOrientationDistribution(gen),BallOrientationDistribution(gen)))};
         SphereList.push_back(sphere);
         LastShootTime = glfwGetTime();
+        Particles.Emit(PARTICLE_SMOKE, state->mCannonState->mBarrelEnd, state->mCannonState->mForwardVector, 3.0f, 256);
     }
 }
 
@@ -181,6 +308,66 @@ void UpdateCannonStrenght(EngineState* state,float delta) {
     state->mCannonState->mStrenght += delta;
 }
 
+void SaveWorldSnapshot(SnapshotWriter& writer, const CannonState& cannon) {
+    writer.Begin();
+    serializePhysicsWorld(writer, SphereList, PlaneList, CylinderList, BoxList, CapsuleList, HullList);
+    writer.Write(balloonPos);
+    writer.Write(BalloonRotationAngle);
+    writer.Write(PlayerScore);
+    writer.Write(LastShootTime);
+    writer.Write(gen.GetState());
+    writer.Write(cannon);
+}
+
+// NOTE: Restores read into these and swap them with the live lists. A blob failing partway leaves
+// the world untouched, and the swapped out bodies are reused by the next restore so it doesn't allocate
+list<Sphere*> RestoreSpheres;
+list<Plane*> RestorePlanes;
+list<Cylinder*> RestoreCylinders;
+list<Box*> RestoreBoxes;
+list<Capsule*> RestoreCapsules;
+list<ConvexHull*> RestoreHulls;
+
+bool LoadWorldSnapshot(const std::vector<unsigned char>& data, CannonState& cannon) {
+    SnapshotReader reader(data);
+    glm::vec3 Balloon;
+    float BalloonAngle = 0.0f;
+    int Score = 0;
+    float ShootTime = 0.0f;
+    SnapshotRandom::State Gen;
+    CannonState Cannon = cannon;
+
+    bool Loaded = reader.Begin()
+        && deserializePhysicsWorld(reader, RestoreSpheres, RestorePlanes, RestoreCylinders, RestoreBoxes, RestoreCapsules, RestoreHulls)
+        && reader.Read(Balloon)
+        && reader.Read(BalloonAngle)
+        && reader.Read(Score)
+        && reader.Read(ShootTime)
+        && reader.Read(Gen)
+        && reader.Read(Cannon)
+        && !reader.Remaining()
+        && Gen.Draws <= SNAPSHOT_MAX_RANDOM_DRAWS;
+
+    if (!Loaded) {
+        std::cerr << "[Err] Failed to restore world snapshot" << std::endl;
+        return false;
+    }
+
+    SphereList.swap(RestoreSpheres);
+    PlaneList.swap(RestorePlanes);
+    CylinderList.swap(RestoreCylinders);
+    BoxList.swap(RestoreBoxes);
+    CapsuleList.swap(RestoreCapsules);
+    HullList.swap(RestoreHulls);
+    balloonPos = Balloon;
+    BalloonRotationAngle = BalloonAngle;
+    PlayerScore = Score;
+    LastShootTime = ShootTime;
+    gen.SetState(Gen);
+    cannon = Cannon;
+    return true;
+}
+
 static void
 HandleInput(EngineState* state) {
     Input* UserInput = state->mInput;
@@ -199,41 +386,26 @@ HandleInput(EngineState* state) {
     if (UserInput->ShootCannon) ShootBall(state);
     if (UserInput->CannonUpStrenght) UpdateCannonStrenght(state,1.0f);
     if (UserInput->CannonDownStrenght) UpdateCannonStrenght(state,-1.0f);
-}
-
-
 
-static void
-DrawFloor(unsigned vao, const Shader& shader, unsigned texture) {
-    glUseProgram(shader.GetId());
-    glBindVertexArray(vao);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    float Size = 15.0f;
-    for (int i = -16; i < 32; ++i) {
-        for (int j = -16; j < 32; ++j) {
-            glm::mat4 Model(1.0f);
-            Model = glm::translate(Model, glm::vec3(i * Size, 0.0f, j * Size));
-            Model = glm::scale(Model, glm::vec3(Size, 0.1f, Size));
-            shader.SetModel(Model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+    if (UserInput->SaveSnapshot) {
+        UserInput->SaveSnapshot = false;
+        SaveWorldSnapshot(QuickSave, *state->mCannonState);
+        writeSnapshotFile(QuickSavePath, QuickSave.Data());
+        std::cout << "World saved (" << QuickSave.Data().size() << " bytes)" << std::endl;
+    }
+    if (UserInput->LoadSnapshot) {
+        UserInput->LoadSnapshot = false;
+        std::vector<unsigned char> Data;
+        if (readSnapshotFile(QuickSavePath, Data) && LoadWorldSnapshot(Data, *state->mCannonState)) {
+            std::cout << "World restored" << std::endl;
         }
     }
-
-    glBindVertexArray(0);
-    glUseProgram(0);
 }
 
-void RenderPalmAt(glm::mat4& ModelMatrix, Shader* CurrentShader, Model& Palm, glm::vec3 position)
-{
-    ModelMatrix = glm::mat4(1.0f);
-    ModelMatrix = glm::translate(ModelMatrix, position);
-    ModelMatrix = glm::scale(ModelMatrix, glm::vec3(0.02f, 0.02f, 0.02f));
-    CurrentShader->SetModel(ModelMatrix);
-    Palm.Render();
-}
+
+
+// NOTE: Height of the flat playing field, matches the physics ground plane
+const float FloorTopHeight = 0.05f;
 
 void AddPalmLocations()
 {
@@ -279,17 +451,375 @@ void AddPalmLocations()
     }
 }
 
-void AddPalms(glm::mat4& ModelMatrix, Shader* CurrentShader, Model& Palm)
+void AddCrates()
 {
+    glm::mat3 Straight(1.0f);
+    glm::mat3 Turned = glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    BoxList.push_back(new Box{ glm::vec3(18.0f, 1.1f, 6.0f), glm::vec3(1.0f), Straight });
+    BoxList.push_back(new Box{ glm::vec3(18.0f, 1.1f, -6.0f), glm::vec3(1.0f), Turned });
+    BoxList.push_back(new Box{ glm::vec3(18.0f, 3.1f, 6.0f), glm::vec3(1.0f), Turned });
+
+    // NOTE: Low wall in front of the inner palm ring
+    BoxList.push_back(new Box{ glm::vec3(32.0f, 2.1f, 0.0f), glm::vec3(0.5f, 2.0f, 10.0f), Straight });
+}
+
+void AddRocks()
+{
+    buildRockHull(RockShape, 1.6f, 0.8f, 1.8f, glm::vec2(0.3f, -0.2f));
+
+    const glm::vec3 RockPositions[] = { glm::vec3(24.0f, floorHeight, 10.0f), glm::vec3(24.0f, floorHeight, -10.0f) };
+    const float RockYaws[] = { 20.0f, -40.0f };
+    for (int i = 0; i < 2; ++i) {
+        ConvexHull* Rock = new ConvexHull(RockShape);
+        Rock->Position = RockPositions[i];
+        Rock->Rotation = glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(RockYaws[i]), glm::vec3(0.0f, 1.0f, 0.0f)));
+        HullList.push_back(Rock);
+    }
+}
+
+/**
+ * @brief Triangulates a rock hull built by buildRockHull, faces follow the cube vertex layout
+ *
+ * @returns VAO with 36 vertices of position, flat normal and UV
+ */
+unsigned
+CreateRockVAO(const ConvexHull& Shape) {
+    // NOTE: Corner indices per triangle for the front, left, right, bottom, top and back faces
+    static const int RockTriangles[12][3] = {
+        { 4, 5, 6 }, { 5, 7, 6 }, { 0, 4, 2 }, { 4, 6, 2 }, { 5, 1, 7 }, { 1, 3, 7 },
+        { 0, 1, 4 }, { 1, 5, 4 }, { 6, 7, 2 }, { 7, 3, 2 }, { 1, 0, 3 }, { 0, 2, 3 },
+    };
+    static const float FaceUVs[6][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+    std::vector<float> Vertices;
+    for (int Triangle = 0; Triangle < 12; ++Triangle) {
+        const int* Corners = RockTriangles[Triangle];
+        glm::vec3 Normal = glm::normalize(glm::cross(Shape.Points[Corners[1]] - Shape.Points[Corners[0]], Shape.Points[Corners[2]] - Shape.Points[Corners[0]]));
+        for (int Corner = 0; Corner < 3; ++Corner) {
+            const glm::vec3& Point = Shape.Points[Corners[Corner]];
+            const float* UV = FaceUVs[(Triangle % 2) * 3 + Corner];
+            Vertices.insert(Vertices.end(), { Point.x, Point.y, Point.z, Normal.x, Normal.y, Normal.z, UV[0], UV[1] });
+        }
+    }
+
+    unsigned VAO;
+    glGenVertexArrays(1, &VAO);
+    GLState.BindVertexArray(VAO);
+    unsigned VBO;
+    glGenBuffers(1, &VBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+    return VAO;
+}
+
+glm::mat4 RockMatrix(const ConvexHull* hull)
+{
+    return glm::translate(glm::mat4(1.0f), hull->Position) * glm::mat4(hull->Rotation);
+}
+
+float HullRadius(const ConvexHull* hull)
+{
+    float Radius = 0.0f;
+    for (const glm::vec3& Point : hull->Points) Radius = glm::max(Radius, glm::length(Point));
+    return Radius;
+}
+
+glm::mat4 CrateMatrix(const Box* box)
+{
+    glm::mat4 ModelMatrix = glm::translate(glm::mat4(1.0f), box->Center);
+    ModelMatrix = ModelMatrix * glm::mat4(box->Axes);
+    return glm::scale(ModelMatrix, 2.0f * box->HalfExtents);
+}
+
+static void
+SubmitCrates(unsigned vao, Shader* shader, unsigned diffuseTexture, unsigned specularTexture) {
+    for (Box* box : BoxList) {
+        if (!ViewFrustum.TestSphere(box->Center, glm::length(box->HalfExtents))) {
+            FrameCullStats.Culled++;
+            continue;
+        }
+        FrameCullStats.Visible++;
+
+        DrawCommand Command = {};
+        Command.Program = shader;
+        Command.State = SceneLightState;
+        Command.VAO = vao;
+        Command.Count = 36;
+        Command.DiffuseTexture = diffuseTexture;
+        Command.SpecularTexture = specularTexture;
+        Command.ModelMatrix = CrateMatrix(box);
+        FrameQueue.Submit(RENDER_PASS_OPAQUE, Command, FrameQueue.ViewDistance(box->Center));
+    }
+}
+
+static void
+SubmitRocks(unsigned vao, Shader* shader, unsigned diffuseTexture, unsigned specularTexture) {
+    for (ConvexHull* hull : HullList) {
+        if (!ViewFrustum.TestSphere(hull->Position, HullRadius(hull))) {
+            FrameCullStats.Culled++;
+            continue;
+        }
+        FrameCullStats.Visible++;
+
+        DrawCommand Command = {};
+        Command.Program = shader;
+        Command.State = SceneLightState;
+        Command.VAO = vao;
+        Command.Count = 36;
+        Command.DiffuseTexture = diffuseTexture;
+        Command.SpecularTexture = specularTexture;
+        Command.ModelMatrix = RockMatrix(hull);
+        FrameQueue.Submit(RENDER_PASS_OPAQUE, Command, FrameQueue.ViewDistance(hull->Position));
+    }
+}
+
+void SetupWind()
+{
+    Wind.Init(glm::vec3(-120.0f, 0.0f, -120.0f), 8.0f, 31, 8, 31);
+    Wind.SetPeriod(20.0f);
+
+    std::vector<WindSource> Gusts;
+    Gusts.push_back(WindSource{ glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f), 40.0f, 0.08f });
+    Gusts.push_back(WindSource{ glm::vec3(60.0f, 15.0f, -30.0f), glm::vec3(-4.0f, 1.0f, 2.0f), 35.0f, 0.0f });
+    Wind.Bake(0, glm::vec3(1.5f, 0.0f, 0.5f), Gusts);
+
+    Gusts.clear();
+    Gusts.push_back(WindSource{ glm::vec3(-20.0f, 10.0f, 30.0f), glm::vec3(0.0f), 45.0f, -0.06f });
+    Gusts.push_back(WindSource{ glm::vec3(-60.0f, 15.0f, 20.0f), glm::vec3(3.0f, 0.5f, -3.0f), 35.0f, 0.0f });
+    Wind.Bake(1, glm::vec3(-0.5f, 0.0f, 1.5f), Gusts);
+}
+
+void BuildStaticBatches(Model& Palm)
+{
+    // NOTE: Palms never move, their transforms are baked into shared
+    // buffers once and each material is drawn with a single multi-draw
+    StaticBatchBuilder Builder;
     for (glm::vec3 pos : PalmPositionsList) {
-        RenderPalmAt(ModelMatrix, CurrentShader, Palm, pos);
+        glm::mat4 ModelMatrix = glm::mat4(1.0f);
+        ModelMatrix = glm::translate(ModelMatrix, pos);
+        ModelMatrix = glm::scale(ModelMatrix, glm::vec3(0.02f, 0.02f, 0.02f));
+        unsigned OcclusionSlot = Occlusion.AddObject();
+        Builder.AddModel(Palm, ModelMatrix, SceneLightState, 0, PalmImpostorDistance, OcclusionSlot);
+
+        BoundingSphere Sphere = transformBoundingSphere(Palm.GetBoundingSphere(), ModelMatrix);
+        PalmTransforms.push_back(ModelMatrix);
+        PalmBounds.push_back(glm::vec4(Sphere.Center, Sphere.Radius));
+        PalmOcclusionBoxes.push_back(occlusionBoxTransform(Palm.GetAABB(), ModelMatrix));
+        PalmOcclusionSlots.push_back(OcclusionSlot);
     }
+    PalmVisible.resize(PalmBounds.size());
+
+    Builder.Build(StaticBatches);
+}
+
+bool IsVisible(const Model& model, const glm::mat4& ModelMatrix)
+{
+    BoundingSphere Bounds = transformBoundingSphere(model.GetBoundingSphere(), ModelMatrix);
+    bool Visible = ViewFrustum.TestSphere(Bounds.Center, Bounds.Radius);
+    if (Visible) FrameCullStats.Visible++;
+    else FrameCullStats.Culled++;
+    return Visible;
+}
+
+bool PassesOcclusion(unsigned Slot, const Model& model, const glm::mat4& ModelMatrix)
+{
+    if (Occlusion.Test(Slot, occlusionBoxTransform(model.GetAABB(), ModelMatrix))) return true;
+    FrameCullStats.Visible--;
+    FrameCullStats.Culled++;
+    return false;
+}
+
+void SubmitStaticBatches(Shader* CurrentShader)
+{
+    for (StaticBatch& Batch : StaticBatches) {
+        unsigned VisibleCount = Batch.Submit(FrameQueue, CurrentShader, ViewFrustum, FrameLod, Occlusion);
+        FrameCullStats.Visible += VisibleCount;
+        FrameCullStats.Culled += Batch.GetDrawCount() - VisibleCount;
+        FrameBatchedTriangles += Batch.GetTriangleCount();
+    }
+}
+
+// NOTE: Queues the occlusion test of every palm in view and submits the far ones as impostors,
+// the near ones are drawn by the static batches. Has to run before SubmitStaticBatches
+void SubmitPalms(Shader* ImpostorShader, const glm::vec3& ViewPosition)
+{
+    unsigned VisibleCount = ViewFrustum.CullSpheres(PalmBounds.data(), PalmBounds.size(), PalmVisible.data());
+    if (!VisibleCount) return;
+
+    // NOTE: Same distance test as the static batches use to skip these palms, one or the other draws each.
+    // Occlusion tests are queued even if the map failed, only the impostors are skipped then
+    glm::mat4* Instances = PalmImpostorInstances.Map(VisibleCount);
+    unsigned ImpostorCount = 0;
+    for (unsigned VisibleIdx = 0; VisibleIdx < VisibleCount; ++VisibleIdx) {
+        unsigned PalmIdx = PalmVisible[VisibleIdx];
+        if (!Occlusion.Test(PalmOcclusionSlots[PalmIdx], PalmOcclusionBoxes[PalmIdx])) continue;
+
+        const glm::vec4& Sphere = PalmBounds[PalmIdx];
+        if (glm::length(glm::vec3(Sphere.x, Sphere.y, Sphere.z) - ViewPosition) < PalmImpostorDistance) continue;
+        if (Instances) Instances[ImpostorCount++] = PalmTransforms[PalmIdx];
+    }
+    unsigned Offset = PalmImpostorInstances.Unmap(ImpostorCount);
+
+    FrameCullStats.Visible += ImpostorCount;
+    PalmImpostor.Submit(FrameQueue, ImpostorShader, SceneLightState, PalmImpostorInstances.GetId(), Offset, PalmImpostorInstances.GetCount());
+}
+
+void DrawHud(const EngineState& State)
+{
+    if (!HudReady) return;
+    HudFrameTime = HudFrameTime > 0.0f ? HudFrameTime + (State.mDT - HudFrameTime) * 0.05f : State.mDT;
+
+    Hud.Begin();
+    char Value[96];
+    glm::vec2 Position(16.0f, 16.0f);
+    snprintf(Value, sizeof(Value), "%d", PlayerScore);
+    Hud.Print(Value, glm::vec2(Hud.DrawStatic(HudScoreLabel, Position), Position.y));
+    Position.y += Hud.GetLineHeight();
+    snprintf(Value, sizeof(Value), "%.1f", State.mCannonState->mStrenght);
+    Hud.Print(Value, glm::vec2(Hud.DrawStatic(HudStrengthLabel, Position), Position.y));
+    Position.y += Hud.GetLineHeight();
+    snprintf(Value, sizeof(Value), "%.0f  CPU: %.1f ms  GPU scene: %.1f ms", HudFrameTime > 0.0f ? 1.0f / HudFrameTime : 0.0f, LastWorkTime * 1000.0f, SceneResolution.GetSceneTime() * 1000.0f);
+    Hud.Print(Value, glm::vec2(Hud.DrawStatic(HudFpsLabel, Position), Position.y));
+    Position.y += Hud.GetLineHeight();
+    snprintf(Value, sizeof(Value), "%s  Res: %d%%  GL calls: %u", qualitySettings(CurrentQuality).Name, (int)(SceneResolution.GetScale() * 100.0f + 0.5f), GLState.GetIssuedCalls());
+    Hud.Print(Value, glm::vec2(Hud.DrawStatic(HudQualityLabel, Position), Position.y));
+    Hud.Render(WindowWidth, WindowHeight);
+}
+
+void ReportFrameStats(GLFWwindow* Window)
+{
+    float Now = glfwGetTime();
+    if (Now - LastStatsReportTime < 0.5f) return;
+    LastStatsReportTime = Now;
+
+    std::string Title = WindowTitle + " | Visible: " + std::to_string(FrameCullStats.Visible) + " Culled: " + std::to_string(FrameCullStats.Culled)
+        + " | GL calls: " + std::to_string(GLState.GetIssuedCalls()) + " Skipped: " + std::to_string(GLState.GetSkippedCalls())
+        + " | Static tris: " + std::to_string(FrameBatchedTriangles) + " | Occluded: " + std::to_string(Occlusion.GetOccludedCount())
+        + " | Res: " + std::to_string((int)(SceneResolution.GetScale() * 100.0f + 0.5f)) + "% Scene: " + std::to_string((int)(SceneResolution.GetSceneTime() * 1000.0f)) + "ms";
+    // NOTE: Fragments that passed the depth test in opaque shading per scene pixel, 1 is no overdraw on covered pixels
+    float ScenePixels = WindowWidth * SceneResolution.GetScale() * WindowHeight * SceneResolution.GetScale();
+    float ShadedPerPixel = ScenePixels > 0.0f ? FrameQueue.GetShadedSamples() / ScenePixels : 0.0f;
+    char Overdraw[16];
+    snprintf(Overdraw, sizeof(Overdraw), "%.2f", ShadedPerPixel);
+    Title += " | Shadow casters: " + std::to_string(ShadowCasters.size()) + " Static redraws: " + std::to_string(SunShadows.GetStaticRedraws());
+    Title += " | Lights: " + std::to_string(SceneLights.GetLightCount()) + " Max/cluster: " + std::to_string(SceneLights.GetMaxClusterLights());
+    Title += std::string(" | Pre-pass: ") + (FrameQueue.GetDepthPrepass() ? "on" : "off") + " Shaded/px: " + Overdraw;
+    if (Capture.IsRecording()) Title += " | REC dropped: " + std::to_string(Capture.GetDroppedFrames());
+    Title += std::string(" | Quality: ") + qualitySettings(CurrentQuality).Name + (QualityBench.IsRunning() ? " (benchmarking)" : "");
+    glfwSetWindowTitle(Window, Title.c_str());
+}
+
+void AddShadowCaster(Model& model, const glm::mat4& ModelMatrix, unsigned Lod = 0)
+{
+    BoundingSphere Bounds = transformBoundingSphere(model.GetBoundingSphere(), ModelMatrix);
+    ShadowCasters.push_back(glm::vec4(Bounds.Center, Bounds.Radius));
+    model.Submit(ShadowQueue, ShadowCasterShader, RENDER_STATE_NONE, ModelMatrix, 0, Lod);
+}
+
+void RenderStaticShadows(unsigned CrateVAO, unsigned RockVAO)
+{
+    if (!SunShadows.BeginStatic()) return;
+
+    StaticShadowQueue.Begin(glm::vec3(0.0f), 1.0f);
+    GLState.UseProgram(ShadowCasterShader->GetId());
+    ShadowCasterShader->SetProjection(SunShadows.GetStaticMatrix());
+    ShadowCasterShader->SetView(glm::mat4(1.0f));
+    for (StaticBatch& Batch : StaticBatches) Batch.SubmitAll(StaticShadowQueue, ShadowCasterShader, RENDER_STATE_NONE, 1);
+    for (Box* box : BoxList) {
+        DrawCommand Command = {};
+        Command.Program = ShadowCasterShader;
+        Command.State = RENDER_STATE_NONE;
+        Command.VAO = CrateVAO;
+        Command.Count = 36;
+        Command.ModelMatrix = CrateMatrix(box);
+        StaticShadowQueue.Submit(RENDER_PASS_OPAQUE, Command, 0.0f);
+    }
+    for (ConvexHull* hull : HullList) {
+        DrawCommand Command = {};
+        Command.Program = ShadowCasterShader;
+        Command.State = RENDER_STATE_NONE;
+        Command.VAO = RockVAO;
+        Command.Count = 36;
+        Command.ModelMatrix = RockMatrix(hull);
+        StaticShadowQueue.Submit(RENDER_PASS_OPAQUE, Command, 0.0f);
+    }
+    StaticShadowQueue.Flush();
+    SunShadows.EndStatic();
+}
+
+void RenderDynamicShadows()
+{
+    SunShadows.BeginDynamic(ShadowCasters);
+    GLState.UseProgram(ShadowCasterShader->GetId());
+    ShadowCasterShader->SetProjection(SunShadows.GetDynamicMatrix());
+    ShadowCasterShader->SetView(glm::mat4(1.0f));
+    ShadowQueue.Flush();
+    SunShadows.EndDynamic();
+}
+
+AABB StaticCasterBounds()
+{
+    AABB Bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+    for (const glm::vec4& Sphere : PalmBounds) {
+        Bounds.Min = glm::min(Bounds.Min, glm::vec3(Sphere) - glm::vec3(Sphere.w));
+        Bounds.Max = glm::max(Bounds.Max, glm::vec3(Sphere) + glm::vec3(Sphere.w));
+    }
+    for (Box* box : BoxList) {
+        float Radius = glm::length(box->HalfExtents);
+        Bounds.Min = glm::min(Bounds.Min, box->Center - glm::vec3(Radius));
+        Bounds.Max = glm::max(Bounds.Max, box->Center + glm::vec3(Radius));
+    }
+    for (ConvexHull* hull : HullList) {
+        float Radius = HullRadius(hull);
+        Bounds.Min = glm::min(Bounds.Min, hull->Position - glm::vec3(Radius));
+        Bounds.Max = glm::max(Bounds.Max, hull->Position + glm::vec3(Radius));
+    }
+    return Bounds;
+}
+
+void TrackBallTrails()
+{
+    BallTrails.Begin();
+    for (auto sphere : SphereList) {
+        bool Airborne = sphere->Position.y - sphere->Radius > FloorTopHeight + BallTrailMinHeight;
+        if (Airborne && glm::length(sphere->Velocity) > BallTrailMinSpeed) BallTrails.Track(sphere, sphere->Position);
+    }
+}
+
+void BuildSceneLights(const glm::mat4& View, const glm::mat4& Projection)
+{
+    SceneLights.Begin();
+    for (auto sphere : SphereList) {
+        if (glm::length(sphere->Velocity) > BallLightMinSpeed) SceneLights.AddLight(sphere->Position, BallLightRadius, glm::vec3(1.0f, 0.6f, 0.3f));
+    }
+
+    float Now = glfwGetTime();
+    unsigned Alive = 0;
+    for (unsigned FlashIdx = 0; FlashIdx < PopFlashes.size(); ++FlashIdx) {
+        float Age = Now - PopFlashes[FlashIdx].w;
+        if (Age >= PopFlashDuration) continue;
+        float Fade = 1.0f - Age / PopFlashDuration;
+        SceneLights.AddLight(glm::vec3(PopFlashes[FlashIdx]), PopFlashRadius, glm::vec3(3.0f, 2.4f, 1.8f) * Fade);
+        PopFlashes[Alive++] = PopFlashes[FlashIdx];
+    }
+    PopFlashes.resize(Alive);
+
+    SceneLights.Build(View, Projection, 0.1f, qualitySettings(CurrentQuality).DrawDistance);
 }
 
 void SetupPhongLight(Shader PhongShaderMaterialTexture)
 {
     // Adjust directional light (sun)
-    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Direction", glm::vec3(1.0f, -1.0f, 0.5f));
+    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Direction", SunDirection);
     PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ka", glm::vec3(0.8f, 0.8f, 0.6f));  // Warm ambient color
     PhongShaderMaterialTexture.SetUniform3f("uDirLight.Kd", glm::vec3(0.9f, 0.9f, 0.7f));  // Diffuse color
     PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ks", glm::vec3(1.0f, 1.0f, 1.0f));  // Specular color
@@ -324,7 +854,7 @@ void SetupPhongLight(Shader PhongShaderMaterialTexture)
 void SetupPhongFloorLight(Shader PhongShaderMaterialTexture)
 {
     // Adjust directional light (sun)
-    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Direction", glm::vec3(1.0f, -1.0f, 0.5f));
+    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Direction", SunDirection);
     PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ka", glm::vec3(0.8f, 0.8f, 0.6f));  // Warm ambient color
     PhongShaderMaterialTexture.SetUniform3f("uDirLight.Kd", glm::vec3(0.9f, 0.9f, 0.7f));  // Diffuse color
     PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ks", glm::vec3(0.0f, 0.0f, 0.0f));  // No specular color
@@ -356,12 +886,31 @@ void SetupPhongFloorLight(Shader PhongShaderMaterialTexture)
 
 }
 
+void SetupCannonLight(Shader PhongShaderMaterialTexture, float strength)
+{
+    // NOTE: Cannon glows redder the stronger the shot
+    SetupPhongFloorLight(PhongShaderMaterialTexture);
+
+    float redScale = strength / 60.0f;
+    glm::vec3 redColor = glm::mix(glm::vec3(1.0f), glm::vec3(1.0f, 0.0f, 0.0f), redScale);
+
+    PhongShaderMaterialTexture.SetUniform3f("uPointLight.Ka", redColor * 0.3f);  // Ambient component
+    PhongShaderMaterialTexture.SetUniform3f("uPointLight.Kd", redColor * 0.6f);  // Diffuse component
+    PhongShaderMaterialTexture.SetUniform3f("uPointLight.Ks", glm::vec3(1.0f, 1.0f, 1.0f));  // Specular component
+
+    PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Ka", redColor * 0.9f);  // Ambient component
+    PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Kd", redColor * 0.4f);  // Diffuse component
+    PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Ks", glm::vec3(1.0f, 1.0f, 1.0f));  // Specular component
+
+    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Kd", redColor * 0.6f);  // Diffuse component
+    PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ks", glm::vec3(0.8f, 0.8f, 0.8f));  // Specular component
+}
 
 unsigned int loadCubemap(vector<std::string> faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLState.BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++)
@@ -395,6 +944,8 @@ void checkBalloonHit(Sphere* sphere,float balloonRadius, glm::vec3 ballonPosWith
 
 
     if (distance < sphere->Radius + balloonRadius) {
+        PopFlashes.push_back(glm::vec4(balloonCenterPos, glfwGetTime()));
+        Particles.Emit(PARTICLE_POP, balloonCenterPos, glm::vec3(0.0f, 1.0f, 0.0f), 6.0f, 2048);
         balloonPos = glm::vec3(BalloonPositionDistribution(gen), BalloonPositionDistribution(gen)  - 8.f, BalloonPositionDistribution(gen));
         PlayerScore += 1;
         std::cout << "Balloon popped! Player Score: " << PlayerScore << std::endl << std::endl;
@@ -422,15 +973,19 @@ void DoCatCelebration(float& CatRotationAngle, EngineState& State, float CatVert
     ModelMatrix = glm::translate(ModelMatrix, glm::vec3(objectPositionLeft.x, 0.0f + verticalOffset, objectPositionLeft.z));
     ModelMatrix = glm::rotate(ModelMatrix, CatRotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
     ModelMatrix = glm::scale(ModelMatrix, glm::vec3(0.1f, 0.1f, 0.1f));
-    CurrentShader->SetModel(ModelMatrix);
-    Cat.Render();
+    AddShadowCaster(Cat, ModelMatrix);
+    if (IsVisible(Cat, ModelMatrix) && PassesOcclusion(CatOcclusionSlots[0], Cat, ModelMatrix)) {
+        Cat.Submit(FrameQueue, CurrentShader, FloorLightState, ModelMatrix, 0, 0, Occlusion.GetConditionQuery(CatOcclusionSlots[0]));
+    }
 
     ModelMatrix = glm::mat4(1.0f);
     ModelMatrix = glm::translate(ModelMatrix, glm::vec3(objectPositionRight.x, 0.0f + verticalOffset, objectPositionRight.z));
     ModelMatrix = glm::rotate(ModelMatrix, CatRotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
     ModelMatrix = glm::scale(ModelMatrix, glm::vec3(0.1f, 0.1f, 0.1f));
-    CurrentShader->SetModel(ModelMatrix);
-    Cat.Render();
+    AddShadowCaster(Cat, ModelMatrix);
+    if (IsVisible(Cat, ModelMatrix) && PassesOcclusion(CatOcclusionSlots[1], Cat, ModelMatrix)) {
+        Cat.Submit(FrameQueue, CurrentShader, FloorLightState, ModelMatrix, 0, 0, Occlusion.GetConditionQuery(CatOcclusionSlots[1]));
+    }
 
     CatAnimationCounter += 1;
     if (CatAnimationCounter >= 45) {
@@ -508,11 +1063,14 @@ int main() {
 
     unsigned CubeDiffuseTexture = Texture::LoadImageToTexture("res/don.jpeg");
     unsigned CubeSpecularTexture = Texture::LoadImageToTexture("res/container_specular.png");
+    unsigned CrateDiffuseTexture = Texture::LoadImageToTexture("res/container_diffuse.png");
     unsigned FloorTexture1 = Texture::LoadImageToTexture("res/sand.jpg");
     unsigned FloorTexture2 = Texture::LoadImageToTexture("res/beach.jpg");
     unsigned SkyboxTexture = Texture::LoadImageToTexture("res/skybox.png");
     unsigned MetalTexture = Texture::LoadImageToTexture("res/metal.jpg");
     unsigned RustyMetalTexture = Texture::LoadImageToTexture("res/rusty_metal.jpg");
+    // NOTE: Rocks are matte, a dark flat specular map keeps only a faint highlight
+    unsigned RockSpecularTexture = Texture::CreateSolidTexture(16, 16, 16);
     unsigned SignatureTexture = Texture::LoadImageToTexture("res/potpis.png");
 
     
@@ -538,8 +1096,8 @@ int main() {
     glGenBuffers(1, &VBO_signature);
 
     // index and name attributes
-    glBindVertexArray(VAO_signature);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_signature);
+    GLState.BindVertexArray(VAO_signature);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, VBO_signature);
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(signatureVertices), signatureVertices, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, (2 + 2) * sizeof(float), (void*)0);
@@ -547,8 +1105,8 @@ int main() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, (2 + 2) * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
 
 
     std::vector<float> CubeVertices = {
@@ -598,10 +1156,10 @@ int main() {
 
     unsigned CubeVAO;
     glGenVertexArrays(1, &CubeVAO);
-    glBindVertexArray(CubeVAO);
+    GLState.BindVertexArray(CubeVAO);
     unsigned CubeVBO;
     glGenBuffers(1, &CubeVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, CubeVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, CubeVBO);
     glBufferData(GL_ARRAY_BUFFER, CubeVertices.size() * sizeof(float), CubeVertices.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -609,8 +1167,9 @@ int main() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+
     #pragma endregion 
 
     #pragma region skybox_setup
@@ -664,8 +1223,8 @@ int main() {
     unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+    GLState.BindVertexArray(skyboxVAO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -720,19 +1279,83 @@ int main() {
     Shader SkyboxShader("shaders/skybox.vert", "shaders/skybox.frag");
 
 
-    glUseProgram(SkyboxShader.GetId());
+    GLState.UseProgram(SkyboxShader.GetId());
     SkyboxShader.SetUniform1i("skybox", 0);
-    glUseProgram(0);
+    GLState.UseProgram(0);
 
     Shader PhongShaderMaterialTexture("shaders/basic.vert", "shaders/phong_material_texture.frag");
 
-    glUseProgram(PhongShaderMaterialTexture.GetId());
+    GLState.UseProgram(PhongShaderMaterialTexture.GetId());
     SetupPhongLight(PhongShaderMaterialTexture);
-    glUseProgram(0);
+    GLState.UseProgram(0);
     
 
     Shader Color2dShader("shaders/2dcolor.vert", "shaders/2dcolor.frag");
-    glUseProgram(0);
+    GLState.UseProgram(0);
+
+    Shader ImpostorBakeShader("shaders/impostor_bake.vert", "shaders/impostor_bake.frag");
+    Shader ImpostorShader("shaders/impostor.vert", "shaders/impostor.frag");
+    if (!PalmImpostor.Bake(Palm, ImpostorBakeShader)) {
+        std::cerr << "Failed to bake palm impostor\n";
+        glfwTerminate();
+        return -1;
+    }
+    PalmImpostor.SetupShader(ImpostorShader);
+    GLState.UseProgram(0);
+
+    Shader OcclusionProxyShader("shaders/occlusion_proxy.vert", "shaders/occlusion_proxy.frag");
+    Occlusion.Init(&OcclusionProxyShader);
+    Shader UpscaleShader("shaders/upscale.vert", "shaders/upscale.frag");
+    SceneResolution.Init(&UpscaleShader);
+    Shader DepthPrepassShader("shaders/depth_prepass.vert", "shaders/depth_prepass.frag");
+    FrameQueue.SetDepthProgram(&PhongShaderMaterialTexture, &DepthPrepassShader);
+    Shader PhongOnlyShader("shaders/basic.vert", "shaders/phong_material_texture.frag", "#define PHONG_ONLY");
+    Shader GouraudShader("shaders/gouraud_material_texture.vert", "shaders/gouraud_material_texture.frag");
+    FrameQueue.SetDepthProgram(&PhongOnlyShader, &DepthPrepassShader);
+    FrameQueue.SetDepthProgram(&GouraudShader, &DepthPrepassShader);
+    QualityShaders[QUALITY_LOW] = &GouraudShader;
+    QualityShaders[QUALITY_MEDIUM] = &PhongOnlyShader;
+    QualityShaders[QUALITY_HIGH] = &PhongShaderMaterialTexture;
+    Shader TerrainShader("shaders/terrain.vert", "shaders/phong_material_texture.frag", "#define TERRAIN");
+    Shader TerrainPhongOnlyShader("shaders/terrain.vert", "shaders/phong_material_texture.frag", "#define TERRAIN\n#define PHONG_ONLY");
+    Terrain.Init(FloorTopHeight);
+    Terrain.SetupShader(TerrainShader);
+    Terrain.SetupShader(TerrainPhongOnlyShader);
+    TerrainShaders[QUALITY_LOW] = &TerrainPhongOnlyShader;
+    TerrainShaders[QUALITY_MEDIUM] = &TerrainPhongOnlyShader;
+    TerrainShaders[QUALITY_HIGH] = &TerrainShader;
+    SceneLights.Init();
+    SceneLights.SetupShader(PhongShaderMaterialTexture);
+    SceneLights.SetupShader(TerrainShader);
+    Shader ShadowDepthShader("shaders/depth_prepass.vert", "shaders/depth_prepass.frag");
+    ShadowCasterShader = &ShadowDepthShader;
+    if (!SunShadows.Init()) {
+        std::cerr << "Failed to create shadow maps\n";
+        glfwTerminate();
+        return -1;
+    }
+    SunShadows.SetupShader(PhongShaderMaterialTexture);
+    SunShadows.SetupShader(TerrainShader);
+    Shader ParticleUpdateShader("shaders/particle_update.vert", std::vector<std::string>{ "vPositionKind", "vVelocityAge", "vLife" });
+    Shader ParticleShader("shaders/particle.vert", "shaders/particle.frag");
+    Particles.Init(&ParticleUpdateShader, &ParticleShader);
+    Shader TrailShader("shaders/trail.vert", "shaders/trail.frag");
+    BallTrails.Init(&TrailShader);
+    Capture.Init();
+    Shader HudShader("shaders/hud.vert", "shaders/hud.frag");
+    for (const char* FontPath : HudFontPaths) {
+        if ((HudReady = Hud.Init(&HudShader, FontPath, 20))) break;
+    }
+    if (HudReady) {
+        HudScoreLabel = Hud.AddStatic("Score: ");
+        HudStrengthLabel = Hud.AddStatic("Strength: ");
+        HudFpsLabel = Hud.AddStatic("FPS: ");
+        HudQualityLabel = Hud.AddStatic("Quality: ");
+    }
+    CannonOcclusionSlot = Occlusion.AddObject();
+    BalloonOcclusionSlot = Occlusion.AddObject();
+    CatOcclusionSlots[0] = Occlusion.AddObject();
+    CatOcclusionSlots[1] = Occlusion.AddObject();
 
     #pragma endregion
 
@@ -751,7 +1374,6 @@ int main() {
     float CatVerticalMotionAmplitude = 4.0f; 
     float CatVerticalMotionFrequency = 1.0f;
 
-    float BalloonRotationAngle = glm::radians(45.0f);
     float BalloonVerticalMotionAmplitude = 1.0f;
     float BalloonVerticalMotionFrequency = 0.5f;
 
@@ -762,26 +1384,74 @@ int main() {
     balloonPos =  glm::vec3(10.0f, 1.8f, -10.0f);
     
     AddPalmLocations();
+    AddCrates();
+    AddRocks();
+    unsigned RockVAO = CreateRockVAO(RockShape);
+    SetupWind();
     
 
     
+    // NOTE: Light rigs are applied by the render queue once per group of draws using them
+    SceneLightState = FrameQueue.AddState([](Shader& shader) { SetupPhongLight(shader); });
+    FloorLightState = FrameQueue.AddState([](Shader& shader) { SetupPhongFloorLight(shader); });
+    CannonLightState = FrameQueue.AddState([&State](Shader& shader) { SetupCannonLight(shader, State.mCannonState->mStrenght); });
+
+    BuildStaticBatches(Palm);
+    SunShadows.SetStaticBounds(StaticCasterBounds());
+
+    // NOTE: Starts on the highest tier and steps down until one holds TargetFPS, the scale stays at full resolution meanwhile
+    SetQualityTier(QUALITY_HIGH);
+    QualityBench.Start(QUALITY_HIGH);
+    SceneResolution.SetLocked(true);
+
     Shader* CurrentShader = &PhongShaderMaterialTexture;
     while (!glfwWindowShouldClose(Window)) {
         glfwPollEvents();
         HandleInput(&State);
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        SceneResolution.Update(TargetFrameTime);
+        const QualitySettings& Quality = qualitySettings(CurrentQuality);
+        CurrentShader = QualityShaders[CurrentQuality];
+        Projection = glm::perspective(45.0f, WindowWidth / (float)WindowHeight, 0.1f, Quality.DrawDistance);
         View = glm::lookAt(FPSCamera.GetPosition(), FPSCamera.GetTarget(), FPSCamera.GetUp());
         StartTime = glfwGetTime();
+        ViewFrustum.Extract(Projection * View);
+        Occlusion.BeginFrame(FPSCamera.GetPosition());
+        FrameLod = makeLodSelector(FPSCamera.GetPosition(), Projection);
+        FrameLod.ScreenScale *= Quality.LodBias;
+        FrameQueue.Begin(FPSCamera.GetPosition(), Quality.DrawDistance);
+        ShadowQueue.Begin(FPSCamera.GetPosition(), Quality.DrawDistance);
+        ShadowCasters.clear();
+        SunShadows.SetLightDirection(SunDirection);
+        // NOTE: Static batches share their draw arrays between passes, the cached map is drawn before the frame queues them
+        if (Quality.Shadows) RenderStaticShadows(CubeVAO, RockVAO);
+        FrameCullStats = CullStats{ 0, 0 };
+        FrameBatchedTriangles = 0;
+        GLState.BeginFrame();
         
 
 
 
-        glUseProgram(CurrentShader->GetId());
+        GLState.UseProgram(ImpostorShader.GetId());
+        ImpostorShader.SetProjection(Projection);
+        ImpostorShader.SetView(View);
+        ImpostorShader.SetUniform3f("uViewPos", FPSCamera.GetPosition());
+
+        GLState.UseProgram(CurrentShader->GetId());
         CurrentShader->SetProjection(Projection);
         CurrentShader->SetView(View);
         CurrentShader->SetUniform3f("uViewPos", FPSCamera.GetPosition());
 
+        Shader* CurrentTerrainShader = TerrainShaders[CurrentQuality];
+        GLState.UseProgram(CurrentTerrainShader->GetId());
+        CurrentTerrainShader->SetProjection(Projection);
+        CurrentTerrainShader->SetView(View);
+        CurrentTerrainShader->SetUniform3f("uViewPos", FPSCamera.GetPosition());
+
+        GLState.UseProgram(DepthPrepassShader.GetId());
+        DepthPrepassShader.SetProjection(Projection);
+        DepthPrepassShader.SetView(View);
+
         
         #pragma region dynamic_elements_draw
 
@@ -800,8 +1470,11 @@ int main() {
         ModelMatrix = glm::translate(ModelMatrix, balloonPosWithAmplitude);
 
         ModelMatrix = glm::scale(ModelMatrix, glm::vec3(0.05f, 0.04f, 0.05f));
-        CurrentShader->SetModel(ModelMatrix);
-        Balloon.Render();
+        AddShadowCaster(Balloon, ModelMatrix, BalloonLod);
+        if (IsVisible(Balloon, ModelMatrix) && PassesOcclusion(BalloonOcclusionSlot, Balloon, ModelMatrix)) {
+            BalloonLod = Balloon.SelectLod(FrameLod, ModelMatrix, BalloonLod);
+            Balloon.Submit(FrameQueue, CurrentShader, FloorLightState, ModelMatrix, 0, BalloonLod, Occlusion.GetConditionQuery(BalloonOcclusionSlot));
+        }
 
 
 
@@ -829,29 +1502,8 @@ int main() {
         ModelMatrix = glm::mat4(1.0f);
         ModelMatrix = glm::translate(ModelMatrix, ballPosition);
         ModelMatrix = glm::scale(ModelMatrix, glm::vec3(scaling, scaling, scaling));
-        CurrentShader->SetModel(ModelMatrix);
-        Beachball.Render();
-
-        float redScale = State.mCannonState->mStrenght / 60.0f;
-        glm::vec3 redColor = glm::mix(glm::vec3(1.0f), glm::vec3(1.0f, 0.0f, 0.0f), redScale);
-        glm::vec3 diffmix = glm::mix(glm::vec3(0.8f, 0.8f, 0.6f), glm::vec3(1.0f, 0.0f, 0.0f), redScale * 0.3f);
-
-        // Use the calculated color
-        PhongShaderMaterialTexture.SetUniform3f("uPointLight.Ka", redColor * 0.3f);  // Ambient component
-        PhongShaderMaterialTexture.SetUniform3f("uPointLight.Kd", redColor * 0.6f);  // Diffuse component
-        PhongShaderMaterialTexture.SetUniform3f("uPointLight.Ks", glm::vec3(1.0f, 1.0f, 1.0f));  // Specular component
-
-        PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Ka", redColor * 0.9f);  // Ambient component
-        PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Kd", redColor * 0.4f);  // Diffuse component
-        PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Ks", glm::vec3(1.0f, 1.0f, 1.0f));  // Specular component
-
-        // Directional light
-        PhongShaderMaterialTexture.SetUniform3f("uDirLight.Kd", redColor * 0.6f);  // Diffuse component
-        PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ks", glm::vec3(0.8f, 0.8f, 0.8f));  // Specular component
-
-
-
-
+        AddShadowCaster(Beachball, ModelMatrix);
+        if (IsVisible(Beachball, ModelMatrix)) Beachball.Submit(FrameQueue, CurrentShader, FloorLightState, ModelMatrix);
 
         ModelMatrix = glm::mat4(1.0f);
         ModelMatrix = glm::translate(ModelMatrix, CannonPos);
@@ -860,17 +1512,27 @@ int main() {
         ModelMatrix = glm::rotate(ModelMatrix, YawRadians, glm::vec3(0.0f, 1.0f, 0.0f));
         ModelMatrix = glm::translate(ModelMatrix, CannonCenterDelta);
         ModelMatrix = glm::scale(ModelMatrix, glm::vec3(CannonScale));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, RustyMetalTexture);
-        CurrentShader->SetModel(ModelMatrix);
-        Cannon.Render();
-
-        SetupPhongLight(*CurrentShader);
+        AddShadowCaster(Cannon, ModelMatrix);
+        if (IsVisible(Cannon, ModelMatrix) && PassesOcclusion(CannonOcclusionSlot, Cannon, ModelMatrix)) {
+            Cannon.Submit(FrameQueue, CurrentShader, CannonLightState, ModelMatrix, RustyMetalTexture, 0, Occlusion.GetConditionQuery(CannonOcclusionSlot));
+        }
 
         #pragma endregion
 
         #pragma region movement
 
+        Wind.SetTime(glfwGetTime());
+
+        glm::vec3 SimFocusPoints[] = { FPSCamera.GetPosition(), balloonPosWithAmplitude };
+        updateSimulationTiers(SphereList, SimFocusPoints, 2, SimLOD);
+
+        glm::mat4* BallTransformsBegin = BallInstances.Map(SphereList.size());
+        glm::mat4* BallTransform = BallTransformsBegin;
+        // NOTE: Balls just outside the view still shadow ground inside it, so like the other
+        // dynamic casters they skip the camera frustum test and get their own instance range
+        glm::mat4* BallShadowTransformsBegin = BallShadowInstances.Map(Quality.Shadows ? SphereList.size() : 0);
+        glm::mat4* BallShadowTransform = BallShadowTransformsBegin;
+
         if (MovementDebug) {
 
             bool freezed = IsFreezed();
@@ -895,14 +1557,18 @@ int main() {
                 ModelMatrix = ModelMatrix * rotationMatrix;
                 ModelMatrix = glm::scale(ModelMatrix, glm::vec3(scaling, scaling, scaling));
 
-                CurrentShader->SetModel(ModelMatrix);
-                Beachball.Render();
+                if (BallTransformsBegin && IsVisible(Beachball, ModelMatrix)) *BallTransform++ = ModelMatrix;
+                if (BallShadowTransformsBegin) {
+                    *BallShadowTransform++ = ModelMatrix;
+                    ShadowCasters.push_back(glm::vec4(sphere->Position, sphere->Radius));
+                }
 
-                if(!freezed)updateSphere(sphere, MovementStep);
+                if(!freezed)stepSphere(sphere, MovementStep, SimLOD, &Wind);
                 if (!freezed)checkBalloonHit(sphere,1.0f,balloonPosWithAmplitude );
             }
 
             if (!freezed)checkConstraints(SphereList,PlaneList,CylinderList);
+            if (!freezed)checkConvexConstraints(SphereList, BoxList, CapsuleList, HullList);
 
         }
         else {
@@ -927,14 +1593,24 @@ int main() {
                 ModelMatrix = ModelMatrix * rotationMatrix; 
                 ModelMatrix = glm::scale(ModelMatrix, glm::vec3(scaling, scaling, scaling));
 
-                CurrentShader->SetModel(ModelMatrix);
-                Beachball.Render();
-                updateSphere(sphere, State.mDT);
+                if (BallTransformsBegin && IsVisible(Beachball, ModelMatrix)) *BallTransform++ = ModelMatrix;
+                if (BallShadowTransformsBegin) {
+                    *BallShadowTransform++ = ModelMatrix;
+                    ShadowCasters.push_back(glm::vec4(sphere->Position, sphere->Radius));
+                }
+                stepSphere(sphere, State.mDT, SimLOD, &Wind);
                 checkBalloonHit(sphere, 1.0f, balloonPosWithAmplitude);
             }
 
             checkConstraints(SphereList, PlaneList, CylinderList);
+            checkConvexConstraints(SphereList, BoxList, CapsuleList, HullList);
         }
+
+        // NOTE: A failed map leaves the balls simulated but not drawn this frame
+        unsigned BallOffset = BallInstances.Unmap(BallTransform - BallTransformsBegin);
+        unsigned BallShadowOffset = BallShadowInstances.Unmap(BallShadowTransform - BallShadowTransformsBegin);
+        Beachball.SubmitInstanced(FrameQueue, CurrentShader, SceneLightState, BallInstances.GetId(), BallOffset, BallInstances.GetCount());
+        Beachball.SubmitInstanced(ShadowQueue, ShadowCasterShader, RENDER_STATE_NONE, BallShadowInstances.GetId(), BallShadowOffset, BallShadowInstances.GetCount());
      
 
         #pragma endregion
@@ -942,55 +1618,75 @@ int main() {
         #pragma region static_elements_draw
 
 
-        AddPalms(ModelMatrix, CurrentShader, Palm);
-
-        PhongShaderMaterialTexture.SetUniform3f("uSpotlight.Ks", glm::vec3(0.0f, 0.0f, 0.0f));  // Specular component
-        PhongShaderMaterialTexture.SetUniform3f("uDirLight.Ks", glm::vec3(0.1f, 0.1f, 0.1f));  // Specular color
-        PhongShaderMaterialTexture.SetUniform3f("uPointLight.Ks", glm::vec3(0.1f, 0.1f, 0.1f));  // Specular color
-
-        SetupPhongFloorLight(*CurrentShader);
-
+        SubmitPalms(&ImpostorShader, FPSCamera.GetPosition());
+        SubmitStaticBatches(CurrentShader);
+        SubmitCrates(CubeVAO, CurrentShader, CrateDiffuseTexture, CubeSpecularTexture);
+        SubmitRocks(RockVAO, CurrentShader, FloorTexture1, RockSpecularTexture);
+        Terrain.Submit(FrameQueue, CurrentTerrainShader, FloorLightState, FPSCamera.GetPosition(), ViewFrustum, FloorTexture1, FloorTexture2);
+
+        Particles.Update(State.mDT, glfwGetTime(), FloorTopHeight);
+        TrackBallTrails();
+        if (Quality.Shadows) RenderDynamicShadows();
+
+        // NOTE: Everything up to here only queued draws, the scene target is bound once the shadow maps are done
+        SceneResolution.Begin(WindowWidth, WindowHeight);
+        if (Quality.ClusteredLights) BuildSceneLights(View, Projection);
+        Shader* LitShaders[] = { CurrentShader, CurrentTerrainShader };
+        for (Shader* LitShader : LitShaders) {
+            GLState.UseProgram(LitShader->GetId());
+            if (Quality.ClusteredLights) SceneLights.Apply(*LitShader, SceneResolution.GetSceneSize());
+            if (Quality.Shadows) SunShadows.Apply(*LitShader);
+        }
 
-        DrawFloor(CubeVAO, *CurrentShader, FloorTexture1);
-
-        glUseProgram(Color2dShader.GetId());
-        glBindVertexArray(VAO_signature);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, SignatureTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindVertexArray(0);
+        FrameQueue.Flush();
+        Occlusion.IssueQueries(Projection, View);
 
         #pragma endregion
 
 
         #pragma region skybox
 
-        glUseProgram(0);
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        glUseProgram(SkyboxShader.GetId());
-        View = glm::mat4(glm::mat3(View)); // remove translation from the view matrix
-        SkyboxShader.SetView(View);
+        GLState.DepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+        GLState.UseProgram(SkyboxShader.GetId());
+        glm::mat4 SkyboxView = glm::mat4(glm::mat3(View)); // remove translation from the view matrix
+        SkyboxShader.SetView(SkyboxView);
         SkyboxShader.SetProjection(Projection);
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        GLState.BindVertexArray(skyboxVAO);
+        GLState.BindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
-        glUseProgram(0);
+        GLState.DepthFunc(GL_LESS);
 
         #pragma endregion
-        
+
+        // NOTE: Blended and without depth writes, so after the skybox
+        Particles.Render(Projection, View, SceneResolution.GetSceneSize().y);
+        BallTrails.Render(Projection, View, FPSCamera.GetPosition());
+
+        // NOTE: The signature is drawn after the upscale so it stays sharp at any scene resolution
+        SceneResolution.End();
+        GLState.UseProgram(Color2dShader.GetId());
+        GLState.BindVertexArray(VAO_signature);
+        GLState.BindTexture(0, GL_TEXTURE_2D, SignatureTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        // NOTE: Before the HUD, its timings would make every golden image differ
+        Capture.Capture(WindowWidth, WindowHeight);
+        DrawHud(State);
 
 
-        glBindVertexArray(0);
-        glUseProgram(0);
         glfwSwapBuffers(Window);
+        ReportFrameStats(Window);
+
+        if (QualityBench.IsRunning()) {
+            // NOTE: The CPU side of the frame or the GPU time of the scene, whichever is the bottleneck
+            float FrameTime = std::max((float)glfwGetTime() - StartTime, SceneResolution.GetSceneTime());
+            if (QualityBench.AddFrame(FrameTime, TargetFrameTime)) SetQualityTier(QualityBench.GetTier());
+            if (!QualityBench.IsRunning()) SceneResolution.SetLocked(false);
+        }
 
         if (MovementDebug) {
             EndTime = glfwGetTime();
             float WorkTime = EndTime - StartTime;
+            LastWorkTime = WorkTime;
             if (WorkTime < TargetFrameTime) {
                 int DeltaMS = (int)((TargetFrameTime - WorkTime) * 1000.0f);
                 std::this_thread::sleep_for(std::chrono::milliseconds(DeltaMS));
@@ -1002,6 +1698,7 @@ int main() {
 
         EndTime = glfwGetTime();
         float WorkTime = EndTime - StartTime;
+        LastWorkTime = WorkTime;
         if (WorkTime < TargetFrameTime) {
             int DeltaMS = (int)((TargetFrameTime - WorkTime) * 1000.0f);
             std::this_thread::sleep_for(std::chrono::milliseconds(DeltaMS));
@@ -1010,6 +1707,7 @@ int main() {
         State.mDT = EndTime - StartTime;
     }
 
+    Capture.Shutdown();
     glfwSetInputMode(Window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     glfwTerminate();
     return 0;
@@ -1,4 +1,5 @@
 #include "mesh.hpp"
+#include <algorithm>
 
 Mesh::Mesh(const aiMesh* mesh, const aiMaterial* material, const std::string &resPath) {
     processMesh(mesh, material, resPath);
@@ -6,27 +7,138 @@ Mesh::Mesh(const aiMesh* mesh, const aiMaterial* material, const std::string &re
 
 void
 Mesh::Render() const {
-    glBindVertexArray(mVAO);
+    GLState.BindVertexArray(mVAO);
 
     if (mDiffuseTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, mDiffuseTexture);
+        GLState.BindTexture(0, GL_TEXTURE_2D, mDiffuseTexture);
     }
 
     if (mSpecularTexture) {
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, mSpecularTexture);
+        GLState.BindTexture(1, GL_TEXTURE_2D, mSpecularTexture);
     }
 
+    // NOTE: VAO stays bound, the state cache skips rebinding it for the next draw of this mesh
     if (mIndexCount) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+        GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
         glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, (void*)0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         return;
     }
 
     glDrawArrays(GL_TRIANGLES, 0, mVertexCount);
-    glBindVertexArray(0);
+}
+
+void
+Mesh::RenderInstanced(unsigned instanceBuffer, unsigned offset, unsigned count) const {
+    GLState.BindVertexArray(mVAO);
+
+    if (mDiffuseTexture) {
+        GLState.BindTexture(0, GL_TEXTURE_2D, mDiffuseTexture);
+    }
+
+    if (mSpecularTexture) {
+        GLState.BindTexture(1, GL_TEXTURE_2D, mSpecularTexture);
+    }
+
+    bindInstanceAttributes(instanceBuffer, offset);
+
+    if (mIndexCount) {
+        GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+        glDrawElementsInstanced(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, (void*)0, count);
+    }
+    else {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, mVertexCount, count);
+    }
+}
+
+void
+Mesh::GenerateLods() {
+    if (!mIndexCount) return;
+
+    std::vector<unsigned> Lods[LOD_COUNT];
+    buildLodChain(mVertices, mIndices, Lods);
+
+    // NOTE: Levels sit one after another in the index buffer, a draw picks one by its first index
+    std::vector<unsigned> AllIndices;
+    for (unsigned Lod = 0; Lod < LOD_COUNT; ++Lod) {
+        mLodFirst[Lod] = AllIndices.size();
+        mLodCount[Lod] = Lods[Lod].size();
+        AllIndices.insert(AllIndices.end(), Lods[Lod].begin(), Lods[Lod].end());
+        if (Lod) mLodIndices[Lod - 1].swap(Lods[Lod]);
+    }
+
+    GLState.BindVertexArray(mVAO);
+    GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, AllIndices.size() * sizeof(unsigned), AllIndices.data(), GL_STATIC_DRAW);
+    GLState.BindVertexArray(0);
+}
+
+void
+Mesh::FillDrawCommand(DrawCommand& command, unsigned lod) const {
+    lod = std::min(lod, (unsigned)LOD_COUNT - 1);
+    command.VAO = mVAO;
+    command.EBO = mIndexCount ? mEBO : 0;
+    command.Count = mIndexCount ? mLodCount[lod] : mVertexCount;
+    command.FirstIndex = mIndexCount ? mLodFirst[lod] : 0;
+    if (mDiffuseTexture) command.DiffuseTexture = mDiffuseTexture;
+    if (mSpecularTexture) command.SpecularTexture = mSpecularTexture;
+}
+
+const std::vector<unsigned>&
+Mesh::GetLodIndices(unsigned lod) const {
+    lod = std::min(lod, (unsigned)LOD_COUNT - 1);
+    if (!lod || mLodIndices[lod - 1].empty()) return mIndices;
+    return mLodIndices[lod - 1];
+}
+
+unsigned
+Mesh::GetDiffuseTexture() const {
+    return mDiffuseTexture;
+}
+
+unsigned
+Mesh::GetSpecularTexture() const {
+    return mSpecularTexture;
+}
+
+const BoundingSphere&
+Mesh::GetBoundingSphere() const {
+    return mBoundingSphere;
+}
+
+const AABB&
+Mesh::GetAABB() const {
+    return mAABB;
+}
+
+float
+Mesh::GetMaxVertexDistance() const {
+    return mMaxVertexDistance;
+}
+
+void
+Mesh::computeBounds() {
+    mAABB.Min = glm::vec3(0.0f);
+    mAABB.Max = glm::vec3(0.0f);
+    mBoundingSphere.Center = glm::vec3(0.0f);
+    mBoundingSphere.Radius = 0.0f;
+    mMaxVertexDistance = 0.0f;
+    if (mVertices.empty()) return;
+
+    mAABB.Min = glm::vec3(mVertices[0], mVertices[1], mVertices[2]);
+    mAABB.Max = mAABB.Min;
+    for (unsigned Offset = 0; Offset < mVertices.size(); Offset += 8) {
+        glm::vec3 Position(mVertices[Offset], mVertices[Offset + 1], mVertices[Offset + 2]);
+        mAABB.Min = glm::min(mAABB.Min, Position);
+        mAABB.Max = glm::max(mAABB.Max, Position);
+        mMaxVertexDistance = std::max(mMaxVertexDistance, glm::length(Position));
+    }
+
+    // NOTE: Centered on the box rather than the optimal sphere, good enough for culling
+    mBoundingSphere.Center = 0.5f * (mAABB.Min + mAABB.Max);
+    for (unsigned Offset = 0; Offset < mVertices.size(); Offset += 8) {
+        glm::vec3 Position(mVertices[Offset], mVertices[Offset + 1], mVertices[Offset + 2]);
+        mBoundingSphere.Radius = std::max(mBoundingSphere.Radius, glm::length(Position - mBoundingSphere.Center));
+    }
 }
 
 unsigned
@@ -64,16 +176,22 @@ Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material, const std::str
         mIndices.push_back(Face.mIndices[2]);
     }
 
+    computeBounds();
+
     mVertexCount = mVertices.size() / 6;
     mIndexCount = mIndices.size();
+    for (unsigned Lod = 0; Lod < LOD_COUNT; ++Lod) {
+        mLodFirst[Lod] = 0;
+        mLodCount[Lod] = mIndexCount;
+    }
 
     mDiffuseTexture = loadMeshTexture(material, resPath, aiTextureType_DIFFUSE);
     mSpecularTexture = loadMeshTexture(material, resPath, aiTextureType_SPECULAR);
 
     glGenVertexArrays(1, &mVAO);
-    glBindVertexArray(mVAO);
+    GLState.BindVertexArray(mVAO);
     glGenBuffers(1, &mVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mVBO);
     glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(float), mVertices.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -81,13 +199,12 @@ Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material, const std::str
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
     
     if (mIndexCount) {
         glGenBuffers(1, &mEBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+        GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndexCount * sizeof(float), mIndices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
-    glBindVertexArray(0);
+    GLState.BindVertexArray(0);
 }
\ No newline at end of file
@@ -16,6 +16,11 @@
 #include <GL/glew.h>
 #include <iostream>
 #include "texture.hpp"
+#include "instancing.hpp"
+#include "state_cache.hpp"
+#include "culling.hpp"
+#include "render_queue.hpp"
+#include "lod.hpp"
 
 class Mesh {
 public:
@@ -38,7 +43,52 @@ public:
      */
     void Render() const;
 
+    /**
+     * @brief Renders count instances of the mesh in one draw call
+     *
+     * @param instanceBuffer - Buffer of per-instance model matrices
+     * @param offset - Byte offset of the first instance in the buffer
+     * @param count - Number of instances
+     *
+     */
+    void RenderInstanced(unsigned instanceBuffer, unsigned offset, unsigned count) const;
+
+    /**
+     * @brief Simplifies the mesh into LOD_COUNT levels and appends them to the
+     * index buffer, the vertex buffer is shared by all of them
+     *
+     */
+    void GenerateLods();
+
+    /**
+     * @brief Fills in geometry and textures of a queued draw. Textures the mesh
+     * doesn't have are left as the caller set them
+     *
+     * @param command - Draw to fill
+     * @param lod - Detail level, 0 is the full mesh
+     *
+     */
+    void FillDrawCommand(DrawCommand& command, unsigned lod = 0) const;
+
+    /**
+     * @returns Triangle indices of a detail level, the full mesh until GenerateLods ran
+     */
+    const std::vector<unsigned>& GetLodIndices(unsigned lod) const;
+
+    unsigned GetDiffuseTexture() const;
+    unsigned GetSpecularTexture() const;
+    const BoundingSphere& GetBoundingSphere() const;
+    const AABB& GetAABB() const;
+
+    /**
+     * @returns Distance of the vertex furthest from the mesh origin
+     */
+    float GetMaxVertexDistance() const;
+
 private:
+    BoundingSphere mBoundingSphere;
+    AABB mAABB;
+    float mMaxVertexDistance;
     unsigned mVAO;
     unsigned mVBO;
     unsigned mEBO;
@@ -46,6 +96,10 @@ private:
     unsigned mIndexCount;
     unsigned mDiffuseTexture;
     unsigned mSpecularTexture;
+    unsigned mLodFirst[LOD_COUNT];
+    unsigned mLodCount[LOD_COUNT];
+    std::vector<unsigned> mLodIndices[LOD_COUNT - 1];
     unsigned loadMeshTexture(const aiMaterial* material, const std::string& resPath, aiTextureType type);
+    void computeBounds();
     void processMesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath);
 };
@@ -3,6 +3,11 @@
 Model::Model(std::string filename) {
     mFilename = filename;
     mDirectory = filename.substr(0, filename.find_last_of('/'));
+    mBoundingSphere.Center = glm::vec3(0.0f);
+    mBoundingSphere.Radius = 0.0f;
+    mAABB.Min = glm::vec3(0.0f);
+    mAABB.Max = glm::vec3(0.0f);
+    mMaxVertexDistance = 0.0f;
 }
 
 bool
@@ -19,9 +24,18 @@ Model::Load() {
         aiMesh* CurrAIMesh = Scene->mMeshes[MeshIdx];
         Mesh CurrMesh(CurrAIMesh, Scene->mMaterials[CurrAIMesh->mMaterialIndex], mDirectory);
         mMeshes.push_back(CurrMesh);
-
+        mMeshes.back().GenerateLods();
+    }
+    computeBounds();
+    std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes, LOD triangles:";
+    for (unsigned Lod = 0; Lod < LOD_COUNT; ++Lod) {
+        unsigned Triangles = 0;
+        for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+            Triangles += mMeshes[MeshIdx].GetLodIndices(Lod).size() / 3;
+        }
+        std::cout << " " << Triangles;
     }
-    std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes" << std::endl;
+    std::cout << std::endl;
     return true;
 }
 
@@ -33,4 +47,94 @@ Model::Render() {
     }
 }
 
+void
+Model::RenderInstanced(const InstanceBuffer& instances) {
+    RenderInstanced(instances.GetId(), 0, instances.GetCount());
+}
+
+void
+Model::RenderInstanced(unsigned instanceBuffer, unsigned offset, unsigned count) {
+    if (!count) return;
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        mMeshes[MeshIdx].RenderInstanced(instanceBuffer, offset, count);
+    }
+}
+
+void
+Model::Submit(RenderQueue& queue, Shader* program, unsigned state, const glm::mat4& modelMatrix, unsigned fallbackTexture, unsigned lod,
+    unsigned occlusionQuery) {
+    float Distance = queue.ViewDistance(glm::vec3(modelMatrix[3].x, modelMatrix[3].y, modelMatrix[3].z));
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        DrawCommand Command = {};
+        Command.Program = program;
+        Command.State = state;
+        Command.DiffuseTexture = fallbackTexture;
+        Command.OcclusionQuery = occlusionQuery;
+        Command.ModelMatrix = modelMatrix;
+        mMeshes[MeshIdx].FillDrawCommand(Command, lod);
+        queue.Submit(RENDER_PASS_OPAQUE, Command, Distance);
+    }
+}
+
+unsigned
+Model::SelectLod(const LodSelector& selector, const glm::mat4& modelMatrix, unsigned currentLod) const {
+    BoundingSphere Sphere = transformBoundingSphere(mBoundingSphere, modelMatrix);
+    return selectLod(selector, glm::vec4(Sphere.Center, Sphere.Radius), currentLod);
+}
+
+void
+Model::SubmitInstanced(RenderQueue& queue, Shader* program, unsigned state, unsigned instanceBuffer, unsigned offset, unsigned count) {
+    if (!count) return;
+    // NOTE: Instances are spread over the whole scene, there is no single distance to sort by
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        DrawCommand Command = {};
+        Command.Program = program;
+        Command.State = state;
+        Command.InstanceBuffer = instanceBuffer;
+        Command.InstanceOffset = offset;
+        Command.InstanceCount = count;
+        mMeshes[MeshIdx].FillDrawCommand(Command);
+        queue.Submit(RENDER_PASS_OPAQUE, Command, 0.0f);
+    }
+}
+
+float
+Model::maxVertexDistance() {
+    return mMaxVertexDistance;
+}
+
+const BoundingSphere&
+Model::GetBoundingSphere() const {
+    return mBoundingSphere;
+}
+
+const AABB&
+Model::GetAABB() const {
+    return mAABB;
+}
+
+const std::vector<Mesh>&
+Model::GetMeshes() const {
+    return mMeshes;
+}
+
+void
+Model::computeBounds() {
+    if (mMeshes.empty()) return;
+
+    mAABB = mMeshes[0].GetAABB();
+    mMaxVertexDistance = 0.0f;
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        mAABB.Min = glm::min(mAABB.Min, mMeshes[MeshIdx].GetAABB().Min);
+        mAABB.Max = glm::max(mAABB.Max, mMeshes[MeshIdx].GetAABB().Max);
+        mMaxVertexDistance = std::max(mMaxVertexDistance, mMeshes[MeshIdx].GetMaxVertexDistance());
+    }
 
+    mBoundingSphere.Center = 0.5f * (mAABB.Min + mAABB.Max);
+    mBoundingSphere.Radius = 0.0f;
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        const BoundingSphere& MeshSphere = mMeshes[MeshIdx].GetBoundingSphere();
+        float Reach = glm::length(MeshSphere.Center - mBoundingSphere.Center) + MeshSphere.Radius;
+        mBoundingSphere.Radius = std::max(mBoundingSphere.Radius, Reach);
+    }
+}
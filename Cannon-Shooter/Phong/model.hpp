@@ -9,7 +9,8 @@
  *
  */
 
-#ifndef MESH_H
+#ifndef MODEL_HPP
+#define MODEL_HPP
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -21,6 +22,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "shader.hpp"
 #include "mesh.hpp"
+#include "instancing.hpp"
 
 #define POSITION_LOCATION 0
 #define NORMAL_LOCATION 1
@@ -41,6 +43,11 @@ enum EBufferType {
 class Model {
 private:
     std::vector<Mesh> mMeshes;
+    BoundingSphere mBoundingSphere;
+    AABB mAABB;
+    float mMaxVertexDistance;
+
+    void computeBounds();
 
 public:
     std::string mFilename;
@@ -67,9 +74,65 @@ public:
      */
     void Render();
 
+    /**
+     * @brief Renders every instance with one instanced draw call per mesh
+     *
+     * @param instances - Per-instance model matrices
+     *
+     */
+    void RenderInstanced(const InstanceBuffer& instances);
+
+    /**
+     * @brief Renders count instances starting at a byte offset into an instance buffer
+     *
+     */
+    void RenderInstanced(unsigned instanceBuffer, unsigned offset, unsigned count);
+
+    /**
+     * @brief Queues one draw per mesh instead of drawing right away
+     *
+     * @param queue - Frame render queue
+     * @param program - Shader to draw with
+     * @param state - Render queue state id, e.g. light setup
+     * @param modelMatrix - Model matrix
+     * @param fallbackTexture - Diffuse texture for meshes without one
+     * @param lod - Detail level, see SelectLod
+     * @param occlusionQuery - Query to draw conditionally on, 0 draws unconditionally
+     *
+     */
+    void Submit(RenderQueue& queue, Shader* program, unsigned state, const glm::mat4& modelMatrix, unsigned fallbackTexture = 0, unsigned lod = 0,
+        unsigned occlusionQuery = 0);
+
+    /**
+     * @brief Picks the detail level from the projected size of the bounding sphere
+     *
+     * @param selector - Frame LOD selector
+     * @param modelMatrix - Model matrix
+     * @param currentLod - Level this instance used last frame
+     *
+     * @returns Level to submit with
+     */
+    unsigned SelectLod(const LodSelector& selector, const glm::mat4& modelMatrix, unsigned currentLod) const;
+
+    /**
+     * @brief Queues one instanced draw per mesh
+     *
+     */
+    void SubmitInstanced(RenderQueue& queue, Shader* program, unsigned state, unsigned instanceBuffer, unsigned offset, unsigned count);
+
+    /**
+     * @returns Distance of the vertex furthest from the model origin
+     */
     float maxVertexDistance();
 
+    /**
+     * @brief Bounds of all meshes in model space, valid after Load
+     *
+     */
+    const BoundingSphere& GetBoundingSphere() const;
+    const AABB& GetAABB() const;
+    const std::vector<Mesh>& GetMeshes() const;
+
 };
 
-#define MESH_HP
 #endif
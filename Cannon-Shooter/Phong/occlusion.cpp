@@ -0,0 +1,165 @@
+#include "occlusion.hpp"
+#include "state_cache.hpp"
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+// NOTE: How far past the box, in box sizes, the camera still counts as inside. Keeps
+// the near plane from clipping the proxy of an object the camera is right next to
+#define OCCLUSION_INSIDE_MARGIN 0.05f
+
+glm::mat4
+occlusionBoxTransform(const AABB& box, const glm::mat4& model) {
+    glm::mat4 Box = glm::translate(glm::mat4(1.0f), 0.5f * (box.Min + box.Max));
+    Box = glm::scale(Box, box.Max - box.Min);
+    return model * Box;
+}
+
+OcclusionCuller::OcclusionCuller() {
+    mShader = 0;
+    mCubeVAO = 0;
+    mCubeVBO = 0;
+    mFrame = 1;
+    mViewPosition = glm::vec3(0.0f);
+    mOccludedCount = 0;
+    mLastOccludedCount = 0;
+}
+
+void
+OcclusionCuller::Init(Shader* proxyShader) {
+    mShader = proxyShader;
+
+    float Corners[8][3] = {
+        { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f },
+        { -0.5f, -0.5f,  0.5f }, { 0.5f, -0.5f,  0.5f }, { 0.5f, 0.5f,  0.5f }, { -0.5f, 0.5f,  0.5f },
+    };
+    unsigned Faces[36] = {
+        0, 2, 1, 0, 3, 2,
+        4, 5, 6, 4, 6, 7,
+        0, 1, 5, 0, 5, 4,
+        3, 7, 6, 3, 6, 2,
+        0, 4, 7, 0, 7, 3,
+        1, 2, 6, 1, 6, 5,
+    };
+    std::vector<float> Vertices;
+    for (unsigned Idx = 0; Idx < 36; ++Idx) {
+        Vertices.insert(Vertices.end(), Corners[Faces[Idx]], Corners[Faces[Idx]] + 3);
+    }
+
+    glGenVertexArrays(1, &mCubeVAO);
+    GLState.BindVertexArray(mCubeVAO);
+    glGenBuffers(1, &mCubeVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mCubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+}
+
+unsigned
+OcclusionCuller::AddObject() {
+    unsigned Slot = mOccluded.size();
+    unsigned Queries[OCCLUSION_QUERY_BUFFERS];
+    glGenQueries(OCCLUSION_QUERY_BUFFERS, Queries);
+    mQueries.insert(mQueries.end(), Queries, Queries + OCCLUSION_QUERY_BUFFERS);
+    mIssuedFrames.insert(mIssuedFrames.end(), OCCLUSION_QUERY_BUFFERS, 0);
+    mOccluded.push_back(false);
+    mTestedFrames.push_back(0);
+    return Slot;
+}
+
+void
+OcclusionCuller::BeginFrame(const glm::vec3& viewPosition) {
+    mViewPosition = viewPosition;
+    mLastOccludedCount = mOccludedCount;
+    mOccludedCount = 0;
+    mProxies.clear();
+
+    unsigned LastFrame = mFrame;
+    mFrame++;
+    for (unsigned Slot = 0; Slot < mOccluded.size(); ++Slot) {
+        // NOTE: Not tested last frame means it was outside the frustum, nothing is known about it
+        if (mTestedFrames[Slot] != LastFrame) {
+            mOccluded[Slot] = false;
+            continue;
+        }
+
+        unsigned QueryIdx = Slot * OCCLUSION_QUERY_BUFFERS + LastFrame % OCCLUSION_QUERY_BUFFERS;
+        if (mIssuedFrames[QueryIdx] != LastFrame) {
+            mOccluded[Slot] = false;
+            continue;
+        }
+
+        // NOTE: A result the GPU doesn't have yet keeps the previous answer instead of stalling
+        GLuint Available = 0;
+        glGetQueryObjectuiv(mQueries[QueryIdx], GL_QUERY_RESULT_AVAILABLE, &Available);
+        if (!Available) continue;
+
+        GLuint AnySamples = 0;
+        glGetQueryObjectuiv(mQueries[QueryIdx], GL_QUERY_RESULT, &AnySamples);
+        mOccluded[Slot] = AnySamples == 0;
+    }
+}
+
+bool
+OcclusionCuller::Test(unsigned slot, const glm::mat4& boxTransform) {
+    if (slot == OCCLUSION_NONE) return true;
+    mTestedFrames[slot] = mFrame;
+
+    glm::vec4 Local = glm::inverse(boxTransform) * glm::vec4(mViewPosition, 1.0f);
+    float Inside = 0.5f + OCCLUSION_INSIDE_MARGIN;
+    if (std::fabs(Local.x) <= Inside && std::fabs(Local.y) <= Inside && std::fabs(Local.z) <= Inside) {
+        mOccluded[slot] = false;
+        return true;
+    }
+
+    Proxy CurrProxy = { slot, boxTransform };
+    mProxies.push_back(CurrProxy);
+    if (mOccluded[slot]) mOccludedCount++;
+    return !mOccluded[slot];
+}
+
+bool
+OcclusionCuller::IsOccluded(unsigned slot) const {
+    return slot != OCCLUSION_NONE && mOccluded[slot];
+}
+
+unsigned
+OcclusionCuller::GetConditionQuery(unsigned slot) const {
+    if (slot == OCCLUSION_NONE) return 0;
+    unsigned LastFrame = mFrame - 1;
+    unsigned QueryIdx = slot * OCCLUSION_QUERY_BUFFERS + LastFrame % OCCLUSION_QUERY_BUFFERS;
+    return mIssuedFrames[QueryIdx] == LastFrame ? mQueries[QueryIdx] : 0;
+}
+
+void
+OcclusionCuller::IssueQueries(const glm::mat4& projection, const glm::mat4& view) {
+    if (mProxies.empty() || !mShader) return;
+
+    GLState.UseProgram(mShader->GetId());
+    mShader->SetProjection(projection);
+    mShader->SetView(view);
+    GLState.BindVertexArray(mCubeVAO);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+
+    for (unsigned ProxyIdx = 0; ProxyIdx < mProxies.size(); ++ProxyIdx) {
+        const Proxy& CurrProxy = mProxies[ProxyIdx];
+        unsigned QueryIdx = CurrProxy.Slot * OCCLUSION_QUERY_BUFFERS + mFrame % OCCLUSION_QUERY_BUFFERS;
+        mShader->SetModel(CurrProxy.Transform);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, mQueries[QueryIdx]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        mIssuedFrames[QueryIdx] = mFrame;
+    }
+
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+unsigned
+OcclusionCuller::GetOccludedCount() const {
+    return mLastOccludedCount;
+}
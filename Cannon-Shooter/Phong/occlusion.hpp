@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "culling.hpp"
+#include "shader.hpp"
+
+#define OCCLUSION_NONE 0xFFFFFFFF
+// NOTE: Queries alternate between two objects per slot, so last frame's query can
+// still be polled while this frame's is issued
+#define OCCLUSION_QUERY_BUFFERS 2
+
+/**
+ * @brief Box that bounds a model's AABB after a model matrix, mapping the unit
+ * cube centred on the origin
+ *
+ */
+glm::mat4 occlusionBoxTransform(const AABB& box, const glm::mat4& model);
+
+/**
+ * @brief Occlusion culling with GL_ANY_SAMPLES_PASSED queries on bounding box
+ * proxies. Results are read a frame late and only if the GPU already has them,
+ * the CPU never waits. An object hidden last frame is skipped, anything without
+ * a result yet is drawn
+ */
+class OcclusionCuller {
+public:
+    OcclusionCuller();
+
+    /**
+     * @brief Creates the proxy cube
+     *
+     * @param proxyShader - shaders/occlusion_proxy program
+     *
+     */
+    void Init(Shader* proxyShader);
+
+    /**
+     * @returns Slot for an object, objects keep their slot for the whole run
+     */
+    unsigned AddObject();
+
+    /**
+     * @brief Collects last frame's results that are ready and starts a new frame
+     *
+     * @param viewPosition - Camera position, objects whose box holds the camera are always visible
+     *
+     */
+    void BeginFrame(const glm::vec3& viewPosition);
+
+    /**
+     * @brief Queues the proxy query of an object in the view frustum for this frame
+     *
+     * @param slot - Object slot
+     * @param boxTransform - Maps the unit cube onto the object's bounds, see occlusionBoxTransform
+     *
+     * @returns false - Object was hidden last frame and should be skipped
+     */
+    bool Test(unsigned slot, const glm::mat4& boxTransform);
+
+    /**
+     * @returns true - Last frame's query of the slot found no visible samples
+     */
+    bool IsOccluded(unsigned slot) const;
+
+    /**
+     * @returns Last frame's query of the slot to make the draw conditional on, 0 if there is none
+     */
+    unsigned GetConditionQuery(unsigned slot) const;
+
+    /**
+     * @brief Draws the queued proxies against the finished opaque depth buffer.
+     * Colour and depth writes are off while they draw
+     *
+     */
+    void IssueQueries(const glm::mat4& projection, const glm::mat4& view);
+
+    /**
+     * @returns Objects skipped as occluded during the last frame
+     */
+    unsigned GetOccludedCount() const;
+
+private:
+    struct Proxy {
+        unsigned Slot;
+        glm::mat4 Transform;
+    };
+
+    Shader* mShader;
+    unsigned mCubeVAO;
+    unsigned mCubeVBO;
+    unsigned mFrame;
+    glm::vec3 mViewPosition;
+    std::vector<unsigned> mQueries;
+    // NOTE: Frame each query was issued in, 0 for never
+    std::vector<unsigned> mIssuedFrames;
+    std::vector<bool> mOccluded;
+    std::vector<unsigned> mTestedFrames;
+    std::vector<Proxy> mProxies;
+    unsigned mOccludedCount;
+    unsigned mLastOccludedCount;
+};
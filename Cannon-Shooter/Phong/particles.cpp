@@ -0,0 +1,112 @@
+#include "particles.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+#include <vector>
+
+ParticleSystem::ParticleSystem() {
+    mUpdateShader = 0;
+    mRenderShader = 0;
+    mBuffers[0] = mBuffers[1] = 0;
+    mVAOs[0] = mVAOs[1] = 0;
+    mSource = 0;
+    mCursor = 0;
+    mEmitterCount = 0;
+    mEmitterCountLocation = -1;
+    mEmitterPositionLocation = -1;
+    mEmitterDirectionLocation = -1;
+    mEmitterSlotsLocation = -1;
+}
+
+void
+ParticleSystem::Init(Shader* updateShader, Shader* renderShader) {
+    mUpdateShader = updateShader;
+    mRenderShader = renderShader;
+    mEmitterCountLocation = glGetUniformLocation(mUpdateShader->GetId(), "uEmitterCount");
+    mEmitterPositionLocation = glGetUniformLocation(mUpdateShader->GetId(), "uEmitterPositionKind");
+    mEmitterDirectionLocation = glGetUniformLocation(mUpdateShader->GetId(), "uEmitterDirectionSpeed");
+    mEmitterSlotsLocation = glGetUniformLocation(mUpdateShader->GetId(), "uEmitterSlots");
+
+    // NOTE: Zeroed slots are free, kind 0
+    std::vector<float> Empty(PARTICLE_CAPACITY * PARTICLE_FLOATS, 0.0f);
+    glGenBuffers(2, mBuffers);
+    glGenVertexArrays(2, mVAOs);
+    for (unsigned Idx = 0; Idx < 2; ++Idx) {
+        GLState.BindVertexArray(mVAOs[Idx]);
+        GLState.BindBuffer(GL_ARRAY_BUFFER, mBuffers[Idx]);
+        glBufferData(GL_ARRAY_BUFFER, Empty.size() * sizeof(float), Empty.data(), GL_DYNAMIC_COPY);
+        GLsizei Stride = PARTICLE_FLOATS * sizeof(float);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, Stride, (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, Stride, (void*)(4 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, Stride, (void*)(8 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+    }
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+}
+
+void
+ParticleSystem::Emit(ParticleKind kind, const glm::vec3& position, const glm::vec3& direction, float speed, unsigned count) {
+    count = std::min(count, (unsigned)PARTICLE_CAPACITY);
+    // NOTE: A burst running past the end of the pool is split in two emitters
+    while (count && mEmitterCount < PARTICLE_MAX_EMITTERS) {
+        unsigned Count = std::min(count, PARTICLE_CAPACITY - mCursor);
+        mEmitterPositionKind[mEmitterCount] = glm::vec4(position, (float)kind);
+        mEmitterDirectionSpeed[mEmitterCount] = glm::vec4(direction, speed);
+        mEmitterSlots[mEmitterCount * 2] = mCursor;
+        mEmitterSlots[mEmitterCount * 2 + 1] = Count;
+        mEmitterCount++;
+        mCursor = (mCursor + Count) % PARTICLE_CAPACITY;
+        count -= Count;
+    }
+}
+
+void
+ParticleSystem::Update(float dt, float time, float groundHeight) {
+    if (!mUpdateShader) return;
+
+    GLState.UseProgram(mUpdateShader->GetId());
+    glUniform1i(mEmitterCountLocation, mEmitterCount);
+    if (mEmitterCount) {
+        glUniform4fv(mEmitterPositionLocation, mEmitterCount, &mEmitterPositionKind[0].x);
+        glUniform4fv(mEmitterDirectionLocation, mEmitterCount, &mEmitterDirectionSpeed[0].x);
+        glUniform2iv(mEmitterSlotsLocation, mEmitterCount, mEmitterSlots);
+    }
+    // NOTE: A long hitch would fling everything, the step is capped
+    mUpdateShader->SetUniform1f("uDT", std::min(dt, 0.1f));
+    mUpdateShader->SetUniform1f("uTime", time);
+    mUpdateShader->SetUniform1f("uGroundHeight", groundHeight);
+    mEmitterCount = 0;
+
+    unsigned Target = 1 - mSource;
+    GLState.BindVertexArray(mVAOs[mSource]);
+    GLState.BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, mBuffers[Target]);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, PARTICLE_CAPACITY);
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+    GLState.BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    mSource = Target;
+}
+
+void
+ParticleSystem::Render(const glm::mat4& projection, const glm::mat4& view, float viewportHeight) {
+    if (!mRenderShader) return;
+
+    GLState.UseProgram(mRenderShader->GetId());
+    mRenderShader->SetProjection(projection);
+    mRenderShader->SetView(view);
+    mRenderShader->SetUniform1f("uPointScale", 0.5f * viewportHeight * projection[1][1]);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    GLState.BindVertexArray(mVAOs[mSource]);
+    glDrawArrays(GL_POINTS, 0, PARTICLE_CAPACITY);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+#define PARTICLE_CAPACITY 16384
+// NOTE: Position and kind, velocity and age, lifetime
+#define PARTICLE_FLOATS 9
+// NOTE: Must match MAX_EMITTERS in particle_update.vert, bursts past it in one frame are dropped
+#define PARTICLE_MAX_EMITTERS 8
+
+enum ParticleKind {
+    PARTICLE_FREE = 0,
+    PARTICLE_POP = 1,
+    PARTICLE_SMOKE = 2,
+};
+
+/**
+ * @brief GPU particles simulated with transform feedback. Two buffers hold
+ * PARTICLE_CAPACITY slots each, every frame a vertex shader reads one and
+ * writes the next, then they swap. Bursts only send a few uniforms naming
+ * the slots to respawn, the CPU never touches particle data, so the cost per
+ * frame doesn't depend on how many are alive. New bursts take slots round
+ * robin and overwrite the oldest particles when the pool is full
+ */
+class ParticleSystem {
+public:
+    ParticleSystem();
+
+    /**
+     * @brief Creates the ping-pong buffers with every slot free
+     *
+     * @param updateShader - shaders/particle_update program, built with transform feedback varyings
+     * @param renderShader - shaders/particle program
+     *
+     */
+    void Init(Shader* updateShader, Shader* renderShader);
+
+    /**
+     * @brief Queues a burst spawned by the next Update
+     *
+     * @param kind - PARTICLE_POP or PARTICLE_SMOKE
+     * @param position - World position of the burst
+     * @param direction - Main direction the particles leave in
+     * @param speed - Initial speed
+     * @param count - Number of particles
+     *
+     */
+    void Emit(ParticleKind kind, const glm::vec3& position, const glm::vec3& direction, float speed, unsigned count);
+
+    /**
+     * @brief Spawns the queued bursts and advances every particle on the GPU
+     *
+     * @param dt - Frame time in seconds
+     * @param time - Seconds since start, seeds the random spawn values
+     * @param groundHeight - Particles settle at this height
+     *
+     */
+    void Update(float dt, float time, float groundHeight);
+
+    /**
+     * @brief Draws the particles as blended point sprites. Depth is tested but
+     * not written, draw after the opaque scene and the skybox
+     *
+     * @param viewportHeight - Height in pixels of the target, scales the points
+     *
+     */
+    void Render(const glm::mat4& projection, const glm::mat4& view, float viewportHeight);
+
+private:
+    Shader* mUpdateShader;
+    Shader* mRenderShader;
+    unsigned mBuffers[2];
+    unsigned mVAOs[2];
+    // NOTE: Buffer holding the current state, the other one is written by the next Update
+    unsigned mSource;
+    unsigned mCursor;
+    unsigned mEmitterCount;
+    glm::vec4 mEmitterPositionKind[PARTICLE_MAX_EMITTERS];
+    glm::vec4 mEmitterDirectionSpeed[PARTICLE_MAX_EMITTERS];
+    int mEmitterSlots[PARTICLE_MAX_EMITTERS * 2];
+    int mEmitterCountLocation;
+    int mEmitterPositionLocation;
+    int mEmitterDirectionLocation;
+    int mEmitterSlotsLocation;
+};
@@ -1,8 +1,10 @@
 #include <glm/ext/vector_float3.hpp>
 #include <glm/geometric.hpp>
 #include "physics.hpp"
+#include "collision.hpp"
 #include <functional>
 #include <iostream>
+#include <cmath>
 
 
 void rk4Step(glm::vec3& position, glm::vec3& velocity,
@@ -37,6 +39,8 @@ void rk4Step(glm::vec3& position, glm::vec3& velocity,
 }
 
 
+bool CollisionLogging = true;
+
 const double GRAVITY_ACC = 9.81;
 const double AIR_RESIS = 0.1;
 
@@ -66,14 +70,16 @@ void handleSphereCollision(Sphere* sphere1, Sphere* sphere2) {
     float penetrationDepth = sphere1->Radius + sphere2->Radius - glm::distance(sphere1->Position, sphere2->Position);
 
     if (impactSpeed > 0)return;
-    std::cout << "Collision detected! ==================" << std::endl;
-    std::cout << "Before Collision - Sphere 1: Position(" << sphere1->Position.x << ", " << sphere1->Position.y << ", " << sphere1->Position.z
-        << ") Velocity(" << sphere1->Velocity.x << ", " << sphere1->Velocity.y << ", " << sphere1->Velocity.z << ")" << std::endl;
-    std::cout << "Before Collision - Sphere 2: Position(" << sphere2->Position.x << ", " << sphere2->Position.y << ", " << sphere2->Position.z
-        << ") Velocity(" << sphere2->Velocity.x << ", " << sphere2->Velocity.y << ", " << sphere2->Velocity.z << ")" << std::endl;
-    std::cout << "Penetration: "<< penetrationDepth << std::endl;
-    std::cout << "ImpactSpeed: "<< impactSpeed << std::endl;
-    std::cout << "ColisionNormal: " << collisionNormal.x << ", " << collisionNormal.y << ", " << collisionNormal.z << std::endl;
+    if (CollisionLogging) {
+        std::cout << "Collision detected! ==================" << std::endl;
+        std::cout << "Before Collision - Sphere 1: Position(" << sphere1->Position.x << ", " << sphere1->Position.y << ", " << sphere1->Position.z
+            << ") Velocity(" << sphere1->Velocity.x << ", " << sphere1->Velocity.y << ", " << sphere1->Velocity.z << ")" << std::endl;
+        std::cout << "Before Collision - Sphere 2: Position(" << sphere2->Position.x << ", " << sphere2->Position.y << ", " << sphere2->Position.z
+            << ") Velocity(" << sphere2->Velocity.x << ", " << sphere2->Velocity.y << ", " << sphere2->Velocity.z << ")" << std::endl;
+        std::cout << "Penetration: "<< penetrationDepth << std::endl;
+        std::cout << "ImpactSpeed: "<< impactSpeed << std::endl;
+        std::cout << "ColisionNormal: " << collisionNormal.x << ", " << collisionNormal.y << ", " << collisionNormal.z << std::endl;
+    }
 
     float totalMass = sphere1->Mass + sphere2->Mass;
     glm::vec3 impulse = (1.0f + elasticity) * impactSpeed * collisionNormal / totalMass;
@@ -85,11 +91,13 @@ void handleSphereCollision(Sphere* sphere1, Sphere* sphere2) {
     sphere1->Position += separationVector;
     sphere2->Position -= separationVector;
 
-    std::cout << "After Collision - Sphere 1: Position(" << sphere1->Position.x << ", " << sphere1->Position.y << ", " << sphere1->Position.z
-        << ") Velocity(" << sphere1->Velocity.x << ", " << sphere1->Velocity.y << ", " << sphere1->Velocity.z << ")" << std::endl;
-    std::cout << "After Collision - Sphere 2: Position(" << sphere2->Position.x << ", " << sphere2->Position.y << ", " << sphere2->Position.z
-        << ") Velocity(" << sphere2->Velocity.x << ", " << sphere2->Velocity.y << ", " << sphere2->Velocity.z << ")" << std::endl;
-    std::cout << " ===================================" << std::endl << std::endl;
+    if (CollisionLogging) {
+        std::cout << "After Collision - Sphere 1: Position(" << sphere1->Position.x << ", " << sphere1->Position.y << ", " << sphere1->Position.z
+            << ") Velocity(" << sphere1->Velocity.x << ", " << sphere1->Velocity.y << ", " << sphere1->Velocity.z << ")" << std::endl;
+        std::cout << "After Collision - Sphere 2: Position(" << sphere2->Position.x << ", " << sphere2->Position.y << ", " << sphere2->Position.z
+            << ") Velocity(" << sphere2->Velocity.x << ", " << sphere2->Velocity.y << ", " << sphere2->Velocity.z << ")" << std::endl;
+        std::cout << " ===================================" << std::endl << std::endl;
+    }
 
 }
 
@@ -126,16 +134,18 @@ void handleSphereCollisionWithCylinder(Sphere* sphere, Cylinder* cylinder) {
         sphere->Position -= (distance - sphere->Radius) * -normal;
         sphere->Velocity = glm::reflect(sphere->Velocity, -normal) * elasticity;
 
-        std::cout << "Collision detected! ==================" << std::endl;
-        std::cout << "Cylinder: PointA(" << cylinder->PointA.x << ", " << cylinder->PointA.y << ", " << cylinder->PointA.z << ")";
-        std::cout << " PointB(" << cylinder->PointB.x << ", " << cylinder->PointB.y << ", " << cylinder->PointB.z << ")";
-        std::cout << " Radius: " << cylinder->Radius << std::endl;
-        std::cout << "Sphere: Position(" << sphere->Position.x << ", " << sphere->Position.y << ", " << sphere->Position.z << ")";
-        std::cout << " Radius: " << sphere->Radius << std::endl;
-        std::cout << "Closest Point on Line: (" << closestPointOnLine.x << ", " << closestPointOnLine.y << ", " << closestPointOnLine.z << ")" << std::endl;
-        std::cout << "Normal: (" << normal.x << ", " << normal.y << ", " << normal.z << ")" << std::endl;
-        std::cout << "Scalar projection: " << scalarProjection << std::endl;
-        std::cout << "Distance: " << distance << std::endl << std::endl;
+        if (CollisionLogging) {
+            std::cout << "Collision detected! ==================" << std::endl;
+            std::cout << "Cylinder: PointA(" << cylinder->PointA.x << ", " << cylinder->PointA.y << ", " << cylinder->PointA.z << ")";
+            std::cout << " PointB(" << cylinder->PointB.x << ", " << cylinder->PointB.y << ", " << cylinder->PointB.z << ")";
+            std::cout << " Radius: " << cylinder->Radius << std::endl;
+            std::cout << "Sphere: Position(" << sphere->Position.x << ", " << sphere->Position.y << ", " << sphere->Position.z << ")";
+            std::cout << " Radius: " << sphere->Radius << std::endl;
+            std::cout << "Closest Point on Line: (" << closestPointOnLine.x << ", " << closestPointOnLine.y << ", " << closestPointOnLine.z << ")" << std::endl;
+            std::cout << "Normal: (" << normal.x << ", " << normal.y << ", " << normal.z << ")" << std::endl;
+            std::cout << "Scalar projection: " << scalarProjection << std::endl;
+            std::cout << "Distance: " << distance << std::endl << std::endl;
+        }
     }
 
 
@@ -145,6 +155,7 @@ void checkConstraints(std::list<Sphere*>& sphereList, std::list<Plane*>& planeLi
 {
     for (auto outerSphereIt = sphereList.begin(); outerSphereIt != sphereList.end(); ++outerSphereIt) {
         Sphere* sphere = *outerSphereIt;
+        if (sphere->SimTier == SIM_TIER_FROZEN) continue;
 
         for (Plane* plane : planeList) {
             handleSphereCollisionWithPlane(sphere, plane->planeNormal, plane->planeConstant);
@@ -154,8 +165,12 @@ void checkConstraints(std::list<Sphere*>& sphereList, std::list<Plane*>& planeLi
             handleSphereCollisionWithCylinder(sphere,cylinder);
         }
 
+        // NOTE: Only full tier spheres take part in sphere - sphere contacts
+        if (sphere->SimTier != SIM_TIER_FULL) continue;
+
         for (auto innerSphereIt = outerSphereIt; innerSphereIt != sphereList.end(); ++innerSphereIt) {
             Sphere* otherSphere = *innerSphereIt;
+            if (otherSphere->SimTier != SIM_TIER_FULL) continue;
 
             if (sphere != otherSphere && areSpheresTouching(*sphere, *otherSphere)) {
                 handleSphereCollision(sphere, otherSphere);
@@ -167,31 +182,69 @@ void checkConstraints(std::list<Sphere*>& sphereList, std::list<Plane*>& planeLi
 }
 
 
+template<class Collider>
+static void resolveSphereContacts(Sphere* sphere, std::list<Collider*>& colliderList) {
+    for (Collider* collider : colliderList) {
+        Contact contact;
+        if (!collideShapes(*sphere, *collider, contact)) continue;
 
+        sphere->Position += contact.Normal * contact.Depth;
+        if (glm::dot(sphere->Velocity, contact.Normal) < 0.0f) {
+            sphere->Velocity = glm::reflect(sphere->Velocity, contact.Normal) * elasticity;
+        }
+    }
+}
 
+void checkConvexConstraints(std::list<Sphere*>& sphereList, std::list<Box*>& boxList, std::list<Capsule*>& capsuleList, std::list<ConvexHull*>& hullList)
+{
+    for (Sphere* sphere : sphereList) {
+        if (sphere->SimTier == SIM_TIER_FROZEN) continue;
+
+        resolveSphereContacts(sphere, boxList);
+        resolveSphereContacts(sphere, capsuleList);
+        resolveSphereContacts(sphere, hullList);
+    }
+}
+
+
+void buildRockHull(ConvexHull& hull, float baseHalfSize, float topHalfSize, float height, const glm::vec2& topOffset)
+{
+    hull.Points.resize(8);
+    for (int corner = 0; corner < 8; ++corner) {
+        bool top = (corner & 2) != 0;
+        float halfSize = top ? topHalfSize : baseHalfSize;
+        glm::vec2 shift = top ? topOffset : glm::vec2(0.0f);
+        float x = (corner & 1) ? halfSize : -halfSize;
+        float z = (corner & 4) ? halfSize : -halfSize;
+        hull.Points[corner] = glm::vec3(x + shift.x, top ? height : 0.0f, z + shift.y);
+    }
+}
 
-void updateSphere(Sphere* sphere,float dt) {
+
+void updateSphere(Sphere* sphere,float dt, const WindField* wind) {
 
     float mass = sphere->Mass;
     glm::vec3 addedForce = glm::vec3(0.0f, 0.0f, 0.0f);
+    // NOTE: Drag acts on velocity relative to the air, wind is sampled once per step
+    glm::vec3 windVelocity = wind ? wind->Sample(sphere->Position) : glm::vec3(0.0f, 0.0f, 0.0f);
 
     auto accelerationX = [=](const glm::vec3& position, const glm::vec3& velocity) {
         glm::vec3 fg = calculateGravityForce(mass);
-        glm::vec3 f_drag = calculateDragForce(velocity, dragConst);
+        glm::vec3 f_drag = calculateDragForce(velocity - windVelocity, dragConst);
         glm::vec3 f_rez = fg + addedForce + f_drag;
         return f_rez.x / float(mass);
         };
 
     auto accelerationY = [=](const glm::vec3& position, const glm::vec3& velocity) {
         glm::vec3 fg = calculateGravityForce(mass);
-        glm::vec3 f_drag = calculateDragForce(velocity, dragConst);
+        glm::vec3 f_drag = calculateDragForce(velocity - windVelocity, dragConst);
         glm::vec3 f_rez = fg + addedForce + f_drag;
         return f_rez.y / float(mass);
         };
 
     auto accelerationZ = [=](const glm::vec3& position, const glm::vec3& velocity) {
         glm::vec3 fg = calculateGravityForce(mass);
-        glm::vec3 f_drag = calculateDragForce(velocity, dragConst);
+        glm::vec3 f_drag = calculateDragForce(velocity - windVelocity, dragConst);
         glm::vec3 f_rez = fg + addedForce + f_drag;
         return f_rez.z / float(mass);
         };
@@ -201,3 +254,61 @@ void updateSphere(Sphere* sphere,float dt) {
 }
 
 
+static int pickSimulationTier(int currentTier, float distance, const SimulationLOD& lod) {
+    // NOTE: Thresholds are shifted away from the current tier so spheres
+    // hovering around a boundary don't flip tiers every frame
+    float reducedDistance = lod.ReducedDistance + (currentTier >= SIM_TIER_REDUCED ? -lod.Hysteresis : lod.Hysteresis);
+    float frozenDistance = lod.FrozenDistance + (currentTier >= SIM_TIER_FROZEN ? -lod.Hysteresis : lod.Hysteresis);
+
+    if (distance > frozenDistance) return SIM_TIER_FROZEN;
+    if (distance > reducedDistance) return SIM_TIER_REDUCED;
+    return SIM_TIER_FULL;
+}
+
+SimulationTierCounts updateSimulationTiers(std::list<Sphere*>& sphereList, const glm::vec3* focusPoints, unsigned focusCount, const SimulationLOD& lod) {
+    SimulationTierCounts counts = { 0, 0, 0 };
+
+    for (Sphere* sphere : sphereList) {
+        float minDistance2 = 0.0f;
+        bool first = true;
+        for (unsigned focusIdx = 0; focusIdx < focusCount; ++focusIdx) {
+            glm::vec3 delta = sphere->Position - focusPoints[focusIdx];
+            float distance2 = glm::dot(delta, delta);
+            if (first || distance2 < minDistance2) minDistance2 = distance2;
+            first = false;
+        }
+
+        int tier = !focusCount ? SIM_TIER_FULL : pickSimulationTier(sphere->SimTier, std::sqrt(minDistance2), lod);
+        if (tier != sphere->SimTier) {
+            sphere->SimTier = tier;
+            sphere->SimFrameCounter = 0;
+        }
+
+        if (tier == SIM_TIER_FULL) counts.Full++;
+        else if (tier == SIM_TIER_REDUCED) counts.Reduced++;
+        else counts.Frozen++;
+    }
+
+    return counts;
+}
+
+void stepSphere(Sphere* sphere, float dt, const SimulationLOD& lod, const WindField* wind) {
+    if (sphere->SimTier == SIM_TIER_FROZEN) {
+        sphere->SimPendingTime = 0.0f;
+        return;
+    }
+
+    if (sphere->SimTier == SIM_TIER_FULL) {
+        // NOTE: Time gathered while reduced is flushed on the way back in
+        updateSphere(sphere, dt + sphere->SimPendingTime, wind);
+        sphere->SimPendingTime = 0.0f;
+        return;
+    }
+
+    sphere->SimPendingTime += dt;
+    if (++sphere->SimFrameCounter < lod.ReducedRate) return;
+
+    updateSphere(sphere, sphere->SimPendingTime, wind);
+    sphere->SimPendingTime = 0.0f;
+    sphere->SimFrameCounter = 0;
+}
@@ -1,6 +1,9 @@
 #include <glm/ext/vector_float3.hpp>
+#include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <list>
+#include <vector>
+#include "wind.hpp"
 #ifndef PHYSICS_HPP
 #define PHYSICS_HPP
 
@@ -9,12 +12,59 @@ const double dragConst = 6.5;
 const float floorHeight = 0.1f;
 const float elasticity = 0.9f;
 
+// NOTE: Collision handlers print every contact, turn off for large scenes and benchmarks
+extern bool CollisionLogging;
+
+enum SimulationTier {
+    SIM_TIER_FULL = 0,
+    SIM_TIER_REDUCED = 1,
+    SIM_TIER_FROZEN = 2,
+};
+
 struct Sphere {
     float Mass;
     float Radius;
     glm::vec3 Position;
     glm::vec3 Velocity;
     glm::quat Orientation;
+    int SimTier = SIM_TIER_FULL;
+    int SimFrameCounter = 0;
+    float SimPendingTime = 0.0f;
+};
+
+// NOTE: Box, Capsule and ConvexHull are static colliders, Axes and Rotation columns are the local axes in world space
+struct Box {
+    glm::vec3 Center;
+    glm::vec3 HalfExtents;
+    glm::mat3 Axes;
+};
+
+struct Capsule {
+    float Radius;
+    glm::vec3 PointA;
+    glm::vec3 PointB;
+};
+
+struct ConvexHull {
+    std::vector<glm::vec3> Points;
+    glm::vec3 Position;
+    glm::mat3 Rotation;
+};
+
+struct SimulationLOD {
+    // NOTE: Distances are measured to the closest focus point (camera, targets)
+    float ReducedDistance;
+    float FrozenDistance;
+    // NOTE: A sphere has to move this far past a threshold before it changes tier again
+    float Hysteresis;
+    // NOTE: Reduced tier spheres are integrated once every ReducedRate frames
+    int ReducedRate;
+};
+
+struct SimulationTierCounts {
+    int Full;
+    int Reduced;
+    int Frozen;
 };
 
 struct Cylinder {
@@ -30,7 +80,25 @@ struct Plane {
 
 void checkConstraints(std::list<Sphere*>& sphereList, std::list<Plane*>& planeList, std::list<Cylinder*>& cylinderList);
 
-void updateSphere(Sphere* sphere, float dt);
+void checkConvexConstraints(std::list<Sphere*>& sphereList, std::list<Box*>& boxList, std::list<Capsule*>& capsuleList, std::list<ConvexHull*>& hullList);
+
+/**
+ * @brief Fills the hull with a rock: a square base narrowing towards a shifted top face.
+ * Points are local to the hull with the base at y = 0, stored in cube corner order
+ * where bit 0 picks +X, bit 1 the top face and bit 2 picks +Z
+ *
+ * @param baseHalfSize Half size of the base square
+ * @param topHalfSize Half size of the top square
+ * @param height Distance between base and top
+ * @param topOffset XZ shift of the top square
+ */
+void buildRockHull(ConvexHull& hull, float baseHalfSize, float topHalfSize, float height, const glm::vec2& topOffset);
+
+void updateSphere(Sphere* sphere, float dt, const WindField* wind = 0);
+
+SimulationTierCounts updateSimulationTiers(std::list<Sphere*>& sphereList, const glm::vec3* focusPoints, unsigned focusCount, const SimulationLOD& lod);
+
+void stepSphere(Sphere* sphere, float dt, const SimulationLOD& lod, const WindField* wind = 0);
 
 
 #endif 
@@ -0,0 +1,63 @@
+#include "quality.hpp"
+
+static const QualitySettings TierSettings[QUALITY_TIER_COUNT] = {
+    { "Low", 0.5f, 100.0f, 2, false, false },
+    { "Medium", 0.75f, 150.0f, 1, false, false },
+    { "High", 1.0f, 200.0f, 0, true, true },
+};
+
+const QualitySettings&
+qualitySettings(QualityTier tier) {
+    return TierSettings[tier];
+}
+
+QualityBenchmark::QualityBenchmark() {
+    mRunning = false;
+    mTier = QUALITY_HIGH;
+    mFrame = 0;
+    mTotalTime = 0.0f;
+}
+
+void
+QualityBenchmark::Start(QualityTier highest) {
+    mRunning = true;
+    mTier = highest;
+    mFrame = 0;
+    mTotalTime = 0.0f;
+}
+
+void
+QualityBenchmark::Cancel() {
+    mRunning = false;
+}
+
+bool
+QualityBenchmark::AddFrame(float frameTime, float budget) {
+    if (!mRunning) return false;
+
+    mFrame++;
+    if (mFrame <= QUALITY_BENCH_WARMUP_FRAMES) return false;
+    mTotalTime += frameTime;
+    if (mFrame < QUALITY_BENCH_WARMUP_FRAMES + QUALITY_BENCH_FRAMES) return false;
+
+    float AverageTime = mTotalTime / QUALITY_BENCH_FRAMES;
+    if (AverageTime <= budget * QUALITY_BENCH_HEADROOM || mTier == QUALITY_LOW) {
+        mRunning = false;
+        return false;
+    }
+
+    mTier = (QualityTier)(mTier - 1);
+    mFrame = 0;
+    mTotalTime = 0.0f;
+    return true;
+}
+
+bool
+QualityBenchmark::IsRunning() const {
+    return mRunning;
+}
+
+QualityTier
+QualityBenchmark::GetTier() const {
+    return mTier;
+}
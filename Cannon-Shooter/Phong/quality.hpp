@@ -0,0 +1,77 @@
+#pragma once
+
+// NOTE: Frames a tier runs before it's measured, lets shader compiles, cached
+// shadow maps and the smoothed GPU timer settle
+#define QUALITY_BENCH_WARMUP_FRAMES 30
+#define QUALITY_BENCH_FRAMES 60
+// NOTE: A tier is kept if its average frame time stays under this share of the budget
+#define QUALITY_BENCH_HEADROOM 0.85f
+
+enum QualityTier {
+    QUALITY_LOW,
+    QUALITY_MEDIUM,
+    QUALITY_HIGH,
+    QUALITY_TIER_COUNT
+};
+
+/**
+ * @brief What a tier changes. Lower tiers light per vertex, drop shadows and
+ * clustered lights, pick coarser LODs, draw less far and sample smaller mips
+ */
+struct QualitySettings {
+    const char* Name;
+    // NOTE: Scales the projected size LOD levels are picked by, below 1 switches to coarser levels sooner
+    float LodBias;
+    // NOTE: Far plane of the camera, the frustum culls everything past it
+    float DrawDistance;
+    // NOTE: Mip levels skipped at the top of every loaded texture
+    unsigned TextureBaseLevel;
+    bool Shadows;
+    bool ClusteredLights;
+};
+
+/**
+ * @returns Settings of a tier
+ */
+const QualitySettings& qualitySettings(QualityTier tier);
+
+/**
+ * @brief Startup benchmark. Runs the scene on each tier from the highest down
+ * and settles on the first one whose average frame time fits the budget,
+ * QUALITY_LOW if none do
+ */
+class QualityBenchmark {
+public:
+    QualityBenchmark();
+
+    /**
+     * @brief Starts measuring from the given tier
+     *
+     */
+    void Start(QualityTier highest);
+
+    /**
+     * @brief Stops without measuring the remaining tiers, the current one is kept
+     *
+     */
+    void Cancel();
+
+    /**
+     * @brief Accounts one frame of the current tier
+     *
+     * @param frameTime - Time the frame took, without the sleep to the target frame rate
+     * @param budget - Target frame time
+     *
+     * @returns true - The tier to render with changed, see GetTier
+     */
+    bool AddFrame(float frameTime, float budget);
+
+    bool IsRunning() const;
+    QualityTier GetTier() const;
+
+private:
+    bool mRunning;
+    QualityTier mTier;
+    unsigned mFrame;
+    float mTotalTime;
+};
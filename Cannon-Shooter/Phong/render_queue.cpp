@@ -0,0 +1,230 @@
+#include "render_queue.hpp"
+#include "instancing.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+
+static uint64_t
+keyField(uint64_t value, unsigned bits, unsigned shift) {
+    return (value & ((1ull << bits) - 1)) << shift;
+}
+
+RenderQueue::RenderQueue() {
+    mViewPosition = glm::vec3(0.0f);
+    mInvFarPlane = 1.0f;
+    mDepthPrepass = false;
+    mFrame = 0;
+    mShadedSamples = 0;
+    for (unsigned Idx = 0; Idx < RENDER_QUEUE_QUERY_BUFFERS; ++Idx) {
+        mSampleQueries[Idx] = 0;
+        mSampleQueryIssued[Idx] = false;
+    }
+}
+
+unsigned
+RenderQueue::AddState(std::function<void(Shader&)> apply) {
+    mStates.push_back(apply);
+    return mStates.size() - 1;
+}
+
+void
+RenderQueue::Begin(const glm::vec3& viewPosition, float farPlane) {
+    // NOTE: clear keeps capacity, after the first frames submitting does not allocate
+    mCommands.clear();
+    mKeys.clear();
+    mViewPosition = viewPosition;
+    mInvFarPlane = 1.0f / farPlane;
+}
+
+float
+RenderQueue::ViewDistance(const glm::vec3& position) const {
+    return glm::length(position - mViewPosition);
+}
+
+uint64_t
+RenderQueue::makeKey(RenderPass pass, const DrawCommand& command, float viewDistance) const {
+    float Depth = std::min(std::max(viewDistance * mInvFarPlane, 0.0f), 1.0f);
+    uint64_t DepthBits = (uint64_t)(Depth * ((1 << RENDER_KEY_DEPTH_BITS) - 1));
+    if (pass == RENDER_PASS_TRANSPARENT) DepthBits = ((1 << RENDER_KEY_DEPTH_BITS) - 1) - DepthBits;
+
+    unsigned Shift = 0;
+    uint64_t Key = keyField(DepthBits, RENDER_KEY_DEPTH_BITS, Shift);
+    Shift += RENDER_KEY_DEPTH_BITS;
+    Key |= keyField(command.VAO, RENDER_KEY_VAO_BITS, Shift);
+    Shift += RENDER_KEY_VAO_BITS;
+    Key |= keyField(command.DiffuseTexture, RENDER_KEY_TEXTURE_BITS, Shift);
+    Shift += RENDER_KEY_TEXTURE_BITS;
+    Key |= keyField(command.State, RENDER_KEY_STATE_BITS, Shift);
+    Shift += RENDER_KEY_STATE_BITS;
+    Key |= keyField(command.Program->GetId(), RENDER_KEY_SHADER_BITS, Shift);
+    Shift += RENDER_KEY_SHADER_BITS;
+    Key |= keyField(pass, RENDER_KEY_PASS_BITS, Shift);
+    return Key;
+}
+
+void
+RenderQueue::Submit(RenderPass pass, const DrawCommand& command, float viewDistance) {
+    mKeys.push_back(std::make_pair(makeKey(pass, command, viewDistance), (unsigned)mCommands.size()));
+    mCommands.push_back(command);
+}
+
+void
+RenderQueue::SetDepthProgram(Shader* program, Shader* depthProgram) {
+    for (unsigned Idx = 0; Idx < mDepthPrograms.size(); ++Idx) {
+        if (mDepthPrograms[Idx].first == program) {
+            mDepthPrograms[Idx].second = depthProgram;
+            return;
+        }
+    }
+    mDepthPrograms.push_back(std::make_pair(program, depthProgram));
+}
+
+void
+RenderQueue::SetDepthPrepass(bool enabled) {
+    mDepthPrepass = enabled;
+}
+
+bool
+RenderQueue::GetDepthPrepass() const {
+    return mDepthPrepass;
+}
+
+Shader*
+RenderQueue::depthProgram(const Shader* program) const {
+    for (unsigned Idx = 0; Idx < mDepthPrograms.size(); ++Idx) {
+        if (mDepthPrograms[Idx].first == program) return mDepthPrograms[Idx].second;
+    }
+    return 0;
+}
+
+void
+RenderQueue::issue(const DrawCommand& command, Shader* program, int& currentInstanced) const {
+    GLState.BindVertexArray(command.VAO);
+
+    int Instanced = command.InstanceCount ? 1 : 0;
+    if (Instanced != currentInstanced) {
+        currentInstanced = Instanced;
+        program->SetUniform1i("uInstanced", Instanced);
+    }
+
+    if (command.EBO) GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, command.EBO);
+
+    // NOTE: NO_WAIT draws anyway if the GPU doesn't have the result yet, never stalls
+    bool Conditional = command.OcclusionQuery && GLEW_VERSION_3_0;
+    if (Conditional) glBeginConditionalRender(command.OcclusionQuery, GL_QUERY_NO_WAIT);
+
+    if (Instanced) {
+        bindInstanceAttributes(command.InstanceBuffer, command.InstanceOffset);
+        if (command.EBO) glDrawElementsInstanced(GL_TRIANGLES, command.Count, GL_UNSIGNED_INT, (void*)(command.FirstIndex * sizeof(unsigned)), command.InstanceCount);
+        else glDrawArraysInstanced(GL_TRIANGLES, 0, command.Count, command.InstanceCount);
+    }
+    else if (command.DrawCount) {
+        program->SetModel(command.ModelMatrix);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, command.MultiCounts, GL_UNSIGNED_INT, command.MultiOffsets, command.DrawCount, command.MultiBaseVertices);
+    }
+    else {
+        program->SetModel(command.ModelMatrix);
+        if (command.EBO) glDrawElements(GL_TRIANGLES, command.Count, GL_UNSIGNED_INT, (void*)(command.FirstIndex * sizeof(unsigned)));
+        else glDrawArrays(GL_TRIANGLES, 0, command.Count);
+    }
+
+    if (Conditional) glEndConditionalRender();
+}
+
+void
+RenderQueue::collectSamples() {
+    if (!mSampleQueries[0]) glGenQueries(RENDER_QUEUE_QUERY_BUFFERS, mSampleQueries);
+
+    // NOTE: The query about to be reused is the oldest one, a count the GPU doesn't have yet is dropped
+    unsigned QueryIdx = mFrame % RENDER_QUEUE_QUERY_BUFFERS;
+    if (!mSampleQueryIssued[QueryIdx]) return;
+    mSampleQueryIssued[QueryIdx] = false;
+
+    GLuint Available = 0;
+    glGetQueryObjectuiv(mSampleQueries[QueryIdx], GL_QUERY_RESULT_AVAILABLE, &Available);
+    if (!Available) return;
+    glGetQueryObjectuiv(mSampleQueries[QueryIdx], GL_QUERY_RESULT, &mShadedSamples);
+}
+
+void
+RenderQueue::Flush() {
+    std::sort(mKeys.begin(), mKeys.end());
+    collectSamples();
+
+    // NOTE: Keys only order the draws, binds go through the state cache with the
+    // full ids, so a truncated id can cost an extra switch but never a wrong bind
+    Shader* CurrentProgram = 0;
+    unsigned CurrentState = ~0u;
+    int CurrentInstanced = -1;
+
+    if (mDepthPrepass) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (unsigned KeyIdx = 0; KeyIdx < mKeys.size(); ++KeyIdx) {
+            const DrawCommand& Command = mCommands[mKeys[KeyIdx].second];
+            if (mKeys[KeyIdx].first >> (64 - RENDER_KEY_PASS_BITS) != RENDER_PASS_OPAQUE) break;
+            Shader* DepthProgram = depthProgram(Command.Program);
+            if (!DepthProgram) continue;
+
+            if (DepthProgram != CurrentProgram) {
+                CurrentProgram = DepthProgram;
+                GLState.UseProgram(CurrentProgram->GetId());
+                CurrentInstanced = -1;
+            }
+            issue(Command, CurrentProgram, CurrentInstanced);
+        }
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        CurrentProgram = 0;
+        CurrentInstanced = -1;
+    }
+
+    unsigned QueryIdx = mFrame % RENDER_QUEUE_QUERY_BUFFERS;
+    glBeginQuery(GL_SAMPLES_PASSED, mSampleQueries[QueryIdx]);
+    mSampleQueryIssued[QueryIdx] = true;
+    bool Counting = true;
+    bool EqualDepth = false;
+
+    for (unsigned KeyIdx = 0; KeyIdx < mKeys.size(); ++KeyIdx) {
+        const DrawCommand& Command = mCommands[mKeys[KeyIdx].second];
+        bool Opaque = mKeys[KeyIdx].first >> (64 - RENDER_KEY_PASS_BITS) == RENDER_PASS_OPAQUE;
+        if (!Opaque && Counting) {
+            glEndQuery(GL_SAMPLES_PASSED);
+            Counting = false;
+        }
+
+        if (Command.Program != CurrentProgram) {
+            CurrentProgram = Command.Program;
+            GLState.UseProgram(CurrentProgram->GetId());
+            CurrentState = ~0u;
+            CurrentInstanced = -1;
+        }
+
+        // NOTE: Pre-passed draws only shade the fragments whose depth they laid down, depth is final
+        bool Equal = mDepthPrepass && Opaque && depthProgram(Command.Program);
+        if (Equal != EqualDepth) {
+            EqualDepth = Equal;
+            GLState.DepthFunc(Equal ? GL_EQUAL : GL_LESS);
+            glDepthMask(Equal ? GL_FALSE : GL_TRUE);
+        }
+
+        if (Command.State != CurrentState) {
+            CurrentState = Command.State;
+            if (CurrentState < mStates.size()) mStates[CurrentState](*CurrentProgram);
+        }
+
+        if (Command.DiffuseTexture) GLState.BindTexture(0, GL_TEXTURE_2D, Command.DiffuseTexture);
+        if (Command.SpecularTexture) GLState.BindTexture(1, GL_TEXTURE_2D, Command.SpecularTexture);
+        issue(Command, CurrentProgram, CurrentInstanced);
+    }
+
+    if (Counting) glEndQuery(GL_SAMPLES_PASSED);
+    if (EqualDepth) {
+        GLState.DepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+    if (CurrentProgram && CurrentInstanced == 1) CurrentProgram->SetUniform1i("uInstanced", 0);
+    mFrame++;
+}
+
+unsigned
+RenderQueue::GetShadedSamples() const {
+    return mShadedSamples;
+}
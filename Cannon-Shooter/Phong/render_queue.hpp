@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+// NOTE: Key layout from the most significant bit down, earlier fields win when sorting
+#define RENDER_KEY_PASS_BITS 2
+#define RENDER_KEY_SHADER_BITS 6
+#define RENDER_KEY_STATE_BITS 8
+#define RENDER_KEY_TEXTURE_BITS 16
+#define RENDER_KEY_VAO_BITS 16
+#define RENDER_KEY_DEPTH_BITS 16
+// NOTE: DrawCommand::State of draws that need no uniform setup, e.g. depth only passes
+#define RENDER_STATE_NONE 0xFFFFFFFF
+// NOTE: Overdraw queries alternate so last frame's count can be polled while this frame's is issued
+#define RENDER_QUEUE_QUERY_BUFFERS 2
+
+enum RenderPass {
+    RENDER_PASS_OPAQUE = 0,
+    RENDER_PASS_TRANSPARENT = 1,
+};
+
+/**
+ * @brief Everything needed to issue one draw without touching the object
+ * that submitted it. Count is the index count when EBO is set, vertex count otherwise,
+ * FirstIndex is where the indices start in the EBO.
+ * A non-zero DrawCount makes it a glMultiDrawElementsBaseVertex over the Multi* arrays,
+ * which have to stay alive until Flush. A non-zero OcclusionQuery draws it under
+ * conditional rendering, the GPU drops it if that query saw no samples
+ */
+struct DrawCommand {
+    Shader* Program;
+    unsigned State;
+    unsigned VAO;
+    unsigned EBO;
+    unsigned Count;
+    unsigned FirstIndex;
+    unsigned DiffuseTexture;
+    unsigned SpecularTexture;
+    unsigned InstanceBuffer;
+    unsigned InstanceOffset;
+    unsigned InstanceCount;
+    unsigned DrawCount;
+    GLsizei* MultiCounts;
+    void** MultiOffsets;
+    GLint* MultiBaseVertices;
+    unsigned OcclusionQuery;
+    glm::mat4 ModelMatrix;
+};
+
+/**
+ * @brief Collects the draws of a frame and issues them sorted by a 64-bit key
+ * (pass, shader, state, texture, VAO, depth), so program, light setup, texture
+ * and VAO switches happen once per group and opaque draws go front to back.
+ * With the depth pre-pass on, opaque draws of programs that have a depth
+ * program first lay down depth with it, then shade with GL_EQUAL so every
+ * pixel runs the expensive fragment shader once
+ */
+class RenderQueue {
+public:
+    RenderQueue();
+
+    /**
+     * @brief Registers uniform setup shared by a group of draws, e.g. a light rig
+     *
+     * @param apply - Sets the uniforms on the bound program
+     *
+     * @returns State id to put into DrawCommand::State
+     */
+    unsigned AddState(std::function<void(Shader&)> apply);
+
+    /**
+     * @brief Clears last frame's draws
+     *
+     * @param viewPosition - Camera position, depth is measured from it
+     * @param farPlane - Distance mapped to the largest depth value
+     *
+     */
+    void Begin(const glm::vec3& viewPosition, float farPlane);
+
+    /**
+     * @brief Queues a draw
+     *
+     * @param pass - Opaque draws sort front to back, transparent back to front
+     * @param command - Draw to issue
+     * @param viewDistance - Distance from the camera used for the depth bits
+     *
+     */
+    void Submit(RenderPass pass, const DrawCommand& command, float viewDistance);
+
+    /**
+     * @brief Gives a shading program a depth-only counterpart for the pre-pass.
+     * Both have to compute gl_Position the same way and be invariant, and the
+     * shading program must not discard
+     *
+     * @param program - Shading program
+     * @param depthProgram - Depth-only program with the same vertex inputs, uModel and uInstanced
+     *
+     */
+    void SetDepthProgram(Shader* program, Shader* depthProgram);
+
+    /**
+     * @brief Turns the depth pre-pass on or off from the next Flush
+     *
+     */
+    void SetDepthPrepass(bool enabled);
+
+    bool GetDepthPrepass() const;
+
+    /**
+     * @returns Distance of a world position from the camera given to Begin
+     */
+    float ViewDistance(const glm::vec3& position) const;
+
+    /**
+     * @brief Sorts and issues every queued draw. Program and VAO of the last
+     * draw stay bound, the state cache knows about them
+     *
+     */
+    void Flush();
+
+    /**
+     * @returns Fragments that passed the depth test in the opaque shading draws
+     * of an earlier frame, the last count the GPU had ready
+     */
+    unsigned GetShadedSamples() const;
+
+private:
+    std::vector<DrawCommand> mCommands;
+    std::vector<std::pair<uint64_t, unsigned> > mKeys;
+    std::vector<std::function<void(Shader&)> > mStates;
+    std::vector<std::pair<Shader*, Shader*> > mDepthPrograms;
+    glm::vec3 mViewPosition;
+    float mInvFarPlane;
+    bool mDepthPrepass;
+    unsigned mSampleQueries[RENDER_QUEUE_QUERY_BUFFERS];
+    bool mSampleQueryIssued[RENDER_QUEUE_QUERY_BUFFERS];
+    unsigned mFrame;
+    unsigned mShadedSamples;
+
+    uint64_t makeKey(RenderPass pass, const DrawCommand& command, float viewDistance) const;
+    Shader* depthProgram(const Shader* program) const;
+    void issue(const DrawCommand& command, Shader* program, int& currentInstanced) const;
+    void collectSamples();
+};
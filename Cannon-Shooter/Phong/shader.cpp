@@ -1,9 +1,24 @@
 #include "shader.hpp"
 
-Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath) {
-    unsigned vs = loadAndCompileShader(vShaderPath, GL_VERTEX_SHADER);
-    unsigned fs = loadAndCompileShader(fShaderPath, GL_FRAGMENT_SHADER);
+Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::string& defines) {
+    unsigned vs = loadAndCompileShader(vShaderPath, GL_VERTEX_SHADER, defines);
+    unsigned fs = loadAndCompileShader(fShaderPath, GL_FRAGMENT_SHADER, defines);
     mId = createBasicProgram(vs, fs);
+    lookupMatrixLocations();
+}
+
+Shader::Shader(const std::string& vShaderPath, const std::vector<std::string>& feedbackVaryings) {
+    unsigned vs = loadAndCompileShader(vShaderPath, GL_VERTEX_SHADER);
+    mId = createFeedbackProgram(vs, feedbackVaryings);
+    lookupMatrixLocations();
+}
+
+void
+Shader::lookupMatrixLocations() {
+    // NOTE: Matrices are set for every draw, look their locations up only once
+    mModelLocation = glGetUniformLocation(mId, "uModel");
+    mViewLocation = glGetUniformLocation(mId, "uView");
+    mProjectionLocation = glGetUniformLocation(mId, "uProjection");
 }
 
 unsigned
@@ -21,6 +36,11 @@ Shader::SetUniform1f(const std::string& uniform, float v) const {
     glUniform1f(glGetUniformLocation(mId, uniform.c_str()), v);
 }
 
+void
+Shader::SetUniform2f(const std::string& uniform, const glm::vec2& v) const {
+    glUniform2f(glGetUniformLocation(mId, uniform.c_str()), v.x, v.y);
+}
+
 void
 Shader::SetUniform3f(const std::string& uniform, const glm::vec3& v) const {
     glUniform3f(glGetUniformLocation(mId, uniform.c_str()), v.x, v.y, v.z);
@@ -33,20 +53,20 @@ Shader::SetUniform4m(const std::string& uniform, const glm::mat4& m) const {
 
 void
 Shader::SetModel(const glm::mat4& m) const {
-    SetUniform4m("uModel", m);
+    glUniformMatrix4fv(mModelLocation, 1, GL_FALSE, &m[0][0]);
 }
 
 void
 Shader::SetView(const glm::mat4& m) const {
-    SetUniform4m("uView", m);
+    glUniformMatrix4fv(mViewLocation, 1, GL_FALSE, &m[0][0]);
 }
 
 void Shader::SetProjection(const glm::mat4& m) const {
-    SetUniform4m("uProjection", m);
+    glUniformMatrix4fv(mProjectionLocation, 1, GL_FALSE, &m[0][0]);
 }
 
 unsigned
-Shader::loadAndCompileShader(std::string filename, GLuint shaderType) {
+Shader::loadAndCompileShader(std::string filename, GLuint shaderType, const std::string& defines) {
     unsigned ShaderID = 0;
     std::ifstream In(filename);
     std::string Str;
@@ -56,6 +76,11 @@ Shader::loadAndCompileShader(std::string filename, GLuint shaderType) {
     In.seekg(0, std::ios::beg);
 
     Str.assign((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+    // NOTE: #version has to stay the first line, defines go right after it
+    if (!defines.empty()) {
+        size_t VersionEnd = Str.find('\n');
+        Str.insert(VersionEnd == std::string::npos ? Str.size() : VersionEnd + 1, defines + "\n");
+    }
     const char* CharContent = Str.c_str();
 
     ShaderID = glCreateShader(shaderType);
@@ -100,4 +125,31 @@ Shader::createBasicProgram(unsigned vShader, unsigned fShader) {
     glDeleteShader(fShader);
 
     return ProgramID;
-}
\ No newline at end of file
+}
+unsigned
+Shader::createFeedbackProgram(unsigned vShader, const std::vector<std::string>& feedbackVaryings) {
+    unsigned ProgramID = glCreateProgram();
+    glAttachShader(ProgramID, vShader);
+
+    // NOTE: Varyings have to be declared before linking
+    std::vector<const char*> Varyings;
+    for (unsigned VaryingIdx = 0; VaryingIdx < feedbackVaryings.size(); ++VaryingIdx) {
+        Varyings.push_back(feedbackVaryings[VaryingIdx].c_str());
+    }
+    glTransformFeedbackVaryings(ProgramID, Varyings.size(), Varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(ProgramID);
+
+    int Success;
+    char InfoLog[512];
+    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Success);
+    if (!Success) {
+        glGetProgramInfoLog(ProgramID, 512, NULL, InfoLog);
+        std::cerr << "[Err] Failed to link transform feedback program:" << std::endl << InfoLog << std::endl;
+        return 0;
+    }
+
+    glDetachShader(ProgramID, vShader);
+    glDeleteShader(vShader);
+
+    return ProgramID;
+}
@@ -22,7 +22,22 @@ public:
     static const unsigned COLOR_LOCATION = 1;
     unsigned mId;
 
-    Shader(const std::string& vShaderPath, const std::string& fShaderPath);
+    /**
+     * @brief Compiles and links a vertex and fragment shader
+     *
+     * @param vShaderPath Vertex shader path
+     * @param fShaderPath Fragment shader path
+     * @param defines Inserted into both sources after the #version line, picks a shader variant
+     */
+    Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::string& defines = "");
+
+    /**
+     * @brief Vertex-only program whose outputs are captured with transform feedback
+     *
+     * @param vShaderPath Vertex shader path
+     * @param feedbackVaryings Captured outputs, interleaved into one buffer in this order
+     */
+    Shader(const std::string& vShaderPath, const std::vector<std::string>& feedbackVaryings);
     unsigned GetId() const;
 
     /**
@@ -41,6 +56,14 @@ public:
      */
     void SetUniform1f(const std::string& uniform, float v) const;
 
+    /**
+     * @brief Sets vec2 uniform value
+     *
+     * @param uniform Name of uniform
+     * @param v Value
+     */
+    void SetUniform2f(const std::string& uniform, const glm::vec2& v) const;
+
     /**
     * @brief Sets float uniform value
     *
@@ -78,16 +101,20 @@ public:
      */
     void SetProjection(const glm::mat4& m) const;
 private:
+    int mModelLocation;
+    int mViewLocation;
+    int mProjectionLocation;
 
     /**
      * @brief Loads shader from file and returns the compiled shader's ID
      *
      * @param filename File path to be loaded
      * @param shadertType Type of shader: vertex or fragment
+     * @param defines Inserted after the #version line
      * 
      * @returns Compiled shader's ID
      */
-    unsigned loadAndCompileShader(std::string filename, GLuint shaderType);
+    unsigned loadAndCompileShader(std::string filename, GLuint shaderType, const std::string& defines = "");
     /**
      * @brief Creates a shader program and returns the ID
      *
@@ -97,4 +124,14 @@ private:
      * @returns Shader program ID
      */
     unsigned createBasicProgram(unsigned vShader, unsigned fShader);
+    /**
+     * @brief Creates a vertex-only transform feedback program and returns the ID
+     *
+     * @param vShader Compiled vertex shader
+     * @param feedbackVaryings Captured outputs, interleaved
+     *
+     * @returns Shader program ID
+     */
+    unsigned createFeedbackProgram(unsigned vShader, const std::vector<std::string>& feedbackVaryings);
+    void lookupMatrixLocations();
 };
\ No newline at end of file
@@ -3,19 +3,28 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+// NOTE: Per-instance model matrix, takes locations 3 to 6
+layout (location = 3) in mat4 aInstanceModel;
 
 uniform mat4 uProjection;
 uniform mat4 uView;
 uniform mat4 uModel;
+uniform bool uInstanced;
 
 out vec2 UV;
 out vec3 vWorldSpaceFragment;
 out vec3 vWorldSpaceNormal;
+// NOTE: Distance along the view direction, picks the depth slice of the light clusters
+out float vViewDepth;
+// NOTE: The depth pre-pass (depth_prepass.vert) computes the same position, GL_EQUAL needs them identical
+invariant gl_Position;
 
 void main() {
-	vWorldSpaceFragment = vec3(uModel * vec4(aPos, 1.0f));
-	vWorldSpaceNormal = normalize(mat3(transpose(inverse(uModel))) * aNormal);
+	mat4 Model = uInstanced ? aInstanceModel : uModel;
+	vWorldSpaceFragment = vec3(Model * vec4(aPos, 1.0f));
+	vWorldSpaceNormal = normalize(mat3(transpose(inverse(Model))) * aNormal);
 
+	vViewDepth = -(uView * vec4(vWorldSpaceFragment, 1.0f)).z;
 	UV = aUV;
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+	gl_Position = uProjection * uView * Model * vec4(aPos, 1.0f);
 }
\ No newline at end of file
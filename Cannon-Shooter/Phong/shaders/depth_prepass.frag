@@ -0,0 +1,5 @@
+#version 330 core
+
+void main() {
+	// NOTE: Depth only, colour writes are masked off during the pre-pass
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+// NOTE: Per-instance model matrix, takes locations 3 to 6
+layout (location = 3) in mat4 aInstanceModel;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform mat4 uModel;
+uniform bool uInstanced;
+
+// NOTE: Must match basic.vert bit for bit, the shading pass tests depth with GL_EQUAL
+invariant gl_Position;
+
+void main() {
+	mat4 Model = uInstanced ? aInstanceModel : uModel;
+	gl_Position = uProjection * uView * Model * vec4(aPos, 1.0f);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+struct Material {
+	sampler2D Kd;
+	sampler2D Ks;
+	float Shininess;
+};
+
+uniform Material uMaterial;
+
+in vec2 UV;
+in vec3 vDiffuseLight;
+in vec3 vSpecularLight;
+
+out vec4 FragColor;
+
+void main() {
+	// NOTE: Lighting was done per vertex, only the material maps are sampled here
+	vec3 FinalColor = vDiffuseLight * vec3(texture(uMaterial.Kd, UV)) + vSpecularLight * vec3(texture(uMaterial.Ks, UV));
+	FragColor = vec4(FinalColor, 1.0f);
+}
@@ -0,0 +1,94 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aUV;
+// NOTE: Per-instance model matrix, takes locations 3 to 6
+layout (location = 3) in mat4 aInstanceModel;
+
+struct PositionalLight {
+	vec3 Position;
+	vec3 Ka;
+	vec3 Kd;
+	vec3 Ks;
+	float Kc;
+	float Kl;
+	float Kq;
+};
+
+struct DirectionalLight {
+	vec3 Position;
+	vec3 Direction;
+	vec3 Ka;
+	vec3 Kd;
+	vec3 Ks;
+	float InnerCutOff;
+	float OuterCutOff;
+	float Kc;
+	float Kl;
+	float Kq;
+};
+
+struct Material {
+	sampler2D Kd;
+	sampler2D Ks;
+	float Shininess;
+};
+
+uniform PositionalLight uPointLight;
+uniform DirectionalLight uSpotlight;
+uniform DirectionalLight uDirLight;
+uniform Material uMaterial;
+uniform vec3 uViewPos;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform mat4 uModel;
+uniform bool uInstanced;
+
+out vec2 UV;
+// NOTE: Light reaching the vertex, scaled by the diffuse and specular maps per fragment
+out vec3 vDiffuseLight;
+out vec3 vSpecularLight;
+// NOTE: The depth pre-pass (depth_prepass.vert) computes the same position, GL_EQUAL needs them identical
+invariant gl_Position;
+
+void main() {
+	mat4 Model = uInstanced ? aInstanceModel : uModel;
+	vec3 WorldSpaceVertex = vec3(Model * vec4(aPos, 1.0f));
+	vec3 WorldSpaceNormal = normalize(mat3(transpose(inverse(Model))) * aNormal);
+	vec3 ViewDirection = normalize(uViewPos - WorldSpaceVertex);
+
+	// NOTE(Jovan): Directional light
+	vec3 DirLightVector = normalize(-uDirLight.Direction);
+	float DirDiffuse = max(dot(WorldSpaceNormal, DirLightVector), 0.0f);
+	float DirSpecular = pow(max(dot(ViewDirection, reflect(-DirLightVector, WorldSpaceNormal)), 0.0f), uMaterial.Shininess);
+	vec3 DirDiffuseLight = uDirLight.Ka + uDirLight.Kd * DirDiffuse;
+	vec3 DirSpecularLight = uDirLight.Ks * DirSpecular;
+
+	// NOTE(Jovan): Point light
+	vec3 PtLightVector = normalize(uPointLight.Position - WorldSpaceVertex);
+	float PtDiffuse = max(dot(WorldSpaceNormal, PtLightVector), 0.0f);
+	float PtSpecular = pow(max(dot(ViewDirection, reflect(-PtLightVector, WorldSpaceNormal)), 0.0f), uMaterial.Shininess);
+	float PtLightDistance = length(uPointLight.Position - WorldSpaceVertex);
+	float PtAttenuation = 1.0f / (uPointLight.Kc + uPointLight.Kl * PtLightDistance + uPointLight.Kq * (PtLightDistance * PtLightDistance));
+	vec3 PtDiffuseLight = PtAttenuation * (uPointLight.Ka + uPointLight.Kd * PtDiffuse);
+	vec3 PtSpecularLight = PtAttenuation * uPointLight.Ks * PtSpecular;
+
+	// NOTE(Jovan): Spotlight
+	vec3 SpotlightVector = normalize(uSpotlight.Position - WorldSpaceVertex);
+	float SpotDiffuse = max(dot(WorldSpaceNormal, SpotlightVector), 0.0f);
+	float SpotSpecular = pow(max(dot(ViewDirection, reflect(-SpotlightVector, WorldSpaceNormal)), 0.0f), uMaterial.Shininess);
+	float SpotlightDistance = length(uSpotlight.Position - WorldSpaceVertex);
+	float SpotAttenuation = 1.0f / (uSpotlight.Kc + uSpotlight.Kl * SpotlightDistance + uSpotlight.Kq * (SpotlightDistance * SpotlightDistance));
+	float Theta = dot(SpotlightVector, normalize(-uSpotlight.Direction));
+	float Epsilon = uSpotlight.InnerCutOff - uSpotlight.OuterCutOff;
+	float SpotIntensity = clamp((Theta - uSpotlight.OuterCutOff) / Epsilon, 0.0f, 1.0f) * SpotAttenuation;
+	vec3 SpotDiffuseLight = SpotIntensity * (uSpotlight.Ka + uSpotlight.Kd * SpotDiffuse);
+	vec3 SpotSpecularLight = SpotIntensity * uSpotlight.Ks * SpotSpecular;
+
+	vDiffuseLight = DirDiffuseLight + PtDiffuseLight + SpotDiffuseLight;
+	vSpecularLight = DirSpecularLight + PtSpecularLight + SpotSpecularLight;
+	UV = aUV;
+	gl_Position = uProjection * uView * Model * vec4(aPos, 1.0f);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+uniform sampler2D uAtlas;
+
+in vec2 UV;
+out vec4 FragColor;
+
+void main() {
+	FragColor = vec4(1.0f, 1.0f, 1.0f, texture(uAtlas, UV).r);
+}
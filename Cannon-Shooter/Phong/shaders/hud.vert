@@ -0,0 +1,14 @@
+#version 330 core
+
+// NOTE: Pixels from the window's top left in xy, atlas UV in zw
+layout (location = 0) in vec4 aPositionUV;
+
+uniform vec2 uScreenSize;
+
+out vec2 UV;
+
+void main() {
+	vec2 Clip = aPositionUV.xy / uScreenSize * 2.0f - 1.0f;
+	UV = aPositionUV.zw;
+	gl_Position = vec4(Clip.x, -Clip.y, 0.0f, 1.0f);
+}
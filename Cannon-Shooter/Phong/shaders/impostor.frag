@@ -0,0 +1,32 @@
+#version 330 core
+
+struct DirectionalLight {
+	vec3 Position;
+	vec3 Direction;
+	vec3 Ka;
+	vec3 Kd;
+	vec3 Ks;
+	float InnerCutOff;
+	float OuterCutOff;
+	float Kc;
+	float Kl;
+	float Kq;
+};
+
+uniform DirectionalLight uDirLight;
+uniform sampler2D uAlbedo;
+uniform sampler2D uNormals;
+
+in vec2 UV;
+
+out vec4 FragColor;
+
+void main() {
+	vec4 Albedo = texture(uAlbedo, UV);
+	if (Albedo.a < 0.5f) discard;
+
+	// NOTE: Far away the point light and specular are negligible, only the sun is applied
+	vec3 Normal = normalize(texture(uNormals, UV).rgb * 2.0f - 1.0f);
+	float Diffuse = max(dot(Normal, normalize(-uDirLight.Direction)), 0.0f);
+	FragColor = vec4((uDirLight.Ka + uDirLight.Kd * Diffuse) * Albedo.rgb, 1.0f);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+
+// NOTE: x across the quad in [-0.5, 0.5], y from the ground up in [0, 1]
+layout (location = 0) in vec2 aCorner;
+// NOTE: Per-instance model matrix, takes locations 3 to 6
+layout (location = 3) in mat4 aInstanceModel;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform vec3 uViewPos;
+uniform vec3 uImpostorOrigin;
+uniform vec3 uImpostorSize;
+uniform int uViews;
+
+out vec2 UV;
+
+void main() {
+	vec3 Origin = vec3(aInstanceModel * vec4(uImpostorOrigin, 1.0f));
+	float Scale = length(vec3(aInstanceModel[0]));
+
+	// NOTE: Turns only around the vertical axis, the same way the bake camera circled the model
+	vec3 ToCamera = vec3(uViewPos.x - Origin.x, 0.0f, uViewPos.z - Origin.z);
+	vec3 Forward = length(ToCamera) > 0.0001f ? normalize(ToCamera) : vec3(1.0f, 0.0f, 0.0f);
+	vec3 Right = vec3(Forward.z, 0.0f, -Forward.x);
+
+	float Angle = atan(Forward.z, Forward.x);
+	int View = int(floor(Angle / 6.2831853f * uViews + 0.5f));
+	View = (View % uViews + uViews) % uViews;
+
+	UV = vec2((View + aCorner.x + 0.5f) / uViews, aCorner.y);
+	vec3 Position = Origin + (Right * aCorner.x * uImpostorSize.x + vec3(0.0f, aCorner.y * uImpostorSize.y, 0.0f)) * Scale;
+	gl_Position = uProjection * uView * vec4(Position, 1.0f);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+uniform sampler2D uDiffuse;
+
+in vec2 UV;
+in vec3 vNormal;
+
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 Normal;
+
+void main() {
+	vec4 Color = texture(uDiffuse, UV);
+	if (Color.a < 0.5f) discard;
+
+	vec3 FacingNormal = normalize(gl_FrontFacing ? vNormal : -vNormal);
+	Albedo = vec4(Color.rgb, 1.0f);
+	Normal = vec4(FacingNormal * 0.5f + 0.5f, 1.0f);
+}
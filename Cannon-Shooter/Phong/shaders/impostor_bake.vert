@@ -0,0 +1,19 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aUV;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform mat4 uModel;
+
+out vec2 UV;
+out vec3 vNormal;
+
+void main() {
+	// NOTE: Impostor instances are never rotated, model space normals are world space normals
+	vNormal = aNormal;
+	UV = aUV;
+	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+}
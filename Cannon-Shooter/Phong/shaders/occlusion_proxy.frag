@@ -0,0 +1,8 @@
+#version 330 core
+
+out vec4 FragColor;
+
+void main() {
+	// NOTE: Colour writes are masked off, only the query's sample count matters
+	FragColor = vec4(1.0f);
+}
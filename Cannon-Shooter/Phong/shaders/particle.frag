@@ -0,0 +1,11 @@
+#version 330 core
+
+in vec4 vColor;
+out vec4 FragColor;
+
+void main() {
+	// NOTE: Round sprite with a soft rim
+	float Distance = length(gl_PointCoord - vec2(0.5f));
+	if (Distance > 0.5f) discard;
+	FragColor = vec4(vColor.rgb, vColor.a * smoothstep(0.5f, 0.3f, Distance));
+}
@@ -0,0 +1,42 @@
+#version 330 core
+
+layout (location = 0) in vec4 aPositionKind;
+layout (location = 1) in vec4 aVelocityAge;
+layout (location = 2) in float aLife;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+// NOTE: Pixels per world unit at distance 1, size / w gives the point size
+uniform float uPointScale;
+
+out vec4 vColor;
+
+#define KIND_POP 1.0f
+
+vec3 ConfettiColor(uint id) {
+	vec3 Colors[4] = vec3[4](vec3(0.95f, 0.2f, 0.2f), vec3(1.0f, 0.85f, 0.2f), vec3(0.25f, 0.55f, 1.0f), vec3(0.3f, 0.9f, 0.4f));
+	return Colors[(id * 2654435761U) >> 30];
+}
+
+void main() {
+	if (aPositionKind.w == 0.0f) {
+		// NOTE: Free slot, outside the clip volume so it's dropped before rasterization
+		gl_Position = vec4(2.0f, 2.0f, 2.0f, 1.0f);
+		gl_PointSize = 0.0f;
+		vColor = vec4(0.0f);
+		return;
+	}
+
+	float T = aVelocityAge.w / aLife;
+	float Size;
+	if (aPositionKind.w == KIND_POP) {
+		Size = 0.15f;
+		vColor = vec4(ConfettiColor(uint(gl_VertexID)), 1.0f - T * T);
+	} else {
+		Size = mix(0.4f, 1.6f, T);
+		vColor = vec4(vec3(mix(0.55f, 0.8f, T)), 0.5f * (1.0f - T));
+	}
+
+	gl_Position = uProjection * uView * vec4(aPositionKind.xyz, 1.0f);
+	gl_PointSize = uPointScale * Size / gl_Position.w;
+}
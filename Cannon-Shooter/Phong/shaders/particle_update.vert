@@ -0,0 +1,98 @@
+#version 330 core
+
+// NOTE: One particle per vertex, see particles.hpp. Kind 0 is a free slot
+layout (location = 0) in vec4 aPositionKind;
+layout (location = 1) in vec4 aVelocityAge;
+layout (location = 2) in float aLife;
+
+out vec4 vPositionKind;
+out vec4 vVelocityAge;
+out float vLife;
+
+#define MAX_EMITTERS 8
+#define KIND_POP 1.0f
+#define KIND_SMOKE 2.0f
+
+uniform int uEmitterCount;
+// NOTE: xyz position, w kind
+uniform vec4 uEmitterPositionKind[MAX_EMITTERS];
+// NOTE: xyz direction, w speed
+uniform vec4 uEmitterDirectionSpeed[MAX_EMITTERS];
+// NOTE: First slot and slot count each emitter respawns
+uniform ivec2 uEmitterSlots[MAX_EMITTERS];
+uniform float uDT;
+uniform float uTime;
+uniform float uGroundHeight;
+
+uint Hash(uint x) {
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+float Random(inout uint state) {
+	state = Hash(state);
+	return float(state) / 4294967295.0f;
+}
+
+vec3 RandomDirection(inout uint state) {
+	float Z = Random(state) * 2.0f - 1.0f;
+	float Angle = Random(state) * 6.2831853f;
+	float R = sqrt(max(1.0f - Z * Z, 0.0f));
+	return vec3(R * cos(Angle), Z, R * sin(Angle));
+}
+
+void main() {
+	vec4 PositionKind = aPositionKind;
+	vec4 VelocityAge = aVelocityAge;
+	float Life = aLife;
+
+	bool Spawned = false;
+	for (int Emitter = 0; Emitter < uEmitterCount; ++Emitter) {
+		int Offset = gl_VertexID - uEmitterSlots[Emitter].x;
+		if (Offset < 0 || Offset >= uEmitterSlots[Emitter].y) continue;
+
+		uint State = Hash(uint(gl_VertexID) ^ Hash(floatBitsToUint(uTime)));
+		vec4 Source = uEmitterPositionKind[Emitter];
+		vec4 DirectionSpeed = uEmitterDirectionSpeed[Emitter];
+		vec3 Velocity;
+		if (Source.w == KIND_POP) {
+			// NOTE: Confetti bursts out in every direction, biased along the emitter direction
+			Velocity = (RandomDirection(State) + 0.5f * DirectionSpeed.xyz) * DirectionSpeed.w * mix(0.3f, 1.0f, Random(State));
+			Life = mix(1.2f, 2.2f, Random(State));
+		} else {
+			// NOTE: Smoke leaves in a loose cone around the barrel direction
+			Velocity = normalize(DirectionSpeed.xyz + 0.35f * RandomDirection(State)) * DirectionSpeed.w * mix(0.3f, 1.0f, Random(State));
+			Life = mix(1.5f, 3.0f, Random(State));
+		}
+		PositionKind = vec4(Source.xyz, Source.w);
+		VelocityAge = vec4(Velocity, 0.0f);
+		Spawned = true;
+	}
+
+	if (!Spawned && PositionKind.w != 0.0f) {
+		vec3 Position = PositionKind.xyz;
+		vec3 Velocity = VelocityAge.xyz;
+		if (PositionKind.w == KIND_POP) {
+			Velocity += (vec3(0.0f, -4.0f, 0.0f) - 1.5f * Velocity) * uDT;
+		} else {
+			Velocity += (vec3(0.0f, 1.2f, 0.0f) - 2.0f * Velocity) * uDT;
+		}
+		Position += Velocity * uDT;
+		if (Position.y < uGroundHeight) {
+			Position.y = uGroundHeight;
+			Velocity = vec3(0.0f);
+		}
+
+		float Age = VelocityAge.w + uDT;
+		PositionKind = vec4(Position, Age < Life ? PositionKind.w : 0.0f);
+		VelocityAge = vec4(Velocity, Age);
+	}
+
+	vPositionKind = PositionKind;
+	vVelocityAge = VelocityAge;
+	vLife = Life;
+}
@@ -37,13 +37,55 @@ uniform DirectionalLight uDirLight;
 uniform Material uMaterial;
 uniform vec3 uViewPos;
 
+// NOTE: Lower quality tiers compile with PHONG_ONLY, see quality.hpp, and skip
+// the clustered lights and the sun shadows
+#ifndef PHONG_ONLY
+// NOTE: Clustered point lights, see clustered_lights.hpp. The grid holds offset and count
+// into the index list per cluster, every light is two texels: position and radius, colour
+uniform usamplerBuffer uClusterGrid;
+uniform usamplerBuffer uClusterIndices;
+uniform samplerBuffer uClusterLights;
+uniform uvec3 uClusterDims;
+uniform vec2 uClusterTileScale;
+uniform float uClusterSliceScale;
+uniform float uClusterSliceBias;
+
+// NOTE: Sun shadows, see shadow_map.hpp. Static casters come from a cached map,
+// dynamic ones from a small per-frame map, the darker of the two wins
+uniform sampler2DShadow uShadowStatic;
+uniform sampler2DShadow uShadowDynamic;
+uniform mat4 uShadowStaticMatrix;
+uniform mat4 uShadowDynamicMatrix;
+#endif
+
 in vec2 UV;
 in vec3 vWorldSpaceFragment;
 in vec3 vWorldSpaceNormal;
+in float vViewDepth;
+
+// NOTE: Clipmap ground, see terrain.hpp. The diffuse map blends from sand into beach
+#ifdef TERRAIN
+uniform sampler2D uBeach;
+in float vBeachBlend;
+#endif
 
 out vec4 FragColor;
 
+#ifndef PHONG_ONLY
+float ShadowVisibility(sampler2DShadow shadowMap, mat4 lightMatrix) {
+	vec3 Coord = (lightMatrix * vec4(vWorldSpaceFragment, 1.0f)).xyz * 0.5f + 0.5f;
+	return texture(shadowMap, Coord);
+}
+#endif
+
 void main() {
+#ifdef TERRAIN
+	vec3 Albedo = mix(vec3(texture(uMaterial.Kd, UV)), vec3(texture(uBeach, UV)), vBeachBlend);
+#else
+	vec3 Albedo = vec3(texture(uMaterial.Kd, UV));
+#endif
+	vec3 SpecularMap = vec3(texture(uMaterial.Ks, UV));
+
 	vec3 ViewDirection = normalize(uViewPos - vWorldSpaceFragment);
 	// NOTE(Jovan): Directional light
 	vec3 DirLightVector = normalize(-uDirLight.Direction);
@@ -52,10 +94,15 @@ void main() {
 	// NOTE(Jovan): 32 is the specular shininess factor. Hardcoded for now
 	float DirSpecular = pow(max(dot(ViewDirection, DirReflectDirection), 0.0f), uMaterial.Shininess);
 
-	vec3 DirAmbientColor = uDirLight.Ka * vec3(texture(uMaterial.Kd, UV));
-	vec3 DirDiffuseColor = uDirLight.Kd * DirDiffuse * vec3(texture(uMaterial.Kd, UV));
-	vec3 DirSpecularColor = uDirLight.Ks * DirSpecular * vec3(texture(uMaterial.Ks, UV));
-	vec3 DirColor = DirAmbientColor + DirDiffuseColor + DirSpecularColor;
+	vec3 DirAmbientColor = uDirLight.Ka * Albedo;
+	vec3 DirDiffuseColor = uDirLight.Kd * DirDiffuse * Albedo;
+	vec3 DirSpecularColor = uDirLight.Ks * DirSpecular * SpecularMap;
+#ifdef PHONG_ONLY
+	float SunVisibility = 1.0f;
+#else
+	float SunVisibility = min(ShadowVisibility(uShadowStatic, uShadowStaticMatrix), ShadowVisibility(uShadowDynamic, uShadowDynamicMatrix));
+#endif
+	vec3 DirColor = DirAmbientColor + SunVisibility * (DirDiffuseColor + DirSpecularColor);
 
 	// NOTE(Jovan): Point light
 	vec3 PtLightVector = normalize(uPointLight.Position - vWorldSpaceFragment);
@@ -63,9 +110,9 @@ void main() {
 	vec3 PtReflectDirection = reflect(-PtLightVector, vWorldSpaceNormal);
 	float PtSpecular = pow(max(dot(ViewDirection, PtReflectDirection), 0.0f), uMaterial.Shininess);
 
-	vec3 PtAmbientColor = uPointLight.Ka * vec3(texture(uMaterial.Kd, UV));
-	vec3 PtDiffuseColor = PtDiffuse * uPointLight.Kd * vec3(texture(uMaterial.Kd, UV));
-	vec3 PtSpecularColor = PtSpecular * uPointLight.Ks * vec3(texture(uMaterial.Ks, UV));
+	vec3 PtAmbientColor = uPointLight.Ka * Albedo;
+	vec3 PtDiffuseColor = PtDiffuse * uPointLight.Kd * Albedo;
+	vec3 PtSpecularColor = PtSpecular * uPointLight.Ks * SpecularMap;
 
 	float PtLightDistance = length(uPointLight.Position - vWorldSpaceFragment);
 	float PtAttenuation = 1.0f / (uPointLight.Kc + uPointLight.Kl * PtLightDistance + uPointLight.Kq * (PtLightDistance * PtLightDistance));
@@ -78,9 +125,9 @@ void main() {
 	vec3 SpotReflectDirection = reflect(-SpotlightVector, vWorldSpaceNormal);
 	float SpotSpecular = pow(max(dot(ViewDirection, SpotReflectDirection), 0.0f), uMaterial.Shininess);
 
-	vec3 SpotAmbientColor = uSpotlight.Ka * vec3(texture(uMaterial.Kd, UV));
-	vec3 SpotDiffuseColor = SpotDiffuse * uSpotlight.Kd * vec3(texture(uMaterial.Kd, UV));
-	vec3 SpotSpecularColor = SpotSpecular * uSpotlight.Ks * vec3(texture(uMaterial.Ks, UV));
+	vec3 SpotAmbientColor = uSpotlight.Ka * Albedo;
+	vec3 SpotDiffuseColor = SpotDiffuse * uSpotlight.Kd * Albedo;
+	vec3 SpotSpecularColor = SpotSpecular * uSpotlight.Ks * SpecularMap;
 
 	float SpotlightDistance = length(uSpotlight.Position - vWorldSpaceFragment);
 	float SpotAttenuation = 1.0f / (uSpotlight.Kc + uSpotlight.Kl * SpotlightDistance + uSpotlight.Kq * (SpotlightDistance * SpotlightDistance));
@@ -90,6 +137,31 @@ void main() {
 	float SpotIntensity = clamp((Theta - uSpotlight.OuterCutOff) / Epsilon, 0.0f, 1.0f);
 	vec3 SpotColor = SpotIntensity * SpotAttenuation * (SpotAmbientColor + SpotDiffuseColor + SpotSpecularColor);
 	
-	vec3 FinalColor = DirColor + PtColor + SpotColor;
+	vec3 ClusterColor = vec3(0.0f);
+#ifndef PHONG_ONLY
+	// NOTE: Clustered point lights, only the ones binned into this fragment's cluster
+	uint Slice = uint(max(log(vViewDepth) * uClusterSliceScale - uClusterSliceBias, 0.0f));
+	uvec3 Cluster = min(uvec3(uvec2(gl_FragCoord.xy * uClusterTileScale), Slice), uClusterDims - 1u);
+	uvec2 ClusterRange = texelFetch(uClusterGrid, int(Cluster.x + uClusterDims.x * (Cluster.y + uClusterDims.y * Cluster.z))).xy;
+	for (uint Idx = 0u; Idx < ClusterRange.y; ++Idx) {
+		int LightIdx = int(texelFetch(uClusterIndices, int(ClusterRange.x + Idx)).r);
+		vec4 LightPositionRadius = texelFetch(uClusterLights, 2 * LightIdx);
+		vec3 LightColor = texelFetch(uClusterLights, 2 * LightIdx + 1).rgb;
+
+		vec3 LightVector = LightPositionRadius.xyz - vWorldSpaceFragment;
+		float LightDistance = length(LightVector);
+		if (LightDistance >= LightPositionRadius.w) continue;
+		LightVector /= LightDistance;
+
+		// NOTE: Reaches zero at the radius so the light never leaks out of the clusters it was binned into
+		float Falloff = 1.0f - (LightDistance * LightDistance) / (LightPositionRadius.w * LightPositionRadius.w);
+		Falloff *= Falloff;
+		float LightDiffuse = max(dot(vWorldSpaceNormal, LightVector), 0.0f);
+		float LightSpecular = pow(max(dot(ViewDirection, reflect(-LightVector, vWorldSpaceNormal)), 0.0f), uMaterial.Shininess);
+		ClusterColor += Falloff * LightColor * (LightDiffuse * Albedo + LightSpecular * SpecularMap);
+	}
+#endif
+
+	vec3 FinalColor = DirColor + PtColor + SpotColor + ClusterColor;
 	FragColor = vec4(FinalColor, 1.0f);
 }
@@ -0,0 +1,59 @@
+#version 330 core
+
+// NOTE: Vertex index on the shared clipmap grid, see terrain.hpp
+layout (location = 0) in vec2 aGrid;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+// NOTE: Places and scales the grid for one level, x and z only
+uniform mat4 uModel;
+
+uniform sampler2D uHeightmap;
+uniform float uTerrainGrid;
+uniform float uHeightmapWorldSize;
+uniform float uTerrainBaseHeight;
+uniform float uTerrainAmplitude;
+uniform float uTerrainFlatRadius;
+uniform float uTerrainRampWidth;
+uniform float uTerrainTextureScale;
+
+out vec2 UV;
+out vec3 vWorldSpaceFragment;
+out vec3 vWorldSpaceNormal;
+out float vViewDepth;
+out float vBeachBlend;
+
+float Noise(vec2 position) {
+	return textureLod(uHeightmap, position / uHeightmapWorldSize, 0.0f).r;
+}
+
+float Height(vec2 position) {
+	float Ramp = smoothstep(uTerrainFlatRadius, uTerrainFlatRadius + uTerrainRampWidth, length(position));
+	return uTerrainBaseHeight + uTerrainAmplitude * Ramp * Noise(position);
+}
+
+void main() {
+	vec2 Position = (uModel * vec4(aGrid.x, 0.0f, aGrid.y, 1.0f)).xz;
+	float Spacing = uModel[0][0];
+	float Elevation = Height(Position);
+
+	// NOTE: Odd vertices on the outer edge sit between two vertices of the next coarser level, taking
+	// the average of their neighbours puts them on the coarse edge and closes the T-junction cracks
+	bool OddX = mod(aGrid.x, 2.0f) > 0.5f;
+	bool OddZ = mod(aGrid.y, 2.0f) > 0.5f;
+	bool EdgeX = aGrid.x < 0.5f || aGrid.x > uTerrainGrid - 0.5f;
+	bool EdgeZ = aGrid.y < 0.5f || aGrid.y > uTerrainGrid - 0.5f;
+	if (EdgeX && OddZ) Elevation = 0.5f * (Height(Position - vec2(0.0f, Spacing)) + Height(Position + vec2(0.0f, Spacing)));
+	if (EdgeZ && OddX) Elevation = 0.5f * (Height(Position - vec2(Spacing, 0.0f)) + Height(Position + vec2(Spacing, 0.0f)));
+
+	float DX = Height(Position + vec2(Spacing, 0.0f)) - Height(Position - vec2(Spacing, 0.0f));
+	float DZ = Height(Position + vec2(0.0f, Spacing)) - Height(Position - vec2(0.0f, Spacing));
+	vWorldSpaceNormal = normalize(vec3(-DX, 2.0f * Spacing, -DZ));
+
+	// NOTE: Low ground and hollows on the flat field turn into beach, the rest stays sand
+	vBeachBlend = smoothstep(0.05f, -0.25f, Noise(Position));
+	vWorldSpaceFragment = vec3(Position.x, Elevation, Position.y);
+	vViewDepth = -(uView * vec4(vWorldSpaceFragment, 1.0f)).z;
+	UV = Position / uTerrainTextureScale;
+	gl_Position = uProjection * uView * vec4(vWorldSpaceFragment, 1.0f);
+}
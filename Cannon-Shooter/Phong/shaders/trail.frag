@@ -0,0 +1,9 @@
+#version 330 core
+
+in float vAge;
+out vec4 FragColor;
+
+void main() {
+	float Fade = 1.0f - vAge;
+	FragColor = vec4(mix(vec3(1.0f, 0.95f, 0.8f), vec3(1.0f, 0.6f, 0.3f), vAge), 0.6f * Fade * Fade);
+}
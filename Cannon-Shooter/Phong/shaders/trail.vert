@@ -0,0 +1,25 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aTangent;
+// NOTE: x is -1 or 1 for the ribbon edge, y the age from 0 at the ball to 1 at the tail
+layout (location = 2) in vec2 aSideAge;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform vec3 uViewPos;
+
+out float vAge;
+
+#define TRAIL_WIDTH 0.35f
+
+void main() {
+	// NOTE: Widen across the trail direction and the view ray so the ribbon always faces the camera
+	vec3 Side = cross(aTangent, uViewPos - aPosition);
+	float Length = length(Side);
+	Side = Length > 1e-6f ? Side / Length : vec3(0.0f);
+
+	float HalfWidth = 0.5f * TRAIL_WIDTH * (1.0f - aSideAge.y);
+	vAge = aSideAge.y;
+	gl_Position = uProjection * uView * vec4(aPosition + Side * aSideAge.x * HalfWidth, 1.0f);
+}
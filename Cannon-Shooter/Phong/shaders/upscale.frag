@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec2 vUV;
+out vec4 FragColor;
+
+uniform sampler2D uScene;
+// NOTE: Fraction of the target the scene was rendered into
+uniform vec2 uScale;
+// NOTE: Centre of the last rendered texel, keeps bilinear taps off the unused part of the target
+uniform vec2 uMaxUV;
+
+void main() {
+	vec2 UV = min(vUV * uScale, uMaxUV);
+	FragColor = vec4(texture(uScene, UV).rgb, 1.0f);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+out vec2 vUV;
+
+void main() {
+	// NOTE: One triangle covering the screen, built from the vertex id so no buffer is bound
+	vec2 Corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	vUV = Corner;
+	gl_Position = vec4(Corner * 2.0f - 1.0f, 0.0f, 1.0f);
+}
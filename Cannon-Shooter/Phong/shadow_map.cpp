@@ -0,0 +1,176 @@
+#include "shadow_map.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+// NOTE: Depth bias while drawing casters, the slope term covers surfaces at grazing angles
+#define SHADOW_BIAS_SLOPE 2.0f
+#define SHADOW_BIAS_CONSTANT 4.0f
+
+ShadowMaps::ShadowMaps() {
+    mStaticFBO = 0;
+    mDynamicFBO = 0;
+    mStaticMap = 0;
+    mDynamicMap = 0;
+    mLightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+    mStaticBounds.Min = glm::vec3(0.0f);
+    mStaticBounds.Max = glm::vec3(0.0f);
+    mStaticStale = true;
+    mStaticRedraws = 0;
+    mStaticMatrix = glm::mat4(1.0f);
+    mDynamicMatrix = glm::mat4(1.0f);
+}
+
+bool
+ShadowMaps::createMap(unsigned size, unsigned& map, unsigned& fbo) {
+    glGenTextures(1, &map);
+    GLState.BindTexture(0, GL_TEXTURE_2D, map);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    // NOTE: Linear filtering with compare mode gives 2x2 PCF in hardware
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    // NOTE: Anything outside the map reads the far plane and is lit
+    float Border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, Border);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, map, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    bool Complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!Complete) std::cerr << "[Err] Shadow map framebuffer incomplete" << std::endl;
+    return Complete;
+}
+
+bool
+ShadowMaps::Init() {
+    return createMap(SHADOW_STATIC_SIZE, mStaticMap, mStaticFBO) && createMap(SHADOW_DYNAMIC_SIZE, mDynamicMap, mDynamicFBO);
+}
+
+void
+ShadowMaps::SetupShader(Shader& shader) const {
+    GLState.UseProgram(shader.GetId());
+    shader.SetUniform1i("uShadowStatic", SHADOW_STATIC_UNIT);
+    shader.SetUniform1i("uShadowDynamic", SHADOW_DYNAMIC_UNIT);
+}
+
+void
+ShadowMaps::SetLightDirection(const glm::vec3& direction) {
+    glm::vec3 Direction = glm::normalize(direction);
+    if (1.0f - glm::dot(Direction, mLightDirection) > SHADOW_DIRECTION_EPSILON) mStaticStale = true;
+    mLightDirection = Direction;
+}
+
+void
+ShadowMaps::SetStaticBounds(const AABB& bounds) {
+    mStaticBounds = bounds;
+    mStaticStale = true;
+}
+
+glm::mat4
+ShadowMaps::fitSphere(const glm::vec3& center, float radius, unsigned size) const {
+    glm::vec3 Up = std::fabs(mLightDirection.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 LightRotation = glm::lookAt(glm::vec3(0.0f), mLightDirection, Up);
+
+    // NOTE: Snapping the centre to whole texels keeps shadow edges from crawling as the fit moves
+    float TexelSize = 2.0f * radius / size;
+    glm::vec4 LightCenter = LightRotation * glm::vec4(center, 1.0f);
+    LightCenter.x = std::floor(LightCenter.x / TexelSize) * TexelSize;
+    LightCenter.y = std::floor(LightCenter.y / TexelSize) * TexelSize;
+    glm::mat4 Projection = glm::ortho(LightCenter.x - radius, LightCenter.x + radius, LightCenter.y - radius, LightCenter.y + radius,
+        -LightCenter.z - radius, -LightCenter.z + radius);
+    return Projection * LightRotation;
+}
+
+void
+ShadowMaps::begin(unsigned fbo, unsigned size) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, size, size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    // NOTE: Leaves are single sided cards, both faces have to cast
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(SHADOW_BIAS_SLOPE, SHADOW_BIAS_CONSTANT);
+}
+
+bool
+ShadowMaps::BeginStatic() {
+    if (!mStaticStale || !mStaticFBO) return false;
+    mStaticStale = false;
+    mStaticRedraws++;
+
+    glm::vec3 Center = 0.5f * (mStaticBounds.Min + mStaticBounds.Max);
+    float Radius = std::max(glm::length(mStaticBounds.Max - Center), 1.0f);
+    mStaticMatrix = fitSphere(Center, Radius, SHADOW_STATIC_SIZE);
+    begin(mStaticFBO, SHADOW_STATIC_SIZE);
+    return true;
+}
+
+void
+ShadowMaps::end() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glEnable(GL_CULL_FACE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void
+ShadowMaps::EndStatic() {
+    end();
+}
+
+void
+ShadowMaps::BeginDynamic(const std::vector<glm::vec4>& casters) {
+    if (casters.empty()) {
+        begin(mDynamicFBO, SHADOW_DYNAMIC_SIZE);
+        return;
+    }
+
+    glm::vec3 Min = glm::vec3(casters[0]) - glm::vec3(casters[0].w);
+    glm::vec3 Max = glm::vec3(casters[0]) + glm::vec3(casters[0].w);
+    for (unsigned CasterIdx = 1; CasterIdx < casters.size(); ++CasterIdx) {
+        Min = glm::min(Min, glm::vec3(casters[CasterIdx]) - glm::vec3(casters[CasterIdx].w));
+        Max = glm::max(Max, glm::vec3(casters[CasterIdx]) + glm::vec3(casters[CasterIdx].w));
+    }
+
+    // NOTE: Radius grows in whole units so the texel size only changes when the casters spread out a lot
+    glm::vec3 Center = 0.5f * (Min + Max);
+    float Radius = std::ceil(glm::length(Max - Center));
+    mDynamicMatrix = fitSphere(Center, Radius, SHADOW_DYNAMIC_SIZE);
+    begin(mDynamicFBO, SHADOW_DYNAMIC_SIZE);
+}
+
+void
+ShadowMaps::EndDynamic() {
+    end();
+}
+
+const glm::mat4&
+ShadowMaps::GetStaticMatrix() const {
+    return mStaticMatrix;
+}
+
+const glm::mat4&
+ShadowMaps::GetDynamicMatrix() const {
+    return mDynamicMatrix;
+}
+
+void
+ShadowMaps::Apply(Shader& shader) const {
+    shader.SetUniform4m("uShadowStaticMatrix", mStaticMatrix);
+    shader.SetUniform4m("uShadowDynamicMatrix", mDynamicMatrix);
+    GLState.BindTexture(SHADOW_STATIC_UNIT, GL_TEXTURE_2D, mStaticMap);
+    GLState.BindTexture(SHADOW_DYNAMIC_UNIT, GL_TEXTURE_2D, mDynamicMap);
+}
+
+unsigned
+ShadowMaps::GetStaticRedraws() const {
+    return mStaticRedraws;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "culling.hpp"
+#include "shader.hpp"
+
+#define SHADOW_STATIC_SIZE 2048
+#define SHADOW_DYNAMIC_SIZE 1024
+// NOTE: Texture units of the maps, 0 and 1 hold the material, 2 to 4 the light clusters
+#define SHADOW_STATIC_UNIT 5
+#define SHADOW_DYNAMIC_UNIT 6
+// NOTE: Light direction change (1 - cosine) below which the cached map is kept
+#define SHADOW_DIRECTION_EPSILON 1e-4f
+
+/**
+ * @brief Directional light shadows split into two maps. Static casters are
+ * rendered into a large map that is cached and only redrawn when the light
+ * direction changes, dynamic casters into a small map fitted around them and
+ * redrawn every frame. Receivers sample both and take the darker result
+ */
+class ShadowMaps {
+public:
+    ShadowMaps();
+
+    /**
+     * @brief Creates both depth textures and their framebuffers
+     *
+     * @returns true - Success, false - Framebuffer incomplete
+     */
+    bool Init();
+
+    /**
+     * @brief Sets the sampler units on a program receiving shadows
+     *
+     */
+    void SetupShader(Shader& shader) const;
+
+    /**
+     * @brief Sets the direction the light shines in, the static map is marked
+     * stale if it moved
+     *
+     */
+    void SetLightDirection(const glm::vec3& direction);
+
+    /**
+     * @brief Sets the world bounds of every static caster, marks the static map stale
+     *
+     */
+    void SetStaticBounds(const AABB& bounds);
+
+    /**
+     * @brief Starts redrawing the static map if it is stale: binds its framebuffer,
+     * sets the viewport and clears it. Casters are drawn with GetStaticMatrix as
+     * projection and an identity view
+     *
+     * @returns true - Map has to be redrawn, call EndStatic afterwards, false - Cached map is current
+     */
+    bool BeginStatic();
+
+    /**
+     * @brief Binds the default framebuffer, restores face culling and turns the depth bias off
+     *
+     */
+    void EndStatic();
+
+    /**
+     * @brief Fits the dynamic map around this frame's casters, binds its
+     * framebuffer, sets the viewport and clears it
+     *
+     * @param casters - World bounding spheres, center in xyz and radius in w
+     *
+     */
+    void BeginDynamic(const std::vector<glm::vec4>& casters);
+
+    /**
+     * @brief Binds the default framebuffer, restores face culling and turns the depth bias off
+     *
+     */
+    void EndDynamic();
+
+    const glm::mat4& GetStaticMatrix() const;
+    const glm::mat4& GetDynamicMatrix() const;
+
+    /**
+     * @brief Binds both maps and sets the light matrices on the bound program
+     *
+     */
+    void Apply(Shader& shader) const;
+
+    /**
+     * @returns How often the static map was drawn since Init
+     */
+    unsigned GetStaticRedraws() const;
+
+private:
+    unsigned mStaticFBO;
+    unsigned mDynamicFBO;
+    unsigned mStaticMap;
+    unsigned mDynamicMap;
+    glm::vec3 mLightDirection;
+    AABB mStaticBounds;
+    bool mStaticStale;
+    unsigned mStaticRedraws;
+    glm::mat4 mStaticMatrix;
+    glm::mat4 mDynamicMatrix;
+
+    bool createMap(unsigned size, unsigned& map, unsigned& fbo);
+    glm::mat4 fitSphere(const glm::vec3& center, float radius, unsigned size) const;
+    void begin(unsigned fbo, unsigned size);
+    void end();
+};
@@ -0,0 +1,145 @@
+#include "snapshot.hpp"
+#include <fstream>
+#include <iostream>
+
+const SnapshotRandom::State&
+SnapshotRandom::GetState() const {
+    return mState;
+}
+
+bool
+SnapshotRandom::SetState(const State& state) {
+    if (state.Draws > SNAPSHOT_MAX_RANDOM_DRAWS) return false;
+    if (state.Seed != mState.Seed || state.Draws < mState.Draws) {
+        mEngine.seed((result_type)state.Seed);
+        mState.Seed = state.Seed;
+        mState.Draws = 0;
+    }
+    mEngine.discard(state.Draws - mState.Draws);
+    mState.Draws = state.Draws;
+    return true;
+}
+
+void
+SnapshotWriter::Begin() {
+    mData.clear();
+    Write(SNAPSHOT_MAGIC);
+    Write(SNAPSHOT_VERSION);
+}
+
+void
+SnapshotWriter::WriteBytes(const void* data, size_t size) {
+    size_t Offset = mData.size();
+    mData.resize(Offset + size);
+    std::memcpy(mData.data() + Offset, data, size);
+}
+
+const std::vector<unsigned char>&
+SnapshotWriter::Data() const {
+    return mData;
+}
+
+SnapshotReader::SnapshotReader(const std::vector<unsigned char>& data) : mData(data) {
+    mOffset = 0;
+}
+
+bool
+SnapshotReader::Begin() {
+    unsigned Magic = 0;
+    unsigned Version = 0;
+    mOffset = 0;
+    if (!Read(Magic) || !Read(Version)) return false;
+    if (Magic != SNAPSHOT_MAGIC) {
+        std::cerr << "[Err] Not a world snapshot" << std::endl;
+        return false;
+    }
+    if (Version != SNAPSHOT_VERSION) {
+        std::cerr << "[Err] Unsupported snapshot version " << Version << ", expected " << SNAPSHOT_VERSION << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool
+SnapshotReader::ReadBytes(void* data, size_t size) {
+    if (mData.size() - mOffset < size) return false;
+    std::memcpy(data, mData.data() + mOffset, size);
+    mOffset += size;
+    return true;
+}
+
+size_t
+SnapshotReader::Remaining() const {
+    return mData.size() - mOffset;
+}
+
+void serializePhysicsWorld(SnapshotWriter& writer, const std::list<Sphere*>& sphereList, const std::list<Plane*>& planeList, const std::list<Cylinder*>& cylinderList,
+    const std::list<Box*>& boxList, const std::list<Capsule*>& capsuleList, const std::list<ConvexHull*>& hullList) {
+    writer.WriteList(sphereList);
+    writer.WriteList(planeList);
+    writer.WriteList(cylinderList);
+    writer.WriteList(boxList);
+    writer.WriteList(capsuleList);
+
+    // NOTE: Hulls own their points, so they can't go through WriteList
+    writer.Write<unsigned>((unsigned)hullList.size());
+    for (const ConvexHull* hull : hullList) {
+        writer.Write(hull->Position);
+        writer.Write(hull->Rotation);
+        writer.Write<unsigned>((unsigned)hull->Points.size());
+        writer.WriteBytes(hull->Points.data(), hull->Points.size() * sizeof(glm::vec3));
+    }
+}
+
+bool deserializePhysicsWorld(SnapshotReader& reader, std::list<Sphere*>& sphereList, std::list<Plane*>& planeList, std::list<Cylinder*>& cylinderList,
+    std::list<Box*>& boxList, std::list<Capsule*>& capsuleList, std::list<ConvexHull*>& hullList) {
+    if (!reader.ReadList(sphereList)) return false;
+    if (!reader.ReadList(planeList)) return false;
+    if (!reader.ReadList(cylinderList)) return false;
+    if (!reader.ReadList(boxList)) return false;
+    if (!reader.ReadList(capsuleList)) return false;
+
+    unsigned hullCount = 0;
+    if (!reader.Read(hullCount)) return false;
+    if (reader.Remaining() < (size_t)hullCount * (sizeof(glm::vec3) + sizeof(glm::mat3) + sizeof(unsigned))) return false;
+    while (hullList.size() > hullCount) {
+        delete hullList.back();
+        hullList.pop_back();
+    }
+    while (hullList.size() < hullCount) {
+        hullList.push_back(new ConvexHull());
+    }
+    for (ConvexHull* hull : hullList) {
+        unsigned pointCount = 0;
+        if (!reader.Read(hull->Position) || !reader.Read(hull->Rotation) || !reader.Read(pointCount)) return false;
+        // NOTE: Count comes from the blob, check it against what is left before allocating.
+        // Support queries read the first point, a hull also needs at least a tetrahedron to enclose anything
+        if (pointCount < SNAPSHOT_MIN_HULL_POINTS || reader.Remaining() < (size_t)pointCount * sizeof(glm::vec3)) return false;
+        hull->Points.resize(pointCount);
+        if (!reader.ReadBytes(hull->Points.data(), pointCount * sizeof(glm::vec3))) return false;
+    }
+    return true;
+}
+
+bool writeSnapshotFile(const std::string& path, const std::vector<unsigned char>& data) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "[Err] Failed to open snapshot file for writing: " << path << std::endl;
+        return false;
+    }
+    out.write((const char*)data.data(), data.size());
+    return (bool)out;
+}
+
+bool readSnapshotFile(const std::string& path, std::vector<unsigned char>& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "[Err] Failed to open snapshot file: " << path << std::endl;
+        return false;
+    }
+    in.seekg(0, std::ios::end);
+    data.resize((size_t)in.tellg());
+    in.seekg(0, std::ios::beg);
+    in.read((char*)data.data(), data.size());
+    return (bool)in;
+}
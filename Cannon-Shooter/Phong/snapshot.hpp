@@ -0,0 +1,172 @@
+#include <cstring>
+#include <list>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "physics.hpp"
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+const unsigned SNAPSHOT_MAGIC = 0x53574343; // "CCWS"
+const unsigned SNAPSHOT_VERSION = 3;
+const unsigned SNAPSHOT_MIN_HULL_POINTS = 4;
+// NOTE: Restoring replays the draws, a corrupt count must not stall the load
+const unsigned long long SNAPSHOT_MAX_RANDOM_DRAWS = 1ull << 26;
+
+/**
+ * @brief Random engine that counts its draws, so its state fits in a fixed size
+ * record of seed and draw count instead of depending on the engine's layout
+ */
+class SnapshotRandom {
+public:
+    typedef std::mt19937::result_type result_type;
+
+    // NOTE: Both fields are 64 bit so the record has no padding bytes
+    struct State {
+        unsigned long long Seed;
+        unsigned long long Draws;
+    };
+
+    SnapshotRandom(result_type seed) : mEngine(seed) {
+        mState.Seed = seed;
+        mState.Draws = 0;
+    }
+
+    result_type operator()() {
+        mState.Draws++;
+        return mEngine();
+    }
+
+    static constexpr result_type min() { return std::mt19937::min(); }
+    static constexpr result_type max() { return std::mt19937::max(); }
+
+    const State& GetState() const;
+
+    /**
+     * @brief Reseeds and replays the draws, only the difference when moving forward on the same seed
+     *
+     * @returns false if the draw count is over SNAPSHOT_MAX_RANDOM_DRAWS, the engine is left as it was
+     */
+    bool SetState(const State& state);
+
+private:
+    std::mt19937 mEngine;
+    State mState;
+};
+
+/**
+ * @brief Appends raw bytes to a snapshot blob. The buffer keeps its capacity
+ * between snapshots, so writing one every frame does not allocate once warm
+ */
+class SnapshotWriter {
+public:
+    /**
+     * @brief Clears previous contents and writes the blob header
+     */
+    void Begin();
+
+    template<class T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Snapshot values must be trivially copyable");
+        WriteBytes(&value, sizeof(T));
+    }
+
+    /**
+     * @brief Writes element count and size followed by the elements back to back
+     *
+     * @param items Bodies to store
+     */
+    template<class T>
+    void WriteList(const std::list<T*>& items) {
+        static_assert(std::is_trivially_copyable<T>::value, "Snapshot bodies must be trivially copyable");
+        Write<unsigned>((unsigned)items.size());
+        Write<unsigned>((unsigned)sizeof(T));
+
+        size_t Offset = mData.size();
+        mData.resize(Offset + items.size() * sizeof(T));
+        unsigned char* Dst = mData.data() + Offset;
+        for (const T* item : items) {
+            std::memcpy(Dst, item, sizeof(T));
+            Dst += sizeof(T);
+        }
+    }
+
+    void WriteBytes(const void* data, size_t size);
+
+    const std::vector<unsigned char>& Data() const;
+
+private:
+    std::vector<unsigned char> mData;
+};
+
+/**
+ * @brief Reads a blob produced by SnapshotWriter. Every read is bounds checked
+ * and returns false on a truncated or mismatched blob
+ */
+class SnapshotReader {
+public:
+    SnapshotReader(const std::vector<unsigned char>& data);
+
+    /**
+     * @brief Checks magic and version
+     *
+     * @returns true - Blob can be read, false - Unknown format or version
+     */
+    bool Begin();
+
+    template<class T>
+    bool Read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Snapshot values must be trivially copyable");
+        return ReadBytes(&value, sizeof(T));
+    }
+
+    /**
+     * @brief Restores a body list, reusing already allocated bodies and only
+     * allocating or freeing the difference in count
+     *
+     * @param items Bodies to overwrite
+     */
+    template<class T>
+    bool ReadList(std::list<T*>& items) {
+        unsigned Count = 0;
+        unsigned ElementSize = 0;
+        if (!Read(Count) || !Read(ElementSize)) return false;
+        if (ElementSize != sizeof(T) || Remaining() < (size_t)Count * sizeof(T)) return false;
+
+        while (items.size() > Count) {
+            delete items.back();
+            items.pop_back();
+        }
+        while (items.size() < Count) {
+            items.push_back(new T());
+        }
+
+        const unsigned char* Src = mData.data() + mOffset;
+        for (T* item : items) {
+            std::memcpy(item, Src, sizeof(T));
+            Src += sizeof(T);
+        }
+        mOffset += (size_t)Count * sizeof(T);
+        return true;
+    }
+
+    bool ReadBytes(void* data, size_t size);
+
+    size_t Remaining() const;
+
+private:
+    const std::vector<unsigned char>& mData;
+    size_t mOffset;
+};
+
+void serializePhysicsWorld(SnapshotWriter& writer, const std::list<Sphere*>& sphereList, const std::list<Plane*>& planeList, const std::list<Cylinder*>& cylinderList,
+    const std::list<Box*>& boxList, const std::list<Capsule*>& capsuleList, const std::list<ConvexHull*>& hullList);
+
+bool deserializePhysicsWorld(SnapshotReader& reader, std::list<Sphere*>& sphereList, std::list<Plane*>& planeList, std::list<Cylinder*>& cylinderList,
+    std::list<Box*>& boxList, std::list<Capsule*>& capsuleList, std::list<ConvexHull*>& hullList);
+
+bool writeSnapshotFile(const std::string& path, const std::vector<unsigned char>& data);
+bool readSnapshotFile(const std::string& path, std::vector<unsigned char>& data);
+
+#endif
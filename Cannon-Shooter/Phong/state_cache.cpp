@@ -0,0 +1,150 @@
+#include "state_cache.hpp"
+
+StateCache GLState;
+
+static int
+bufferTargetIndex(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_PIXEL_PACK_BUFFER: return 1;
+    case GL_PIXEL_UNPACK_BUFFER: return 2;
+    case GL_TEXTURE_BUFFER: return 3;
+    case GL_TRANSFORM_FEEDBACK_BUFFER: return 4;
+    case GL_UNIFORM_BUFFER: return 5;
+    case GL_COPY_READ_BUFFER: return 6;
+    case GL_COPY_WRITE_BUFFER: return 7;
+    }
+    return -1;
+}
+
+static int
+textureTargetIndex(GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D: return 0;
+    case GL_TEXTURE_CUBE_MAP: return 1;
+    case GL_TEXTURE_BUFFER: return 2;
+    case GL_TEXTURE_2D_ARRAY: return 3;
+    }
+    return -1;
+}
+
+StateCache::StateCache() {
+    mIssued = 0;
+    mSkipped = 0;
+    mLastIssued = 0;
+    mLastSkipped = 0;
+    Invalidate();
+}
+
+void
+StateCache::Invalidate() {
+    mProgram = STATE_CACHE_UNKNOWN;
+    mVAO = STATE_CACHE_UNKNOWN;
+    mActiveUnit = STATE_CACHE_UNKNOWN;
+    mDepthFunc = STATE_CACHE_UNKNOWN;
+    for (unsigned Target = 0; Target < STATE_CACHE_BUFFER_TARGETS; ++Target) {
+        mBuffers[Target] = STATE_CACHE_UNKNOWN;
+    }
+    for (unsigned Unit = 0; Unit < STATE_CACHE_TEXTURE_UNITS; ++Unit) {
+        for (unsigned Target = 0; Target < STATE_CACHE_TEXTURE_TARGETS; ++Target) {
+            mTextures[Unit][Target] = STATE_CACHE_UNKNOWN;
+        }
+    }
+    mElementBuffers.assign(mElementBuffers.size(), STATE_CACHE_UNKNOWN);
+}
+
+bool
+StateCache::update(unsigned& current, unsigned value) {
+    if (current == value) {
+        mSkipped++;
+        return false;
+    }
+    current = value;
+    mIssued++;
+    return true;
+}
+
+void
+StateCache::UseProgram(unsigned program) {
+    if (update(mProgram, program)) glUseProgram(program);
+}
+
+void
+StateCache::BindVertexArray(unsigned vao) {
+    if (update(mVAO, vao)) glBindVertexArray(vao);
+}
+
+void
+StateCache::BindBuffer(GLenum target, unsigned buffer) {
+    if (target == GL_ELEMENT_ARRAY_BUFFER && mVAO != STATE_CACHE_UNKNOWN) {
+        if (mVAO >= mElementBuffers.size()) mElementBuffers.resize(mVAO + 1, STATE_CACHE_UNKNOWN);
+        if (update(mElementBuffers[mVAO], buffer)) glBindBuffer(target, buffer);
+        return;
+    }
+
+    int TargetIdx = bufferTargetIndex(target);
+    if (TargetIdx < 0) {
+        mIssued++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if (update(mBuffers[TargetIdx], buffer)) glBindBuffer(target, buffer);
+}
+
+void
+StateCache::BindBufferBase(GLenum target, unsigned index, unsigned buffer) {
+    mIssued++;
+    glBindBufferBase(target, index, buffer);
+    int TargetIdx = bufferTargetIndex(target);
+    if (TargetIdx >= 0) mBuffers[TargetIdx] = buffer;
+}
+
+void
+StateCache::ActiveTexture(unsigned unit) {
+    if (update(mActiveUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void
+StateCache::BindTexture(GLenum target, unsigned texture) {
+    int TargetIdx = textureTargetIndex(target);
+    if (TargetIdx < 0 || mActiveUnit >= STATE_CACHE_TEXTURE_UNITS) {
+        mIssued++;
+        glBindTexture(target, texture);
+        return;
+    }
+    if (update(mTextures[mActiveUnit][TargetIdx], texture)) glBindTexture(target, texture);
+}
+
+void
+StateCache::BindTexture(unsigned unit, GLenum target, unsigned texture) {
+    int TargetIdx = textureTargetIndex(target);
+    if (TargetIdx >= 0 && unit < STATE_CACHE_TEXTURE_UNITS && mTextures[unit][TargetIdx] == texture) {
+        mSkipped++;
+        return;
+    }
+    ActiveTexture(unit);
+    BindTexture(target, texture);
+}
+
+void
+StateCache::DepthFunc(GLenum func) {
+    if (update(mDepthFunc, func)) glDepthFunc(func);
+}
+
+void
+StateCache::BeginFrame() {
+    mLastIssued = mIssued;
+    mLastSkipped = mSkipped;
+    mIssued = 0;
+    mSkipped = 0;
+}
+
+unsigned
+StateCache::GetIssuedCalls() const {
+    return mLastIssued;
+}
+
+unsigned
+StateCache::GetSkippedCalls() const {
+    return mLastSkipped;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+
+#define STATE_CACHE_TEXTURE_UNITS 16
+#define STATE_CACHE_TEXTURE_TARGETS 4
+#define STATE_CACHE_BUFFER_TARGETS 8
+#define STATE_CACHE_UNKNOWN 0xFFFFFFFF
+
+/**
+ * @brief Shadows the GL bindings the renderer touches and drops calls that
+ * would set what is already set. Every bind in the program has to go through
+ * it, a raw glBind* call desyncs the shadow copy until Invalidate
+ */
+class StateCache {
+public:
+    StateCache();
+
+    void UseProgram(unsigned program);
+
+    /**
+     * @brief Binds a VAO. The element buffer binding is remembered per VAO,
+     * as GL stores it in the VAO
+     *
+     */
+    void BindVertexArray(unsigned vao);
+
+    void BindBuffer(GLenum target, unsigned buffer);
+
+    /**
+     * @brief Binds a buffer to an indexed binding point. Indexed bindings aren't
+     * shadowed so the call always goes out, the generic binding it also sets is remembered
+     *
+     */
+    void BindBufferBase(GLenum target, unsigned index, unsigned buffer);
+
+    /**
+     * @param unit - Texture unit index, 0 for GL_TEXTURE0
+     */
+    void ActiveTexture(unsigned unit);
+
+    /**
+     * @brief Binds a texture to the active unit
+     *
+     */
+    void BindTexture(GLenum target, unsigned texture);
+
+    /**
+     * @brief Binds a texture to a unit, switching the active unit only if needed
+     *
+     */
+    void BindTexture(unsigned unit, GLenum target, unsigned texture);
+
+    void DepthFunc(GLenum func);
+
+    /**
+     * @brief Forgets everything, the next call of each kind is issued
+     *
+     */
+    void Invalidate();
+
+    /**
+     * @brief Latches the counts of the frame that ended and starts counting again
+     *
+     */
+    void BeginFrame();
+
+    /**
+     * @returns Calls that reached GL during the last frame
+     */
+    unsigned GetIssuedCalls() const;
+
+    /**
+     * @returns Calls dropped as redundant during the last frame
+     */
+    unsigned GetSkippedCalls() const;
+
+private:
+    unsigned mProgram;
+    unsigned mVAO;
+    unsigned mActiveUnit;
+    unsigned mDepthFunc;
+    unsigned mBuffers[STATE_CACHE_BUFFER_TARGETS];
+    unsigned mTextures[STATE_CACHE_TEXTURE_UNITS][STATE_CACHE_TEXTURE_TARGETS];
+    std::vector<unsigned> mElementBuffers;
+
+    unsigned mIssued;
+    unsigned mSkipped;
+    unsigned mLastIssued;
+    unsigned mLastSkipped;
+
+    bool update(unsigned& current, unsigned value);
+};
+
+extern StateCache GLState;
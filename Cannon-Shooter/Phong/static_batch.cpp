@@ -0,0 +1,223 @@
+#include "static_batch.hpp"
+#include "state_cache.hpp"
+#include <algorithm>
+
+StaticBatch::StaticBatch(unsigned diffuseTexture, unsigned specularTexture, unsigned state) {
+    mVAO = 0;
+    mVBO = 0;
+    mEBO = 0;
+    mDiffuseTexture = diffuseTexture;
+    mSpecularTexture = specularTexture;
+    mState = state;
+    mTriangleCount = 0;
+}
+
+void
+StaticBatch::AddDraw(const std::vector<float>& vertices, const std::vector<unsigned>* const* lods, unsigned lodCount,
+    const glm::mat4& transform, const glm::vec4& lodSphere, float maxDistance, unsigned occlusionSlot) {
+    unsigned VertexCount = vertices.size() / STATIC_BATCH_VERTEX_FLOATS;
+    if (!VertexCount || !lodCount || lods[0]->empty()) return;
+
+    glm::mat3 NormalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    unsigned BaseVertex = mVertices.size() / STATIC_BATCH_VERTEX_FLOATS;
+
+    glm::vec3 Min(0.0f);
+    glm::vec3 Max(0.0f);
+    mVertices.reserve(mVertices.size() + vertices.size());
+    for (unsigned VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx) {
+        const float* Src = &vertices[VertexIdx * STATIC_BATCH_VERTEX_FLOATS];
+        glm::vec4 Position = transform * glm::vec4(Src[0], Src[1], Src[2], 1.0f);
+        glm::vec3 Normal = glm::normalize(NormalMatrix * glm::vec3(Src[3], Src[4], Src[5]));
+        float Vertex[STATIC_BATCH_VERTEX_FLOATS] = { Position.x, Position.y, Position.z, Normal.x, Normal.y, Normal.z, Src[6], Src[7] };
+        mVertices.insert(mVertices.end(), Vertex, Vertex + STATIC_BATCH_VERTEX_FLOATS);
+
+        glm::vec3 World(Position.x, Position.y, Position.z);
+        Min = VertexIdx ? glm::min(Min, World) : World;
+        Max = VertexIdx ? glm::max(Max, World) : World;
+    }
+
+    // NOTE: Indices stay local to the draw, the base vertex shifts them at draw time
+    for (unsigned Lod = 0; Lod < LOD_COUNT; ++Lod) {
+        const std::vector<unsigned>& Indices = *lods[std::min(Lod, lodCount - 1)];
+        mCounts.push_back(Indices.size());
+        mOffsets.push_back((void*)(mIndices.size() * sizeof(unsigned)));
+        mIndices.insert(mIndices.end(), Indices.begin(), Indices.end());
+    }
+    mBaseVertices.push_back(BaseVertex);
+
+    glm::vec3 Center = 0.5f * (Min + Max);
+    mBounds.push_back(glm::vec4(Center, glm::length(Max - Center)));
+    mLodBounds.push_back(lodSphere.w > 0.0f ? lodSphere : mBounds.back());
+    mLods.push_back(0);
+    mMaxDistances.push_back(maxDistance);
+    mOcclusionSlots.push_back(occlusionSlot);
+}
+
+void
+StaticBatch::Upload() {
+    glGenVertexArrays(1, &mVAO);
+    GLState.BindVertexArray(mVAO);
+    glGenBuffers(1, &mVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(float), mVertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, STATIC_BATCH_VERTEX_FLOATS * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, STATIC_BATCH_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, STATIC_BATCH_VERTEX_FLOATS * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &mEBO);
+    GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(unsigned), mIndices.data(), GL_STATIC_DRAW);
+    GLState.BindVertexArray(0);
+
+    std::vector<float>().swap(mVertices);
+    std::vector<unsigned>().swap(mIndices);
+
+    mVisible.resize(mBounds.size());
+    mVisibleCounts.reserve(mBounds.size());
+    mVisibleOffsets.reserve(mBounds.size());
+    mVisibleBaseVertices.reserve(mBounds.size());
+}
+
+unsigned
+StaticBatch::Submit(RenderQueue& queue, Shader* program, const Frustum& frustum, const LodSelector& selector, const OcclusionCuller& occlusion) {
+    mTriangleCount = 0;
+    unsigned VisibleCount = frustum.CullSpheres(mBounds.data(), mBounds.size(), mVisible.data());
+    if (!VisibleCount) return 0;
+
+    mVisibleCounts.clear();
+    mVisibleOffsets.clear();
+    mVisibleBaseVertices.clear();
+    for (unsigned VisibleIdx = 0; VisibleIdx < VisibleCount; ++VisibleIdx) {
+        unsigned DrawIdx = mVisible[VisibleIdx];
+        if (occlusion.IsOccluded(mOcclusionSlots[DrawIdx])) continue;
+        const glm::vec4& LodSphere = mLodBounds[DrawIdx];
+        if (mMaxDistances[DrawIdx] > 0.0f
+            && glm::length(glm::vec3(LodSphere.x, LodSphere.y, LodSphere.z) - selector.ViewPosition) >= mMaxDistances[DrawIdx]) continue;
+
+        // NOTE: Culled draws keep their level, so coming back into view doesn't pop
+        mLods[DrawIdx] = selectLod(selector, LodSphere, mLods[DrawIdx]);
+        unsigned RangeIdx = DrawIdx * LOD_COUNT + mLods[DrawIdx];
+        mVisibleCounts.push_back(mCounts[RangeIdx]);
+        mVisibleOffsets.push_back(mOffsets[RangeIdx]);
+        mVisibleBaseVertices.push_back(mBaseVertices[DrawIdx]);
+        mTriangleCount += mCounts[RangeIdx] / 3;
+    }
+    if (mVisibleCounts.empty()) return 0;
+
+    DrawCommand Command = {};
+    Command.Program = program;
+    Command.State = mState;
+    Command.VAO = mVAO;
+    Command.EBO = mEBO;
+    Command.DiffuseTexture = mDiffuseTexture;
+    Command.SpecularTexture = mSpecularTexture;
+    Command.ModelMatrix = glm::mat4(1.0f);
+    Command.DrawCount = mVisibleCounts.size();
+    Command.MultiCounts = mVisibleCounts.data();
+    Command.MultiOffsets = mVisibleOffsets.data();
+    Command.MultiBaseVertices = mVisibleBaseVertices.data();
+    queue.Submit(RENDER_PASS_OPAQUE, Command, 0.0f);
+    return mVisibleCounts.size();
+}
+
+void
+StaticBatch::SubmitAll(RenderQueue& queue, Shader* program, unsigned state, unsigned lod) {
+    mVisibleCounts.clear();
+    mVisibleOffsets.clear();
+    mVisibleBaseVertices.clear();
+    for (unsigned DrawIdx = 0; DrawIdx < mBaseVertices.size(); ++DrawIdx) {
+        unsigned RangeIdx = DrawIdx * LOD_COUNT + lod;
+        mVisibleCounts.push_back(mCounts[RangeIdx]);
+        mVisibleOffsets.push_back(mOffsets[RangeIdx]);
+        mVisibleBaseVertices.push_back(mBaseVertices[DrawIdx]);
+    }
+    if (mVisibleCounts.empty()) return;
+
+    DrawCommand Command = {};
+    Command.Program = program;
+    Command.State = state;
+    Command.VAO = mVAO;
+    Command.EBO = mEBO;
+    Command.ModelMatrix = glm::mat4(1.0f);
+    Command.DrawCount = mVisibleCounts.size();
+    Command.MultiCounts = mVisibleCounts.data();
+    Command.MultiOffsets = mVisibleOffsets.data();
+    Command.MultiBaseVertices = mVisibleBaseVertices.data();
+    queue.Submit(RENDER_PASS_OPAQUE, Command, 0.0f);
+}
+
+unsigned
+StaticBatch::GetDiffuseTexture() const {
+    return mDiffuseTexture;
+}
+
+unsigned
+StaticBatch::GetSpecularTexture() const {
+    return mSpecularTexture;
+}
+
+unsigned
+StaticBatch::GetState() const {
+    return mState;
+}
+
+unsigned
+StaticBatch::GetDrawCount() const {
+    return mBounds.size();
+}
+
+unsigned
+StaticBatch::GetTriangleCount() const {
+    return mTriangleCount;
+}
+
+void
+StaticBatchBuilder::Add(const std::vector<float>& vertices, const std::vector<unsigned>& indices, const glm::mat4& transform,
+    unsigned diffuseTexture, unsigned specularTexture, unsigned state) {
+    const std::vector<unsigned>* Lods[] = { &indices };
+    Add(vertices, Lods, 1, transform, diffuseTexture, specularTexture, state, glm::vec4(0.0f), 0.0f, OCCLUSION_NONE);
+}
+
+void
+StaticBatchBuilder::Add(const std::vector<float>& vertices, const std::vector<unsigned>* const* lods, unsigned lodCount, const glm::mat4& transform,
+    unsigned diffuseTexture, unsigned specularTexture, unsigned state, const glm::vec4& lodSphere, float maxDistance, unsigned occlusionSlot) {
+    for (unsigned BatchIdx = 0; BatchIdx < mBatches.size(); ++BatchIdx) {
+        StaticBatch& Batch = mBatches[BatchIdx];
+        if (Batch.GetDiffuseTexture() == diffuseTexture && Batch.GetSpecularTexture() == specularTexture && Batch.GetState() == state) {
+            Batch.AddDraw(vertices, lods, lodCount, transform, lodSphere, maxDistance, occlusionSlot);
+            return;
+        }
+    }
+    mBatches.push_back(StaticBatch(diffuseTexture, specularTexture, state));
+    mBatches.back().AddDraw(vertices, lods, lodCount, transform, lodSphere, maxDistance, occlusionSlot);
+}
+
+void
+StaticBatchBuilder::AddModel(const Model& model, const glm::mat4& transform, unsigned state, unsigned fallbackTexture, float maxDistance,
+    unsigned occlusionSlot) {
+    BoundingSphere Sphere = transformBoundingSphere(model.GetBoundingSphere(), transform);
+    glm::vec4 LodSphere(Sphere.Center, Sphere.Radius);
+
+    const std::vector<Mesh>& Meshes = model.GetMeshes();
+    for (unsigned MeshIdx = 0; MeshIdx < Meshes.size(); ++MeshIdx) {
+        const Mesh& CurrMesh = Meshes[MeshIdx];
+        const std::vector<unsigned>* Lods[LOD_COUNT];
+        for (unsigned Lod = 0; Lod < LOD_COUNT; ++Lod) Lods[Lod] = &CurrMesh.GetLodIndices(Lod);
+
+        unsigned Diffuse = CurrMesh.GetDiffuseTexture() ? CurrMesh.GetDiffuseTexture() : fallbackTexture;
+        Add(CurrMesh.mVertices, Lods, LOD_COUNT, transform, Diffuse, CurrMesh.GetSpecularTexture(), state, LodSphere, maxDistance, occlusionSlot);
+    }
+}
+
+void
+StaticBatchBuilder::Build(std::vector<StaticBatch>& batches) {
+    for (unsigned BatchIdx = 0; BatchIdx < mBatches.size(); ++BatchIdx) {
+        mBatches[BatchIdx].Upload();
+        batches.push_back(mBatches[BatchIdx]);
+    }
+    mBatches.clear();
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "culling.hpp"
+#include "render_queue.hpp"
+#include "model.hpp"
+#include "lod.hpp"
+#include "occlusion.hpp"
+
+// NOTE: Same interleaved layout as Mesh, position, normal, UV
+#define STATIC_BATCH_VERTEX_FLOATS 8
+
+/**
+ * @brief Geometry sharing one material, merged into one vertex and one index
+ * buffer with transforms baked in. Every source mesh stays its own draw so it
+ * can be culled, all visible draws go out in one glMultiDrawElementsBaseVertex
+ */
+class StaticBatch {
+public:
+    StaticBatch(unsigned diffuseTexture, unsigned specularTexture, unsigned state);
+
+    /**
+     * @brief Appends a mesh, moving positions and normals into world space
+     *
+     * @param vertices - Interleaved mesh vertices
+     * @param lods - Triangle indices of each detail level, local to the mesh
+     * @param lodCount - Number of levels, missing ones repeat the last
+     * @param transform - Model matrix to bake in
+     * @param lodSphere - World sphere the level is picked by, meshes of one model share
+     * it so they switch together. Zero radius uses the bounds of the mesh itself
+     * @param maxDistance - Past this distance of the LOD sphere centre from the camera the
+     * draw is skipped, something else (an impostor) stands in for it. 0 draws at any distance
+     * @param occlusionSlot - OcclusionCuller slot of the object the mesh belongs to, or OCCLUSION_NONE
+     *
+     */
+    void AddDraw(const std::vector<float>& vertices, const std::vector<unsigned>* const* lods, unsigned lodCount,
+        const glm::mat4& transform, const glm::vec4& lodSphere, float maxDistance, unsigned occlusionSlot);
+
+    /**
+     * @brief Creates the GL buffers and frees the CPU copy of the geometry
+     *
+     */
+    void Upload();
+
+    /**
+     * @brief Culls the draws, picks a detail level for each visible one and queues
+     * them as one multi-draw
+     *
+     * @param queue - Frame render queue
+     * @param program - Shader to draw with
+     * @param frustum - Camera frustum
+     * @param selector - Frame LOD selector
+     * @param occlusion - Draws whose object was occluded last frame are skipped. A multi-draw
+     * can't be conditional per draw, so only the CPU side result is used
+     *
+     * @returns Number of draws queued, culled, occluded and too distant ones don't count
+     */
+    unsigned Submit(RenderQueue& queue, Shader* program, const Frustum& frustum, const LodSelector& selector, const OcclusionCuller& occlusion);
+
+    /**
+     * @brief Queues every draw at one detail level as one multi-draw, for passes
+     * that don't look from the camera. Shares its arrays with Submit, flush the
+     * queue before the next Submit
+     *
+     * @param queue - Render queue of the pass
+     * @param program - Shader to draw with
+     * @param state - Render queue state id, RENDER_STATE_NONE for none
+     * @param lod - Detail level of every draw
+     *
+     */
+    void SubmitAll(RenderQueue& queue, Shader* program, unsigned state, unsigned lod);
+
+    unsigned GetDiffuseTexture() const;
+    unsigned GetSpecularTexture() const;
+    unsigned GetState() const;
+    unsigned GetDrawCount() const;
+
+    /**
+     * @returns Triangles queued by the last Submit
+     */
+    unsigned GetTriangleCount() const;
+
+private:
+    unsigned mVAO;
+    unsigned mVBO;
+    unsigned mEBO;
+    unsigned mDiffuseTexture;
+    unsigned mSpecularTexture;
+    unsigned mState;
+
+    std::vector<float> mVertices;
+    std::vector<unsigned> mIndices;
+
+    unsigned mTriangleCount;
+
+    // NOTE: Counts and offsets hold LOD_COUNT entries per draw, one for each level
+    std::vector<GLsizei> mCounts;
+    std::vector<void*> mOffsets;
+    std::vector<GLint> mBaseVertices;
+    std::vector<glm::vec4> mBounds;
+    std::vector<glm::vec4> mLodBounds;
+    std::vector<unsigned> mLods;
+    std::vector<float> mMaxDistances;
+    std::vector<unsigned> mOcclusionSlots;
+
+    // NOTE: Rebuilt every frame from the visible draws, the queue reads them at Flush
+    std::vector<unsigned> mVisible;
+    std::vector<GLsizei> mVisibleCounts;
+    std::vector<void*> mVisibleOffsets;
+    std::vector<GLint> mVisibleBaseVertices;
+};
+
+/**
+ * @brief Sorts static meshes into batches by material, textures plus render
+ * queue state
+ */
+class StaticBatchBuilder {
+public:
+    /**
+     * @brief Adds a mesh without detail levels
+     *
+     */
+    void Add(const std::vector<float>& vertices, const std::vector<unsigned>& indices, const glm::mat4& transform,
+        unsigned diffuseTexture, unsigned specularTexture, unsigned state);
+
+    void Add(const std::vector<float>& vertices, const std::vector<unsigned>* const* lods, unsigned lodCount, const glm::mat4& transform,
+        unsigned diffuseTexture, unsigned specularTexture, unsigned state, const glm::vec4& lodSphere, float maxDistance, unsigned occlusionSlot);
+
+    /**
+     * @brief Adds every mesh of a model with all of its detail levels
+     *
+     * @param fallbackTexture - Diffuse texture for meshes without one
+     * @param maxDistance - See StaticBatch::AddDraw
+     * @param occlusionSlot - See StaticBatch::AddDraw
+     *
+     */
+    void AddModel(const Model& model, const glm::mat4& transform, unsigned state, unsigned fallbackTexture = 0, float maxDistance = 0.0f,
+        unsigned occlusionSlot = OCCLUSION_NONE);
+
+    /**
+     * @brief Uploads all batches and hands them over, the builder is empty afterwards
+     *
+     */
+    void Build(std::vector<StaticBatch>& batches);
+
+private:
+    std::vector<StaticBatch> mBatches;
+};
@@ -0,0 +1,170 @@
+#include "terrain.hpp"
+#include "state_cache.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+// NOTE: Lattice cells per side of the coarsest noise octave, each further octave doubles it
+#define TERRAIN_NOISE_CELLS 4
+#define TERRAIN_NOISE_OCTAVES 4
+
+ClipmapTerrain::ClipmapTerrain() {
+    mVAO = 0;
+    mVBO = 0;
+    mEBO = 0;
+    mHeightmap = 0;
+    mBaseHeight = 0.0f;
+    mFullCount = 0;
+    mRingCount = 0;
+    for (unsigned Variant = 0; Variant < 4; ++Variant) mRingFirst[Variant] = 0;
+}
+
+void
+ClipmapTerrain::createHeightmap() {
+    // NOTE: Tiling value noise, every octave's lattice wraps at the map edge so the map repeats seamlessly
+    std::mt19937 Generator(1337);
+    std::uniform_real_distribution<float> Distribution(-1.0f, 1.0f);
+    std::vector<float> Heights(TERRAIN_HEIGHTMAP_SIZE * TERRAIN_HEIGHTMAP_SIZE, 0.0f);
+    float Amplitude = 0.5f;
+    float TotalAmplitude = 0.0f;
+    for (unsigned Octave = 0; Octave < TERRAIN_NOISE_OCTAVES; ++Octave) {
+        int Cells = TERRAIN_NOISE_CELLS << Octave;
+        std::vector<float> Lattice(Cells * Cells);
+        for (unsigned Idx = 0; Idx < Lattice.size(); ++Idx) Lattice[Idx] = Distribution(Generator);
+
+        float TexelsPerCell = (float)TERRAIN_HEIGHTMAP_SIZE / Cells;
+        for (int Y = 0; Y < TERRAIN_HEIGHTMAP_SIZE; ++Y) {
+            for (int X = 0; X < TERRAIN_HEIGHTMAP_SIZE; ++X) {
+                float CellX = X / TexelsPerCell;
+                float CellY = Y / TexelsPerCell;
+                int X0 = (int)CellX;
+                int Y0 = (int)CellY;
+                int X1 = (X0 + 1) % Cells;
+                int Y1 = (Y0 + 1) % Cells;
+                float TX = CellX - X0;
+                float TY = CellY - Y0;
+                TX = TX * TX * (3.0f - 2.0f * TX);
+                TY = TY * TY * (3.0f - 2.0f * TY);
+                float Bottom = Lattice[Y0 * Cells + X0] + (Lattice[Y0 * Cells + X1] - Lattice[Y0 * Cells + X0]) * TX;
+                float Top = Lattice[Y1 * Cells + X0] + (Lattice[Y1 * Cells + X1] - Lattice[Y1 * Cells + X0]) * TX;
+                Heights[Y * TERRAIN_HEIGHTMAP_SIZE + X] += Amplitude * (Bottom + (Top - Bottom) * TY);
+            }
+        }
+        TotalAmplitude += Amplitude;
+        Amplitude *= 0.5f;
+    }
+    for (unsigned Idx = 0; Idx < Heights.size(); ++Idx) Heights[Idx] /= TotalAmplitude;
+
+    glGenTextures(1, &mHeightmap);
+    GLState.BindTexture(TERRAIN_HEIGHTMAP_UNIT, GL_TEXTURE_2D, mHeightmap);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, TERRAIN_HEIGHTMAP_SIZE, TERRAIN_HEIGHTMAP_SIZE, 0, GL_RED, GL_FLOAT, Heights.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+void
+ClipmapTerrain::Init(float baseHeight) {
+    mBaseHeight = baseHeight;
+    int VerticesPerSide = TERRAIN_GRID + 1;
+    std::vector<float> Vertices;
+    Vertices.reserve(VerticesPerSide * VerticesPerSide * 2);
+    for (int Z = 0; Z < VerticesPerSide; ++Z) {
+        for (int X = 0; X < VerticesPerSide; ++X) {
+            Vertices.push_back((float)X);
+            Vertices.push_back((float)Z);
+        }
+    }
+
+    // NOTE: Full grid for the finest level, then the four rings with the hole shifted by 0 or 1 quad on each axis
+    std::vector<unsigned> Indices;
+    for (int Variant = -1; Variant < 4; ++Variant) {
+        if (Variant >= 0) mRingFirst[Variant] = Indices.size();
+        int HoleX = TERRAIN_GRID / 4 + (Variant & 1);
+        int HoleZ = TERRAIN_GRID / 4 + (Variant >> 1 & 1);
+        for (int Z = 0; Z < TERRAIN_GRID; ++Z) {
+            for (int X = 0; X < TERRAIN_GRID; ++X) {
+                bool InHole = X >= HoleX && X < HoleX + TERRAIN_GRID / 2 && Z >= HoleZ && Z < HoleZ + TERRAIN_GRID / 2;
+                if (Variant >= 0 && InHole) continue;
+                unsigned LD = Z * VerticesPerSide + X;
+                unsigned RD = LD + 1;
+                unsigned LU = LD + VerticesPerSide;
+                unsigned RU = LU + 1;
+                // NOTE: Counter-clockwise seen from above
+                unsigned Quad[] = { LD, LU, RD, RD, LU, RU };
+                Indices.insert(Indices.end(), Quad, Quad + 6);
+            }
+        }
+        if (Variant < 0) mFullCount = Indices.size();
+        else mRingCount = Indices.size() - mRingFirst[Variant];
+    }
+
+    glGenVertexArrays(1, &mVAO);
+    GLState.BindVertexArray(mVAO);
+    glGenBuffers(1, &mVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &mEBO);
+    GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned), Indices.data(), GL_STATIC_DRAW);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+
+    createHeightmap();
+}
+
+void
+ClipmapTerrain::SetupShader(Shader& shader) const {
+    GLState.UseProgram(shader.GetId());
+    shader.SetUniform1i("uBeach", TERRAIN_BEACH_UNIT);
+    shader.SetUniform1i("uHeightmap", TERRAIN_HEIGHTMAP_UNIT);
+    shader.SetUniform1f("uTerrainGrid", (float)TERRAIN_GRID);
+    shader.SetUniform1f("uHeightmapWorldSize", TERRAIN_HEIGHTMAP_WORLD_SIZE);
+    shader.SetUniform1f("uTerrainBaseHeight", mBaseHeight);
+    shader.SetUniform1f("uTerrainAmplitude", TERRAIN_AMPLITUDE);
+    shader.SetUniform1f("uTerrainFlatRadius", TERRAIN_FLAT_RADIUS);
+    shader.SetUniform1f("uTerrainRampWidth", TERRAIN_RAMP_WIDTH);
+    shader.SetUniform1f("uTerrainTextureScale", TERRAIN_TEXTURE_SCALE);
+}
+
+void
+ClipmapTerrain::Submit(RenderQueue& queue, Shader* program, unsigned state, const glm::vec3& viewPosition, const Frustum& frustum, unsigned sandTexture, unsigned beachTexture) const {
+    if (!mVAO) return;
+    GLState.BindTexture(TERRAIN_BEACH_UNIT, GL_TEXTURE_2D, beachTexture);
+    GLState.BindTexture(TERRAIN_HEIGHTMAP_UNIT, GL_TEXTURE_2D, mHeightmap);
+
+    glm::vec2 View(viewPosition.x, viewPosition.z);
+    glm::vec2 FinerOrigin(0.0f);
+    for (unsigned Level = 0; Level < TERRAIN_LEVELS; ++Level) {
+        // NOTE: Snapping to twice the spacing keeps this level's vertices on the next coarser level's grid
+        float Spacing = TERRAIN_SPACING * (float)(1 << Level);
+        glm::vec2 Origin = glm::floor(View / (2.0f * Spacing)) * (2.0f * Spacing) - glm::vec2(0.5f * TERRAIN_GRID * Spacing);
+        unsigned Variant = 0;
+        if (Level > 0) {
+            glm::vec2 HoleOffset = (FinerOrigin - Origin) / Spacing - glm::vec2(0.25f * TERRAIN_GRID);
+            Variant = (unsigned)(HoleOffset.x + 0.5f) + 2 * (unsigned)(HoleOffset.y + 0.5f);
+        }
+        FinerOrigin = Origin;
+
+        float HalfSize = 0.5f * TERRAIN_GRID * Spacing;
+        glm::vec3 Center(Origin.x + HalfSize, 0.0f, Origin.y + HalfSize);
+        if (!frustum.TestSphere(Center, std::sqrt(2.0f * HalfSize * HalfSize + TERRAIN_AMPLITUDE * TERRAIN_AMPLITUDE))) continue;
+
+        DrawCommand Command = {};
+        Command.Program = program;
+        Command.State = state;
+        Command.VAO = mVAO;
+        Command.EBO = mEBO;
+        Command.Count = Level ? mRingCount : mFullCount;
+        Command.FirstIndex = Level ? mRingFirst[Variant] : 0;
+        Command.DiffuseTexture = sandTexture;
+        Command.SpecularTexture = sandTexture;
+        Command.ModelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(Origin.x, 0.0f, Origin.y)), glm::vec3(Spacing, 1.0f, Spacing));
+        // NOTE: Finer levels surround the camera, drawing them first lets them occlude the coarse ones
+        queue.Submit(RENDER_PASS_OPAQUE, Command, HalfSize);
+    }
+}
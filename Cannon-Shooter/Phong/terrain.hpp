@@ -0,0 +1,81 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "culling.hpp"
+#include "render_queue.hpp"
+#include "shader.hpp"
+
+// NOTE: Quads per side of every level, a multiple of 4 so the finer level's hole lines up with whole quads
+#define TERRAIN_GRID 64
+#define TERRAIN_LEVELS 6
+// NOTE: Quad size of the finest level, each coarser level doubles it
+#define TERRAIN_SPACING 1.0f
+#define TERRAIN_HEIGHTMAP_SIZE 256
+// NOTE: World units covered by one repeat of the heightmap
+#define TERRAIN_HEIGHTMAP_WORLD_SIZE 512.0f
+#define TERRAIN_AMPLITUDE 5.0f
+// NOTE: The playing field stays flat so it matches the physics ground plane, dunes rise past it
+#define TERRAIN_FLAT_RADIUS 120.0f
+#define TERRAIN_RAMP_WIDTH 80.0f
+// NOTE: World units per repeat of the sand and beach textures
+#define TERRAIN_TEXTURE_SCALE 15.0f
+// NOTE: Units past the material maps, clustered lights and shadows
+#define TERRAIN_BEACH_UNIT 7
+#define TERRAIN_HEIGHTMAP_UNIT 8
+
+/**
+ * @brief Geometry clipmap ground. TERRAIN_LEVELS nested square grids of the
+ * same vertex count are centred on the camera, each twice as coarse as the one
+ * inside it, so the ground reaches any distance at a constant vertex budget.
+ * Levels share one vertex grid, the vertex shader scales it, snaps it to the
+ * level's spacing and displaces it with a tiling heightmap. Every level but the
+ * finest leaves a hole for the one inside it, the hole can sit one quad off
+ * centre on each axis, so there are four ring variants in the index buffer
+ */
+class ClipmapTerrain {
+public:
+    ClipmapTerrain();
+
+    /**
+     * @brief Creates the shared grid, its index ranges and the heightmap
+     *
+     * @param baseHeight - Height of the flat playing field
+     *
+     */
+    void Init(float baseHeight);
+
+    /**
+     * @brief Sets the sampler units and terrain constants of a terrain program
+     *
+     * @param shader - shaders/terrain.vert with phong_material_texture.frag compiled with TERRAIN
+     *
+     */
+    void SetupShader(Shader& shader) const;
+
+    /**
+     * @brief Queues the levels around the camera that are in the frustum
+     *
+     * @param queue - Frame render queue
+     * @param program - Terrain program set up with SetupShader
+     * @param state - Render queue state id, sets the lights
+     * @param viewPosition - Camera position, levels are centred on it
+     * @param frustum - View frustum
+     * @param sandTexture - Texture on high ground and for the specular map
+     * @param beachTexture - Texture blended in on low ground
+     *
+     */
+    void Submit(RenderQueue& queue, Shader* program, unsigned state, const glm::vec3& viewPosition, const Frustum& frustum, unsigned sandTexture, unsigned beachTexture) const;
+
+private:
+    unsigned mVAO;
+    unsigned mVBO;
+    unsigned mEBO;
+    unsigned mHeightmap;
+    float mBaseHeight;
+    unsigned mFullCount;
+    unsigned mRingFirst[4];
+    unsigned mRingCount;
+
+    void createHeightmap();
+};
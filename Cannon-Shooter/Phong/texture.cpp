@@ -1,6 +1,10 @@
 #include "texture.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include <algorithm>
+
+// NOTE: Every loaded 2D texture with the index of its smallest mip level, for SetBaseLevel
+static std::vector<std::pair<unsigned, unsigned>> LoadedTextures;
 
 unsigned
 Texture::LoadImageToTexture(const std::string& filePath) {
@@ -29,25 +33,43 @@ Texture::LoadImageToTexture(const std::string& filePath) {
 
     unsigned Texture;
     glGenTextures(1, &Texture);
-    glBindTexture(GL_TEXTURE_2D, Texture);
+    GLState.BindTexture(GL_TEXTURE_2D, Texture);
     glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, TextureWidth, TextureHeight, 0, InternalFormat, GL_UNSIGNED_BYTE, ImageData);
     glGenerateMipmap(GL_TEXTURE_2D);
+    unsigned MaxLevel = 0;
+    for (int Size = std::max(TextureWidth, TextureHeight); Size > 1; Size /= 2) MaxLevel++;
+    LoadedTextures.push_back(std::make_pair(Texture, MaxLevel));
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState.BindTexture(GL_TEXTURE_2D, 0);
     // NOTE(Jovan): ImageData is no longer necessary in RAM and can be deallocated
     stbi_image_free(ImageData);
     return Texture;
 }
 
+unsigned
+Texture::CreateSolidTexture(unsigned char r, unsigned char g, unsigned char b) {
+    unsigned char Pixel[3] = { r, g, b };
+    unsigned Texture;
+    glGenTextures(1, &Texture);
+    GLState.BindTexture(GL_TEXTURE_2D, Texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, Pixel);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GLState.BindTexture(GL_TEXTURE_2D, 0);
+    return Texture;
+}
+
 unsigned 
 Texture::LoadCubemap(std::vector<std::string> faces) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLState.BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrComponents;
     for (unsigned int i = 0; i < faces.size(); i++)
@@ -72,3 +94,12 @@ Texture::LoadCubemap(std::vector<std::string> faces) {
 
     return textureID;
 }
+
+void
+Texture::SetBaseLevel(unsigned level) {
+    for (unsigned Idx = 0; Idx < LoadedTextures.size(); ++Idx) {
+        GLState.BindTexture(GL_TEXTURE_2D, LoadedTextures[Idx].first);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, std::min(level, LoadedTextures[Idx].second));
+    }
+    GLState.BindTexture(GL_TEXTURE_2D, 0);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <GL/glew.h>
+#include "state_cache.hpp"
 #include <iostream>
 #include <vector>
 
@@ -19,4 +20,21 @@ public:
 	 */
 	static unsigned LoadImageToTexture(const std::string& filePath);
 	static unsigned LoadCubemap(std::vector<std::string> filePaths);
+
+	/**
+	 * @brief Creates a 1x1 texture of a single color, for materials without a map
+	 * (e.g. a flat specular map)
+	 *
+	 * @returns TextureID
+	 */
+	static unsigned CreateSolidTexture(unsigned char r, unsigned char g, unsigned char b);
+
+	/**
+	 * @brief Skips the top mip levels of every texture loaded with
+	 * LoadImageToTexture, so sampling reads smaller images. Clamped to each
+	 * texture's smallest level
+	 *
+	 * @param level Number of levels to skip, 0 samples the full image
+	 */
+	static void SetBaseLevel(unsigned level);
 };
@@ -0,0 +1,153 @@
+#include "trails.hpp"
+#include "state_cache.hpp"
+
+TrailRenderer::TrailRenderer() {
+    mShader = 0;
+    mVAO = 0;
+    mVBO = 0;
+    mEBO = 0;
+    mFrame = 1;
+    mTrailCount = 0;
+    for (unsigned Slot = 0; Slot < TRAIL_MAX; ++Slot) {
+        mOwners[Slot] = 0;
+        mTrackedFrames[Slot] = 0;
+        mHeads[Slot] = 0;
+        mCounts[Slot] = 0;
+    }
+}
+
+void
+TrailRenderer::Init(Shader* shader) {
+    mShader = shader;
+    mVertices.resize(TRAIL_MAX * TRAIL_LENGTH * 2 * TRAIL_VERTEX_FLOATS);
+
+    // NOTE: Trail t owns vertices [t * TRAIL_LENGTH * 2, (t + 1) * TRAIL_LENGTH * 2), two per position
+    std::vector<unsigned> Indices;
+    Indices.reserve(TRAIL_MAX * (TRAIL_LENGTH - 1) * 6);
+    for (unsigned Trail = 0; Trail < TRAIL_MAX; ++Trail) {
+        unsigned Base = Trail * TRAIL_LENGTH * 2;
+        for (unsigned Point = 0; Point + 1 < TRAIL_LENGTH; ++Point) {
+            unsigned Left = Base + Point * 2;
+            unsigned Quad[] = { Left, Left + 1, Left + 2, Left + 2, Left + 1, Left + 3 };
+            Indices.insert(Indices.end(), Quad, Quad + 6);
+        }
+    }
+
+    glGenVertexArrays(1, &mVAO);
+    GLState.BindVertexArray(mVAO);
+    glGenBuffers(1, &mVBO);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(float), NULL, GL_STREAM_DRAW);
+    GLsizei Stride = TRAIL_VERTEX_FLOATS * sizeof(float);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Stride, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, Stride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, Stride, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glGenBuffers(1, &mEBO);
+    GLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned), Indices.data(), GL_STATIC_DRAW);
+    GLState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.BindVertexArray(0);
+}
+
+void
+TrailRenderer::Begin() {
+    mFrame++;
+}
+
+int
+TrailRenderer::findSlot(const void* owner) const {
+    for (unsigned Slot = 0; Slot < TRAIL_MAX; ++Slot) {
+        if (mOwners[Slot] == owner && mTrackedFrames[Slot] + 1 >= mFrame) return Slot;
+    }
+    return -1;
+}
+
+void
+TrailRenderer::Track(const void* owner, const glm::vec3& position) {
+    int Slot = findSlot(owner);
+    if (Slot < 0) {
+        // NOTE: A slot not tracked last frame lost its owner, it can be reused
+        for (unsigned Free = 0; Free < TRAIL_MAX; ++Free) {
+            if (mTrackedFrames[Free] + 1 < mFrame) {
+                Slot = Free;
+                break;
+            }
+        }
+        if (Slot < 0) return;
+        mOwners[Slot] = owner;
+        mHeads[Slot] = 0;
+        mCounts[Slot] = 1;
+        mPositions[Slot * TRAIL_LENGTH] = position;
+    }
+    mTrackedFrames[Slot] = mFrame;
+
+    glm::vec3* Ring = mPositions + Slot * TRAIL_LENGTH;
+    if (glm::length(position - Ring[mHeads[Slot]]) < TRAIL_MIN_SPACING) return;
+    mHeads[Slot] = (mHeads[Slot] + 1) % TRAIL_LENGTH;
+    Ring[mHeads[Slot]] = position;
+    if (mCounts[Slot] < TRAIL_LENGTH) mCounts[Slot]++;
+}
+
+void
+TrailRenderer::Render(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition) {
+    mTrailCount = 0;
+    if (!mShader) return;
+
+    float* Vertex = mVertices.data();
+    for (unsigned Slot = 0; Slot < TRAIL_MAX; ++Slot) {
+        if (mTrackedFrames[Slot] != mFrame || mCounts[Slot] < 2) continue;
+
+        // NOTE: Walks from the newest position back, age runs from 0 at the ball to 1 at the tail
+        const glm::vec3* Ring = mPositions + Slot * TRAIL_LENGTH;
+        unsigned Count = mCounts[Slot];
+        for (unsigned Point = 0; Point < TRAIL_LENGTH; ++Point) {
+            unsigned Clamped = Point < Count ? Point : Count - 1;
+            unsigned Newer = Clamped > 0 ? Clamped - 1 : 0;
+            unsigned Older = Clamped + 1 < Count ? Clamped + 1 : Count - 1;
+            const glm::vec3& Position = Ring[(mHeads[Slot] + TRAIL_LENGTH - Clamped) % TRAIL_LENGTH];
+            glm::vec3 Tangent = Ring[(mHeads[Slot] + TRAIL_LENGTH - Newer) % TRAIL_LENGTH] - Ring[(mHeads[Slot] + TRAIL_LENGTH - Older) % TRAIL_LENGTH];
+            float Age = (float)Clamped / (TRAIL_LENGTH - 1);
+            for (int Side = -1; Side <= 1; Side += 2) {
+                Vertex[0] = Position.x;
+                Vertex[1] = Position.y;
+                Vertex[2] = Position.z;
+                Vertex[3] = Tangent.x;
+                Vertex[4] = Tangent.y;
+                Vertex[5] = Tangent.z;
+                Vertex[6] = (float)Side;
+                Vertex[7] = Age;
+                Vertex += TRAIL_VERTEX_FLOATS;
+            }
+        }
+        mTrailCount++;
+    }
+    if (!mTrailCount) return;
+
+    // NOTE: Orphan then fill, the driver hands out new storage instead of waiting for last frame's draw
+    GLState.BindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (Vertex - mVertices.data()) * sizeof(float), mVertices.data());
+
+    GLState.UseProgram(mShader->GetId());
+    mShader->SetProjection(projection);
+    mShader->SetView(view);
+    mShader->SetUniform3f("uViewPos", viewPosition);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+    GLState.BindVertexArray(mVAO);
+    glDrawElements(GL_TRIANGLES, mTrailCount * (TRAIL_LENGTH - 1) * 6, GL_UNSIGNED_INT, (void*)0);
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+unsigned
+TrailRenderer::GetTrailCount() const {
+    return mTrailCount;
+}
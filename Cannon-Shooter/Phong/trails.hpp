@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+#define TRAIL_MAX 128
+// NOTE: Positions kept per trail, every trail is drawn with all of them so the
+// index buffer never changes, unfilled ones repeat the oldest and collapse
+#define TRAIL_LENGTH 24
+// NOTE: A new position is only kept after the ball moved this far
+#define TRAIL_MIN_SPACING 0.25f
+// NOTE: Position, tangent, side and age
+#define TRAIL_VERTEX_FLOATS 8
+
+/**
+ * @brief Ribbon trails behind moving objects. Every tracked object owns a slot
+ * with a ring of its last TRAIL_LENGTH positions. Each frame all live trails
+ * are written into one orphaned vertex buffer and drawn in a single call, the
+ * vertex shader turns each ribbon to face the camera. Storage is fixed at
+ * Init, tracking and drawing don't allocate
+ */
+class TrailRenderer {
+public:
+    TrailRenderer();
+
+    /**
+     * @brief Creates the buffers and the index buffer shared by every trail
+     *
+     * @param shader - shaders/trail program
+     *
+     */
+    void Init(Shader* shader);
+
+    /**
+     * @brief Starts a frame, trails not tracked during it are released
+     *
+     */
+    void Begin();
+
+    /**
+     * @brief Records where an object is this frame, giving it a slot if it has
+     * none. Ignored once all TRAIL_MAX slots are taken
+     *
+     * @param owner - Identifies the object between frames
+     * @param position - World position
+     *
+     */
+    void Track(const void* owner, const glm::vec3& position);
+
+    /**
+     * @brief Uploads the live trails and draws them blended, without depth writes
+     *
+     */
+    void Render(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition);
+
+    unsigned GetTrailCount() const;
+
+private:
+    Shader* mShader;
+    unsigned mVAO;
+    unsigned mVBO;
+    unsigned mEBO;
+    unsigned mFrame;
+    unsigned mTrailCount;
+    const void* mOwners[TRAIL_MAX];
+    unsigned mTrackedFrames[TRAIL_MAX];
+    // NOTE: Index of the newest position and number of valid ones in each ring
+    unsigned mHeads[TRAIL_MAX];
+    unsigned mCounts[TRAIL_MAX];
+    glm::vec3 mPositions[TRAIL_MAX * TRAIL_LENGTH];
+    std::vector<float> mVertices;
+
+    int findSlot(const void* owner) const;
+};
@@ -0,0 +1,120 @@
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+#include <glm/glm.hpp>
+#include "wind.hpp"
+#include <algorithm>
+#include <cmath>
+
+glm::vec3 evaluateWindSources(const glm::vec3& position, const glm::vec3& baseWind, const std::vector<WindSource>& sources) {
+    glm::vec3 wind = baseWind;
+    for (const WindSource& source : sources) {
+        glm::vec3 offset = position - source.Position;
+        float distance = glm::length(offset);
+        if (distance >= source.Radius) continue;
+
+        float falloff = 1.0f - distance / source.Radius;
+        falloff *= falloff;
+        wind += source.Velocity * falloff;
+
+        if (source.Swirl != 0.0f) {
+            glm::vec3 tangent = glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(offset.x, 0.0f, offset.z));
+            wind += tangent * source.Swirl * falloff;
+        }
+    }
+    return wind;
+}
+
+WindField::WindField() {
+    mOrigin = glm::vec3(0.0f);
+    mInvCellSize = 1.0f;
+    mNX = 0;
+    mNY = 0;
+    mNZ = 0;
+    mPeriod = 0.0f;
+    mBlend = 0.0f;
+}
+
+void
+WindField::Init(const glm::vec3& origin, float cellSize, int nx, int ny, int nz) {
+    // NOTE: Trilinear lookup needs at least two points along every axis
+    mOrigin = origin;
+    mInvCellSize = 1.0f / cellSize;
+    mNX = std::max(nx, 2);
+    mNY = std::max(ny, 2);
+    mNZ = std::max(nz, 2);
+    mKeyframes[0].assign(mNX * mNY * mNZ, glm::vec3(0.0f));
+    mKeyframes[1].assign(mNX * mNY * mNZ, glm::vec3(0.0f));
+}
+
+void
+WindField::Bake(int keyframe, const glm::vec3& baseWind, const std::vector<WindSource>& sources) {
+    std::vector<glm::vec3>& grid = mKeyframes[keyframe];
+    float cellSize = 1.0f / mInvCellSize;
+    for (int k = 0; k < mNZ; ++k) {
+        for (int j = 0; j < mNY; ++j) {
+            for (int i = 0; i < mNX; ++i) {
+                glm::vec3 position = mOrigin + glm::vec3(i * cellSize, j * cellSize, k * cellSize);
+                grid[index(i, j, k)] = evaluateWindSources(position, baseWind, sources);
+            }
+        }
+    }
+}
+
+void
+WindField::SetPeriod(float period) {
+    mPeriod = period;
+}
+
+void
+WindField::SetTime(float time) {
+    if (mPeriod <= 0.0f) {
+        mBlend = 0.0f;
+        return;
+    }
+    mBlend = 0.5f - 0.5f * std::cos(time * 2.0f * 3.14159265f / mPeriod);
+}
+
+bool
+WindField::IsEmpty() const {
+    return mKeyframes[0].empty();
+}
+
+int
+WindField::index(int i, int j, int k) const {
+    return (k * mNY + j) * mNX + i;
+}
+
+glm::vec3
+WindField::sampleKeyframe(const std::vector<glm::vec3>& grid, int i, int j, int k, const glm::vec3& t) const {
+    const glm::vec3* c = &grid[index(i, j, k)];
+    int dy = mNX;
+    int dz = mNX * mNY;
+
+    glm::vec3 c00 = glm::mix(c[0], c[1], t.x);
+    glm::vec3 c10 = glm::mix(c[dy], c[dy + 1], t.x);
+    glm::vec3 c01 = glm::mix(c[dz], c[dz + 1], t.x);
+    glm::vec3 c11 = glm::mix(c[dz + dy], c[dz + dy + 1], t.x);
+
+    glm::vec3 c0 = glm::mix(c00, c10, t.y);
+    glm::vec3 c1 = glm::mix(c01, c11, t.y);
+    return glm::mix(c0, c1, t.z);
+}
+
+glm::vec3
+WindField::Sample(const glm::vec3& position) const {
+    if (IsEmpty()) return glm::vec3(0.0f);
+
+    glm::vec3 local = (position - mOrigin) * mInvCellSize;
+    local.x = std::min(std::max(local.x, 0.0f), float(mNX - 1));
+    local.y = std::min(std::max(local.y, 0.0f), float(mNY - 1));
+    local.z = std::min(std::max(local.z, 0.0f), float(mNZ - 1));
+
+    int i = std::min(int(local.x), mNX - 2);
+    int j = std::min(int(local.y), mNY - 2);
+    int k = std::min(int(local.z), mNZ - 2);
+    glm::vec3 t = local - glm::vec3(float(i), float(j), float(k));
+
+    glm::vec3 wind = sampleKeyframe(mKeyframes[0], i, j, k, t);
+    if (mBlend <= 0.0f) return wind;
+    return glm::mix(wind, sampleKeyframe(mKeyframes[1], i, j, k, t), mBlend);
+}
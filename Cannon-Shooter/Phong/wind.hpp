@@ -0,0 +1,81 @@
+#include <glm/ext/vector_float3.hpp>
+#include <vector>
+#ifndef WIND_HPP
+#define WIND_HPP
+
+struct WindSource {
+    glm::vec3 Position;
+    glm::vec3 Velocity;
+    float Radius;
+    // NOTE: Angular speed around the vertical axis through Position, 0 for a plain gust
+    float Swirl;
+};
+
+/**
+ * @brief Wind velocity field baked into a regular 3D grid.
+ * Sources are only touched while baking, sampling is a trilinear lookup
+ * into two keyframes blended over time, so the per-body cost does not
+ * depend on how many sources the field was built from.
+ */
+class WindField {
+public:
+    WindField();
+
+    /**
+     * @brief Allocates the grid
+     *
+     * @param origin World position of the grid's minimum corner
+     * @param cellSize Distance between neighbouring grid points
+     * @param nx Grid points along x
+     * @param ny Grid points along y
+     * @param nz Grid points along z
+     */
+    void Init(const glm::vec3& origin, float cellSize, int nx, int ny, int nz);
+
+    /**
+     * @brief Evaluates all sources at every grid point of a keyframe
+     *
+     * @param keyframe 0 or 1
+     * @param baseWind Wind present everywhere in the field
+     * @param sources Localized gusts and swirls
+     */
+    void Bake(int keyframe, const glm::vec3& baseWind, const std::vector<WindSource>& sources);
+
+    /**
+     * @brief Sets the keyframe blend from time, ping-ponging between the
+     * two keyframes once every period. A period of 0 disables animation.
+     *
+     * @param time Time in seconds
+     */
+    void SetTime(float time);
+    void SetPeriod(float period);
+
+    /**
+     * @brief Returns wind velocity at a world position. Positions outside of
+     * the grid are clamped to its border
+     *
+     * @param position World position
+     *
+     * @returns Wind velocity
+     */
+    glm::vec3 Sample(const glm::vec3& position) const;
+
+    bool IsEmpty() const;
+
+private:
+    glm::vec3 mOrigin;
+    float mInvCellSize;
+    int mNX;
+    int mNY;
+    int mNZ;
+    float mPeriod;
+    float mBlend;
+    std::vector<glm::vec3> mKeyframes[2];
+
+    glm::vec3 sampleKeyframe(const std::vector<glm::vec3>& grid, int i, int j, int k, const glm::vec3& t) const;
+    int index(int i, int j, int k) const;
+};
+
+glm::vec3 evaluateWindSources(const glm::vec3& position, const glm::vec3& baseWind, const std::vector<WindSource>& sources);
+
+#endif
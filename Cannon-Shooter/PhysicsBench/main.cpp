@@ -0,0 +1,287 @@
+#include <glm/glm.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "collision.hpp"
+#include "physics.hpp"
+#include "snapshot.hpp"
+#include "wind.hpp"
+#include "scene_generator.hpp"
+using namespace std;
+
+// NOTE: Game palm layout is 12 inner palms and two rings of 16 and 23
+const int DefaultPalmCount = 51;
+const float DefaultStep = 1.0f / 60.0f;
+const int DefaultRockCount = 8;
+// NOTE: Analytic sphere - box contacts are exact, EPA over the same pair has to land this close
+const float EpaDepthTolerance = 0.01f;
+const float EpaNormalTolerance = 0.99f;
+
+struct BenchOptions {
+    vector<BenchScene> Scenes;
+    vector<int> Counts;
+    int PalmCount;
+    int RockCount;
+    int MaxSteps;
+    int WarmupSteps;
+    float TimeBudget;
+    float Step;
+    bool UseWind;
+    bool CheckEpa;
+    unsigned Seed;
+    string LoadPath;
+    string SavePath;
+};
+
+struct BenchResult {
+    int Steps;
+    double UpdateSeconds;
+    double ConstraintSeconds;
+};
+
+typedef chrono::steady_clock Clock;
+
+static double
+SecondsSince(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void
+PrintUsage() {
+    cout << "Usage: PhysicsBench [options]" << endl
+        << "  --scene pile|rain|scatter|all   Scene layout (default all)" << endl
+        << "  --counts 1000,10000,100000      Sphere counts to run" << endl
+        << "  --palms N                       Palm trunk count (default " << DefaultPalmCount << ")" << endl
+        << "  --rocks N                       Rock hull count (default " << DefaultRockCount << ")" << endl
+        << "  --steps N                       Maximum measured steps per run (default 60)" << endl
+        << "  --budget SECONDS                Stop measuring a run after this long (default 2)" << endl
+        << "  --warmup N                      Steps simulated before measuring (default 0)" << endl
+        << "  --dt SECONDS                    Step length (default 1/60)" << endl
+        << "  --wind                          Sample a baked wind field in updateSphere" << endl
+        << "  --seed N                        Scene generator seed" << endl
+        << "  --save PATH                     Save the warmed up world of the last run" << endl
+        << "  --load PATH                     Measure a saved world instead of generating scenes" << endl
+        << "  --check-epa                     Compare GJK/EPA against the analytic sphere - box contact and exit" << endl;
+}
+
+static bool
+ParseCounts(const string& text, vector<int>& counts) {
+    counts.clear();
+    stringstream Stream(text);
+    string Item;
+    while (getline(Stream, Item, ',')) {
+        int Count = atoi(Item.c_str());
+        if (Count <= 0) return false;
+        counts.push_back(Count);
+    }
+    return !counts.empty();
+}
+
+static bool
+ParseOptions(int argc, char** argv, BenchOptions& options) {
+    options.Scenes = { SCENE_PACKED_PILE, SCENE_BALL_RAIN, SCENE_RANDOM_SCATTER };
+    options.Counts = { 1000, 10000, 100000 };
+    options.PalmCount = DefaultPalmCount;
+    options.RockCount = DefaultRockCount;
+    options.MaxSteps = 60;
+    options.WarmupSteps = 0;
+    options.TimeBudget = 2.0f;
+    options.Step = DefaultStep;
+    options.UseWind = false;
+    options.CheckEpa = false;
+    options.Seed = 1234;
+
+    for (int i = 1; i < argc; ++i) {
+        string Arg = argv[i];
+        bool HasValue = i + 1 < argc;
+        if (Arg == "--wind") {
+            options.UseWind = true;
+        }
+        else if (Arg == "--check-epa") {
+            options.CheckEpa = true;
+        }
+        else if (Arg == "--scene" && HasValue) {
+            string Name = argv[++i];
+            BenchScene Scene;
+            if (Name == "all") continue;
+            if (!parseSceneName(Name, Scene)) return false;
+            options.Scenes = { Scene };
+        }
+        else if (Arg == "--counts" && HasValue) {
+            if (!ParseCounts(argv[++i], options.Counts)) return false;
+        }
+        else if (Arg == "--palms" && HasValue) options.PalmCount = atoi(argv[++i]);
+        else if (Arg == "--rocks" && HasValue) options.RockCount = max(0, atoi(argv[++i]));
+        else if (Arg == "--steps" && HasValue) options.MaxSteps = max(1, atoi(argv[++i]));
+        else if (Arg == "--warmup" && HasValue) options.WarmupSteps = max(0, atoi(argv[++i]));
+        else if (Arg == "--budget" && HasValue) options.TimeBudget = (float)atof(argv[++i]);
+        else if (Arg == "--dt" && HasValue) options.Step = (float)atof(argv[++i]);
+        else if (Arg == "--seed" && HasValue) options.Seed = (unsigned)atoi(argv[++i]);
+        else if (Arg == "--save" && HasValue) options.SavePath = argv[++i];
+        else if (Arg == "--load" && HasValue) options.LoadPath = argv[++i];
+        else return false;
+    }
+    return true;
+}
+
+static void
+SetupBenchWind(WindField& wind) {
+    wind.Init(glm::vec3(-120.0f, 0.0f, -120.0f), 8.0f, 31, 11, 31);
+    vector<WindSource> Sources;
+    for (int i = 0; i < 16; ++i) {
+        float Angle = i * 0.3927f;
+        glm::vec3 Position(cos(Angle) * 60.0f, 10.0f, sin(Angle) * 60.0f);
+        Sources.push_back(WindSource{ Position, glm::vec3(-sin(Angle), 0.2f, cos(Angle)) * 3.0f, 30.0f, 0.05f });
+    }
+    wind.Bake(0, glm::vec3(1.5f, 0.0f, 0.5f), Sources);
+}
+
+/**
+ * @brief Runs the generic GJK/EPA narrowphase on sphere - box pairs and compares it
+ * with the analytic test, face, edge and center inside contacts on straight and turned boxes
+ *
+ * @returns true if every pair matched within tolerance
+ */
+static bool
+CheckEpaAgainstAnalytic() {
+    glm::mat3 Turned(glm::vec3(cos(0.5f), 0.0f, -sin(0.5f)), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(sin(0.5f), 0.0f, cos(0.5f)));
+    Box Boxes[] = {
+        { glm::vec3(0.0f), glm::vec3(1.0f, 0.5f, 2.0f), glm::mat3(1.0f) },
+        { glm::vec3(3.0f, 1.0f, -2.0f), glm::vec3(1.0f, 0.5f, 2.0f), Turned },
+    };
+    // NOTE: Sphere centers in box space, the last one is separated and must miss in both tests
+    glm::vec3 Offsets[] = {
+        glm::vec3(1.2f, 0.1f, 0.3f),
+        glm::vec3(0.2f, -0.7f, 0.5f),
+        glm::vec3(0.3f, 0.1f, -2.25f),
+        glm::vec3(1.2f, 0.6f, 0.0f),
+        glm::vec3(0.8f, 0.0f, 0.5f),
+        glm::vec3(1.6f, 0.0f, 0.0f),
+    };
+
+    bool Passed = true;
+    for (const Box& TestBox : Boxes) {
+        for (const glm::vec3& Offset : Offsets) {
+            Sphere TestSphere = { 1.0f, 0.4f, TestBox.Center + TestBox.Axes * Offset, glm::vec3(0.0f), glm::quat() };
+            Contact Analytic = { glm::vec3(0.0f), 0.0f };
+            Contact Epa = { glm::vec3(0.0f), 0.0f };
+            bool AnalyticHit = sphereBoxContact(TestSphere, TestBox, Analytic);
+            bool EpaHit = gjkEpaContact(TestSphere, TestBox, Epa);
+
+            float DepthError = fabs(Analytic.Depth - Epa.Depth);
+            float NormalDot = glm::dot(Analytic.Normal, Epa.Normal);
+            bool Matched = AnalyticHit == EpaHit && (!AnalyticHit || (DepthError < EpaDepthTolerance && NormalDot > EpaNormalTolerance));
+            Passed = Passed && Matched;
+
+            cout << (Matched ? "[ok]   " : "[fail] ") << "offset (" << Offset.x << ", " << Offset.y << ", " << Offset.z << ")"
+                << " depth " << Analytic.Depth << " / " << Epa.Depth << " normal dot " << NormalDot << endl;
+        }
+    }
+    return Passed;
+}
+
+static void
+StepWorld(BenchWorld& world, float dt, const WindField* wind) {
+    for (Sphere* sphere : world.Spheres) updateSphere(sphere, dt, wind);
+    checkConstraints(world.Spheres, world.Planes, world.Cylinders);
+    checkConvexConstraints(world.Spheres, world.Boxes, world.Capsules, world.Hulls);
+}
+
+static BenchResult
+MeasureWorld(BenchWorld& world, const BenchOptions& options, const WindField* wind) {
+    BenchResult Result = { 0, 0.0, 0.0 };
+    Clock::time_point RunStart = Clock::now();
+
+    while (Result.Steps < options.MaxSteps) {
+        Clock::time_point Start = Clock::now();
+        for (Sphere* sphere : world.Spheres) updateSphere(sphere, options.Step, wind);
+        Result.UpdateSeconds += SecondsSince(Start);
+
+        Start = Clock::now();
+        checkConstraints(world.Spheres, world.Planes, world.Cylinders);
+        Result.ConstraintSeconds += SecondsSince(Start);
+
+        checkConvexConstraints(world.Spheres, world.Boxes, world.Capsules, world.Hulls);
+        Result.Steps++;
+
+        if (SecondsSince(RunStart) > options.TimeBudget) break;
+    }
+    return Result;
+}
+
+static void
+PrintHeader() {
+    cout << left << setw(10) << "scene" << right << setw(10) << "spheres" << setw(8) << "palms" << setw(8) << "steps"
+        << setw(22) << "updateSphere" << setw(22) << "checkConstraints" << endl;
+    cout << left << setw(10) << "" << right << setw(10) << "" << setw(8) << "" << setw(8) << ""
+        << setw(22) << "[bodies*steps/s]" << setw(22) << "[bodies*steps/s]" << endl;
+}
+
+static void
+PrintResult(const string& scene, const BenchWorld& world, const BenchResult& result) {
+    double BodySteps = (double)world.Spheres.size() * result.Steps;
+    double UpdateRate = result.UpdateSeconds > 0.0 ? BodySteps / result.UpdateSeconds : 0.0;
+    double ConstraintRate = result.ConstraintSeconds > 0.0 ? BodySteps / result.ConstraintSeconds : 0.0;
+    cout << left << setw(10) << scene << right << setw(10) << world.Spheres.size() << setw(8) << world.Cylinders.size()
+        << setw(8) << result.Steps << fixed << setprecision(0)
+        << setw(22) << UpdateRate << setw(22) << ConstraintRate << endl;
+    cout.unsetf(ios::fixed);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions Options;
+    if (!ParseOptions(argc, argv, Options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    CollisionLogging = false;
+    if (Options.CheckEpa) return CheckEpaAgainstAnalytic() ? 0 : 1;
+
+    WindField Wind;
+    const WindField* WindPtr = 0;
+    if (Options.UseWind) {
+        SetupBenchWind(Wind);
+        WindPtr = &Wind;
+    }
+
+    BenchWorld World;
+    PrintHeader();
+
+    if (!Options.LoadPath.empty()) {
+        vector<unsigned char> Data;
+        SnapshotReader Reader(Data);
+        if (!readSnapshotFile(Options.LoadPath, Data) || !Reader.Begin()
+            || !deserializePhysicsWorld(Reader, World.Spheres, World.Planes, World.Cylinders, World.Boxes, World.Capsules, World.Hulls)) {
+            std::cerr << "[Err] Failed to load " << Options.LoadPath << std::endl;
+            return 1;
+        }
+        PrintResult("snapshot", World, MeasureWorld(World, Options, WindPtr));
+        clearWorld(World);
+        return 0;
+    }
+
+    SnapshotWriter Writer;
+    for (BenchScene Scene : Options.Scenes) {
+        for (int Count : Options.Counts) {
+            SceneConfig Config = { Scene, Count, Options.PalmCount, Options.RockCount, Options.Seed };
+            generateScene(Config, World);
+            for (int Step = 0; Step < Options.WarmupSteps; ++Step) StepWorld(World, Options.Step, WindPtr);
+
+            if (!Options.SavePath.empty()) {
+                Writer.Begin();
+                serializePhysicsWorld(Writer, World.Spheres, World.Planes, World.Cylinders, World.Boxes, World.Capsules, World.Hulls);
+            }
+
+            PrintResult(sceneName(Scene), World, MeasureWorld(World, Options, WindPtr));
+        }
+    }
+
+    if (!Options.SavePath.empty()) writeSnapshotFile(Options.SavePath, Writer.Data());
+    clearWorld(World);
+    return 0;
+}
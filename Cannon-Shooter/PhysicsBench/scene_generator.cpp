@@ -0,0 +1,125 @@
+#include <glm/glm.hpp>
+#include "scene_generator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// NOTE: Same ball the cannon shoots
+const float BENCH_SPHERE_MASS = 10.0f;
+const float BENCH_SPHERE_RADIUS = 0.4f;
+// NOTE: Radius of the outer palm ring in the game
+const float BENCH_AREA = 90.0f;
+
+template<class T>
+static void freeList(std::list<T*>& items) {
+    for (T* item : items) delete item;
+    items.clear();
+}
+
+void clearWorld(BenchWorld& world) {
+    freeList(world.Spheres);
+    freeList(world.Planes);
+    freeList(world.Cylinders);
+    freeList(world.Boxes);
+    freeList(world.Capsules);
+    freeList(world.Hulls);
+}
+
+const char* sceneName(BenchScene scene) {
+    switch (scene) {
+    case SCENE_PACKED_PILE: return "pile";
+    case SCENE_BALL_RAIN: return "rain";
+    case SCENE_RANDOM_SCATTER: return "scatter";
+    default: return "unknown";
+    }
+}
+
+bool parseSceneName(const std::string& name, BenchScene& scene) {
+    for (int i = 0; i < SCENE_COUNT; ++i) {
+        if (name == sceneName((BenchScene)i)) {
+            scene = (BenchScene)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void addPalms(BenchWorld& world, int palmCount) {
+    // NOTE: Sunflower spiral spreads any number of trunks evenly over the area
+    const float goldenAngle = 2.39996323f;
+    for (int i = 0; i < palmCount; ++i) {
+        float radius = BENCH_AREA * std::sqrt((i + 0.5f) / palmCount);
+        float angle = i * goldenAngle;
+        glm::vec3 pos(std::cos(angle) * radius, 0.0f, std::sin(angle) * radius);
+        world.Cylinders.push_back(new Cylinder{ 0.5f, glm::vec3(pos.x, 20.0f, pos.z - 0.8f), pos });
+    }
+}
+
+static void addRocks(BenchWorld& world, int rockCount) {
+    // NOTE: Rocks sit on a ring between the palms so falling and scattered spheres reach the GJK/EPA path
+    for (int i = 0; i < rockCount; ++i) {
+        float angle = (i + 0.5f) * 6.2831853f / rockCount;
+        ConvexHull* rock = new ConvexHull();
+        buildRockHull(*rock, 1.6f, 0.8f, 1.8f, glm::vec2(0.3f, -0.2f));
+        rock->Position = glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * (0.5f * BENCH_AREA) + glm::vec3(0.0f, floorHeight, 0.0f);
+        rock->Rotation = glm::mat3(glm::vec3(std::cos(angle), 0.0f, -std::sin(angle)), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(std::sin(angle), 0.0f, std::cos(angle)));
+        world.Hulls.push_back(rock);
+    }
+}
+
+static Sphere* newSphere(const glm::vec3& position, const glm::vec3& velocity) {
+    return new Sphere{ BENCH_SPHERE_MASS, BENCH_SPHERE_RADIUS, position, velocity, glm::quat() };
+}
+
+static void addPackedPile(BenchWorld& world, int count) {
+    int layers = std::max(1, (int)std::cbrt((float)count));
+    int side = std::max(1, (int)std::ceil(std::sqrt((float)count / layers)));
+    float spacing = 2.0f * BENCH_SPHERE_RADIUS * 1.001f;
+    float half = 0.5f * side * spacing;
+
+    for (int i = 0; i < count; ++i) {
+        int x = i % side;
+        int z = (i / side) % side;
+        int y = i / (side * side);
+        glm::vec3 position(x * spacing - half, floorHeight + BENCH_SPHERE_RADIUS + y * spacing, z * spacing - half);
+        world.Spheres.push_back(newSphere(position, glm::vec3(0.0f)));
+    }
+}
+
+static void addBallRain(BenchWorld& world, int count, std::mt19937& gen) {
+    std::uniform_real_distribution<float> area(-BENCH_AREA, BENCH_AREA);
+    std::uniform_real_distribution<float> height(20.0f, 80.0f);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 position(area(gen), height(gen), area(gen));
+        glm::vec3 velocity(jitter(gen), -5.0f, jitter(gen));
+        world.Spheres.push_back(newSphere(position, velocity));
+    }
+}
+
+static void addRandomScatter(BenchWorld& world, int count, std::mt19937& gen) {
+    std::uniform_real_distribution<float> area(-BENCH_AREA, BENCH_AREA);
+    std::uniform_real_distribution<float> height(BENCH_SPHERE_RADIUS + floorHeight, 20.0f);
+    std::uniform_real_distribution<float> speed(-10.0f, 10.0f);
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 position(area(gen), height(gen), area(gen));
+        glm::vec3 velocity(speed(gen), speed(gen), speed(gen));
+        world.Spheres.push_back(newSphere(position, velocity));
+    }
+}
+
+void generateScene(const SceneConfig& config, BenchWorld& world) {
+    clearWorld(world);
+    std::mt19937 gen(config.Seed);
+
+    world.Planes.push_back(new Plane{ glm::vec3(0.0f, 1.0f, 0.0f), floorHeight });
+    addPalms(world, config.PalmCount);
+    addRocks(world, config.RockCount);
+
+    switch (config.Scene) {
+    case SCENE_PACKED_PILE: addPackedPile(world, config.SphereCount); break;
+    case SCENE_BALL_RAIN: addBallRain(world, config.SphereCount, gen); break;
+    case SCENE_RANDOM_SCATTER: addRandomScatter(world, config.SphereCount, gen); break;
+    default: break;
+    }
+}
@@ -0,0 +1,43 @@
+#include <list>
+#include <string>
+#include "physics.hpp"
+#ifndef SCENE_GENERATOR_HPP
+#define SCENE_GENERATOR_HPP
+
+enum BenchScene {
+    SCENE_PACKED_PILE = 0,
+    SCENE_BALL_RAIN = 1,
+    SCENE_RANDOM_SCATTER = 2,
+    SCENE_COUNT = 3,
+};
+
+struct SceneConfig {
+    BenchScene Scene;
+    int SphereCount;
+    int PalmCount;
+    int RockCount;
+    unsigned Seed;
+};
+
+struct BenchWorld {
+    std::list<Sphere*> Spheres;
+    std::list<Plane*> Planes;
+    std::list<Cylinder*> Cylinders;
+    std::list<Box*> Boxes;
+    std::list<Capsule*> Capsules;
+    std::list<ConvexHull*> Hulls;
+};
+
+/**
+ * @brief Fills the world with the floor plane, palm trunks, rock hulls and spheres laid out for the scene.
+ * Previous contents are freed first
+ */
+void generateScene(const SceneConfig& config, BenchWorld& world);
+
+void clearWorld(BenchWorld& world);
+
+const char* sceneName(BenchScene scene);
+
+bool parseSceneName(const std::string& name, BenchScene& scene);
+
+#endif